@@ -1,5 +1,40 @@
+// Helpers shared by the benchmarks.
+//
+// `bench::Harness` is the per-thread part of a concurrent benchmark:
+//
+// 1. It pins the thread to a CPU when the environment variable LOSYNC_BENCH_PIN_THREADS is set to a non-zero value.
+//    Thread `i` of the benchmark takes the `i`-th CPU allowed to the process, modulo their number.
+// 2. `Measure(f)` runs one timed operation and samples its latency into a histogram shared by all threads.
+//    After the loop thread 0 reports the p50, p99, p99.9 and maximum latency in nanoseconds as counters.
+// 3. Counters averaged per iteration become per-operation values. These are the hardware counters requested with
+//    `--benchmark_perf_counters=CYCLES,CACHE-MISSES`, which needs a build with LOSYNC_ENABLE_BENCHMARK_PERF_COUNTERS.
+// 4. `AssignRole` splits the threads of a benchmark into producers and consumers.
+//
+// Counters go to the JSON output of google_benchmark like all others. The LosyncBmJson target runs every benchmark
+// with `--benchmark_out` and writes the results to `benchmark_results/<executable>.json` in the build directory.
+
 #pragma once
 
+#include <losync/sharded_histogram.h>
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
 #ifdef _MSC_VER
 #define NOINLINE __declspec(noinline)
 #else
@@ -7,3 +42,247 @@
 #endif
 
 #define CACHE_ALIGNED alignas(std::hardware_destructive_interference_size)
+
+
+namespace bench
+{
+
+enum class Role
+{
+    Producer,
+    Consumer,
+};
+
+struct RoleAssignment
+{
+    Role role;
+    // Index of the thread among the threads of its role
+    int index;
+    // Number of threads in the role
+    int count;
+};
+
+// The first `producers` threads produce and the rest consume. By default the threads are split in halves,
+// a benchmark with a single thread gets only a producer.
+inline RoleAssignment AssignRole(const benchmark::State& state, int producers = -1)
+{
+    const int threads = state.threads();
+    if (producers < 0)
+    {
+        producers = (threads + 1) / 2;
+    }
+    const int thread = state.thread_index();
+    if (thread < producers)
+    {
+        return {Role::Producer, thread, producers};
+    }
+    return {Role::Consumer, thread - producers, threads - producers};
+}
+
+
+// Pins the calling thread to one CPU and restores its previous affinity on destruction.
+// Does nothing unless LOSYNC_BENCH_PIN_THREADS is set or on platforms without thread affinity.
+class ThreadPin
+{
+public:
+    explicit ThreadPin(const int thread)
+    {
+        if (!Enabled())
+        {
+            return;
+        }
+#if defined(__linux__)
+        if (pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous) != 0)
+        {
+            return;
+        }
+        int target = thread % CPU_COUNT(&previous);
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &previous) && target-- == 0)
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+                break;
+            }
+        }
+#elif defined(_WIN32)
+        DWORD_PTR process = 0;
+        DWORD_PTR system = 0;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system) || process == 0)
+        {
+            return;
+        }
+        int allowed = 0;
+        for (DWORD_PTR mask = process; mask != 0; mask &= mask - 1)
+        {
+            ++allowed;
+        }
+        int target = thread % allowed;
+        for (DWORD_PTR mask = process; mask != 0; mask &= mask - 1)
+        {
+            if (target-- == 0)
+            {
+                previous = SetThreadAffinityMask(GetCurrentThread(), mask & ~(mask - 1));
+                pinned = previous != 0;
+                break;
+            }
+        }
+#else
+        (void)thread;
+#endif
+    }
+
+    ThreadPin(const ThreadPin&) = delete;
+    ThreadPin& operator=(const ThreadPin&) = delete;
+
+    ~ThreadPin()
+    {
+        if (!pinned)
+        {
+            return;
+        }
+#if defined(__linux__)
+        pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+#elif defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), previous);
+#endif
+    }
+
+    static bool Enabled()
+    {
+        static const bool enabled = []() {
+            const char* const value = std::getenv("LOSYNC_BENCH_PIN_THREADS");
+            return value != nullptr && *value != '\0' && *value != '0';
+        }();
+        return enabled;
+    }
+
+private:
+    bool pinned = false;
+#if defined(__linux__)
+    cpu_set_t previous;
+#elif defined(_WIN32)
+    DWORD_PTR previous = 0;
+#endif
+};
+
+
+class Harness
+{
+public:
+    // Every `sampleEvery`-th call of `Measure` is timed, it is rounded up to a power of two.
+    // Reading the clock costs tens of nanoseconds, so short operations should not be timed every time.
+    // The cost is calibrated once and subtracted from the samples.
+    static constexpr std::uint32_t DefaultSampleEvery = 64;
+
+    explicit Harness(benchmark::State& state, const std::int64_t opsPerIteration = 1,
+                     const std::uint32_t sampleEvery = DefaultSampleEvery)
+        : state(state),
+          pin(state.thread_index()),
+          opsPerIteration(opsPerIteration),
+          sampleMask(RoundUpToPowerOfTwo(sampleEvery) - 1),
+          // Threads start sampling at different calls, so they are not timed at the same moments
+          calls(static_cast<std::uint32_t>(state.thread_index()) * 7),
+          shard(PrepareLatencies(state))
+    {
+        ClockOverhead();
+    }
+
+    Harness(const Harness&) = delete;
+    Harness& operator=(const Harness&) = delete;
+
+    template <typename F>
+    void Measure(F&& operation)
+    {
+        if ((calls++ & sampleMask) != 0)
+        {
+            operation();
+            return;
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        operation();
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        const std::uint64_t elapsed = static_cast<std::uint64_t>(std::chrono::nanoseconds(end - start).count());
+        shard.record(elapsed > ClockOverhead() ? elapsed - ClockOverhead() : 0);
+    }
+
+    // Must be called after the benchmark loop. Sets the processed items and reports the counters.
+    void Finish()
+    {
+        state.SetItemsProcessed(state.iterations() * opsPerIteration);
+        for (auto& [name, counter] : state.counters)
+        {
+            if (counter.flags == benchmark::Counter::kAvgIterations)
+            {
+                counter.value /= static_cast<double>(opsPerIteration);
+            }
+        }
+        // All threads left the loop and stopped recording
+        if (state.thread_index() == 0)
+        {
+            const losync::sharded_histogram::snapshot latencies = Latencies().read();
+            if (latencies.count() != 0)
+            {
+                state.counters["p50_ns"] = static_cast<double>(latencies.p50());
+                state.counters["p99_ns"] = static_cast<double>(latencies.p99());
+                state.counters["p999_ns"] = static_cast<double>(latencies.p999());
+                state.counters["max_ns"] = static_cast<double>(latencies.max());
+            }
+        }
+    }
+
+private:
+    static losync::sharded_histogram& Latencies()
+    {
+        static losync::sharded_histogram histogram;
+        return histogram;
+    }
+
+    // The shortest time between two readings of the clock, it is subtracted from the samples
+    static std::uint64_t ClockOverhead()
+    {
+        static const std::uint64_t overhead = []() {
+            std::chrono::steady_clock::duration shortest = std::chrono::steady_clock::duration::max();
+            for (int i = 0; i < 1000; ++i)
+            {
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+                shortest = elapsed < shortest ? elapsed : shortest;
+            }
+            return static_cast<std::uint64_t>(std::chrono::nanoseconds(shortest).count());
+        }();
+        return overhead;
+    }
+
+    static losync::sharded_histogram::local_shard PrepareLatencies(const benchmark::State& state)
+    {
+        // Other threads record only inside the benchmark loop, which starts after all threads got here
+        if (state.thread_index() == 0)
+        {
+            Latencies().reset();
+        }
+        return Latencies().local();
+    }
+
+    static std::uint32_t RoundUpToPowerOfTwo(const std::uint32_t value)
+    {
+        std::uint32_t result = 1;
+        while (result < value)
+        {
+            result *= 2;
+        }
+        return result;
+    }
+
+    benchmark::State& state;
+    const ThreadPin pin;
+    const std::int64_t opsPerIteration;
+    const std::uint32_t sampleMask;
+    std::uint32_t calls;
+    losync::sharded_histogram::local_shard shard;
+};
+
+} // namespace bench
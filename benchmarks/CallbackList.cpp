@@ -0,0 +1,118 @@
+#include <losync/callback_list.h>
+#include <losync/cheap_function.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+using namespace losync;
+
+
+struct Event
+{
+    std::uint64_t value;
+};
+
+// Every subscriber accumulates into its own cell, so the work per call is the same for all lists
+struct Sink
+{
+    std::uint64_t sum = 0;
+};
+
+
+// Subscribers of three kinds with captures of different sizes
+template <typename Subscribe>
+void SubscribeMixed(const std::size_t count, std::vector<Sink>& sinks, Subscribe&& subscribe)
+{
+    sinks.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Sink* const sink = &sinks[i];
+        switch (i % 3)
+        {
+        case 0:
+            subscribe([sink](const Event& event) { sink->sum += event.value; });
+            break;
+        case 1:
+            subscribe([sink, scale = std::uint64_t{3}](const Event& event) { sink->sum += event.value * scale; });
+            break;
+        default:
+            subscribe([sink, bias = std::uint64_t{1}, mask = std::uint64_t{0xFFFF}](const Event& event) {
+                sink->sum += (event.value & mask) + bias;
+            });
+            break;
+        }
+    }
+}
+
+
+class CallbackList
+{
+public:
+    explicit CallbackList(const std::size_t count)
+    {
+        SubscribeMixed(count, sinks, [this](auto&& func) { list.subscribe(std::move(func)); });
+    }
+
+    NOINLINE void Dispatch(const Event& event) const
+    {
+        list(event);
+    }
+
+private:
+    std::vector<Sink> sinks;
+    callback_list<void(const Event&)> list;
+};
+
+
+template <typename Function>
+class VectorOf
+{
+public:
+    explicit VectorOf(const std::size_t count)
+    {
+        SubscribeMixed(count, sinks, [this](auto&& func) { functions.emplace_back(std::move(func)); });
+    }
+
+    NOINLINE void Dispatch(const Event& event) const
+    {
+        for (const Function& func : functions)
+        {
+            func(event);
+        }
+    }
+
+private:
+    std::vector<Sink> sinks;
+    std::vector<Function> functions;
+};
+
+
+template <typename List>
+class FanOut
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const std::size_t count = static_cast<std::size_t>(state.range(0));
+        const List list(count);
+        Event event{1};
+        for (auto _ : state)
+        {
+            list.Dispatch(event);
+            ++event.value;
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+    }
+};
+
+
+BENCHMARK(FanOut<CallbackList>::Benchmark)->Arg(10)->Arg(10000);
+BENCHMARK(FanOut<VectorOf<std::function<void(const Event&)>>>::Benchmark)->Arg(10)->Arg(10000);
+BENCHMARK(FanOut<VectorOf<cheap_function<void(const Event&)>>>::Benchmark)->Arg(10)->Arg(10000);
@@ -1,4 +1,5 @@
 #include <losync/cheap_function.h>
+#include <losync/cheap_function_ref.h>
 
 #include "BenchCommon.h"
 
@@ -6,6 +7,8 @@
 
 #include <functional>
 #include <memory>
+#include <thread>
+#include <vector>
 
 
 using namespace losync;
@@ -13,6 +16,88 @@ using namespace losync;
 
 int globalValue = 123;
 
+
+namespace reference
+{
+
+// The former implementation of cheap_function based on a virtual interface.
+// It is kept to compare the static operations table against virtual calls.
+template <typename T>
+class virtual_function;
+
+template <typename Ret, typename... Args>
+class virtual_function<Ret(Args...)>
+{
+public:
+    template <typename T>
+    virtual_function(T&& obj)
+    {
+        static_assert(sizeof(Wrapper<T>) <= sizeof(wrapperBuffer));
+        new (&wrapperBuffer) Wrapper<T>(std::move(obj));
+    }
+
+    virtual_function(virtual_function&& b)
+    {
+        b.getWrapper()->placement_move_self(getWrapper());
+    }
+
+    ~virtual_function()
+    {
+        getWrapper()->~WrapperBase();
+    }
+
+    Ret operator()(Args... args) const
+    {
+        return getWrapper()->call(std::forward<Args>(args)...);
+    }
+
+private:
+    class WrapperBase
+    {
+    public:
+        virtual ~WrapperBase() = default;
+        virtual void placement_move_self(WrapperBase* destination) = 0;
+        virtual Ret call(Args... args) const = 0;
+    };
+
+    template <typename T>
+    class Wrapper : public WrapperBase
+    {
+    public:
+        explicit Wrapper(T&& value) : wrapped_value(std::move(value))
+        {
+        }
+
+        void placement_move_self(WrapperBase* destination) override
+        {
+            new (static_cast<Wrapper*>(destination)) Wrapper(std::move(wrapped_value));
+        }
+
+        Ret call(Args... args) const override
+        {
+            return wrapped_value(std::forward<Args>(args)...);
+        }
+
+    private:
+        T wrapped_value;
+    };
+
+    WrapperBase* getWrapper()
+    {
+        return std::launder(reinterpret_cast<WrapperBase*>(&wrapperBuffer));
+    }
+
+    const WrapperBase* getWrapper() const
+    {
+        return std::launder(reinterpret_cast<const WrapperBase*>(&wrapperBuffer));
+    }
+
+    alignas(std::max_align_t) char wrapperBuffer[cheap_function_default_capacity];
+};
+
+} // namespace reference
+
+
 NOINLINE static int StdFuncFastInt(const std::function<int(int)>& func, const int value)
 {
     return func(value);
@@ -35,6 +120,22 @@ NOINLINE static int CheapFuncFullInt(cheap_function<int(int)>&& func, const int
     return func2(value);
 }
 
+NOINLINE static int CheapFuncRefFastInt(const cheap_function_ref<int(int)> func, const int value)
+{
+    return func(value);
+}
+
+NOINLINE static int VirtualFuncFastInt(const reference::virtual_function<int(int)>& func, const int value)
+{
+    return func(value);
+}
+
+NOINLINE static int VirtualFuncFullInt(reference::virtual_function<int(int)>&& func, const int value)
+{
+    const reference::virtual_function<int(int)> func2 = std::move(func);
+    return func2(value);
+}
+
 
 struct FewInts
 {
@@ -126,13 +227,15 @@ public:
         }
     }
 
-    static void StdFuncFast(benchmark::State& state)
+    // Captures the next prepared value in a lambda and passes it to `call`, which is the measured operation
+    template <typename Call>
+    static void Run(benchmark::State& state, Call&& call)
     {
         const int delta = globalValue;
         std::vector<T> data;
         PrepareData(data);
-
-        for (auto value : state)
+        bench::Harness harness(state);
+        for (auto _ : state)
         {
             if (data.empty())
             {
@@ -140,67 +243,48 @@ public:
                 PrepareData(data);
                 state.ResumeTiming();
             }
-            auto lambda = [delta, data = std::move(data.back())](int value) { return value + delta; };
-            data.pop_back();
-            benchmark::DoNotOptimize(StdFuncFastInt(std::move(lambda), 345));
+            harness.Measure([&]() {
+                auto lambda = [delta, data = std::move(data.back())](int value) { return value + delta; };
+                data.pop_back();
+                benchmark::DoNotOptimize(call(lambda));
+            });
         }
+        harness.Finish();
+    }
+
+    static void StdFuncFast(benchmark::State& state)
+    {
+        Run(state, [](auto& lambda) { return StdFuncFastInt(std::move(lambda), 345); });
     }
 
     static void StdFuncFull(benchmark::State& state)
     {
-        const int delta = globalValue;
-        std::vector<T> data;
-        PrepareData(data);
-        for (auto value : state)
-        {
-            if (data.empty())
-            {
-                state.PauseTiming();
-                PrepareData(data);
-                state.ResumeTiming();
-            }
-            auto lambda = [delta, data = std::move(data.back())](int value) { return value + delta; };
-            data.pop_back();
-            benchmark::DoNotOptimize(StdFuncFullInt(std::move(lambda), 345));
-        }
+        Run(state, [](auto& lambda) { return StdFuncFullInt(std::move(lambda), 345); });
     }
 
     static void CheapFuncFast(benchmark::State& state)
     {
-        const int delta = globalValue;
-        std::vector<T> data;
-        PrepareData(data);
-        for (auto value : state)
-        {
-            if (data.empty())
-            {
-                state.PauseTiming();
-                PrepareData(data);
-                state.ResumeTiming();
-            }
-            auto lambda = [delta, data = std::move(data.back())](int value) { return value + delta; };
-            data.pop_back();
-            benchmark::DoNotOptimize(CheapFuncFastInt(std::move(lambda), 345));
-        }
+        Run(state, [](auto& lambda) { return CheapFuncFastInt(std::move(lambda), 345); });
     }
 
     static void CheapFuncFull(benchmark::State& state)
     {
-        const int delta = globalValue;
-        std::vector<T> data;
-        PrepareData(data);
-        for (auto value : state)
-        {
-            if (data.empty())
-            {
-                state.PauseTiming();
-                PrepareData(data);
-                state.ResumeTiming();
-            }
-            auto lambda = [delta, data = std::move(data.back())](int value) { return value + delta; };
-            data.pop_back();
-            benchmark::DoNotOptimize(CheapFuncFullInt(std::move(lambda), 345));
-        }
+        Run(state, [](auto& lambda) { return CheapFuncFullInt(std::move(lambda), 345); });
+    }
+
+    static void CheapFuncRefFast(benchmark::State& state)
+    {
+        Run(state, [](auto& lambda) { return CheapFuncRefFastInt(lambda, 345); });
+    }
+
+    static void VirtualFuncFast(benchmark::State& state)
+    {
+        Run(state, [](auto& lambda) { return VirtualFuncFastInt(std::move(lambda), 345); });
+    }
+
+    static void VirtualFuncFull(benchmark::State& state)
+    {
+        Run(state, [](auto& lambda) { return VirtualFuncFullInt(std::move(lambda), 345); });
     }
 };
 
@@ -210,30 +294,133 @@ using Bench = CheapTester<T>;
 
 BENCHMARK(*Bench<int>::StdFuncFast);
 BENCHMARK(*Bench<int>::CheapFuncFast);
+BENCHMARK(*Bench<int>::CheapFuncRefFast);
 BENCHMARK(*Bench<int>::StdFuncFull);
 BENCHMARK(*Bench<int>::CheapFuncFull);
+BENCHMARK(*Bench<int>::VirtualFuncFast);
+BENCHMARK(*Bench<int>::VirtualFuncFull);
 
 BENCHMARK(*Bench<FewInts>::StdFuncFast);
 BENCHMARK(*Bench<FewInts>::CheapFuncFast);
+BENCHMARK(*Bench<FewInts>::CheapFuncRefFast);
 BENCHMARK(*Bench<FewInts>::StdFuncFull);
 BENCHMARK(*Bench<FewInts>::CheapFuncFull);
+BENCHMARK(*Bench<FewInts>::VirtualFuncFast);
+BENCHMARK(*Bench<FewInts>::VirtualFuncFull);
 
 BENCHMARK(*Bench<std::string>::StdFuncFast);
 BENCHMARK(*Bench<std::string>::CheapFuncFast);
+BENCHMARK(*Bench<std::string>::CheapFuncRefFast);
 BENCHMARK(*Bench<std::string>::StdFuncFull);
 BENCHMARK(*Bench<std::string>::CheapFuncFull);
+BENCHMARK(*Bench<std::string>::VirtualFuncFast);
+BENCHMARK(*Bench<std::string>::VirtualFuncFull);
 
 BENCHMARK(*Bench<FewStrings>::StdFuncFast);
 BENCHMARK(*Bench<FewStrings>::CheapFuncFast);
+BENCHMARK(*Bench<FewStrings>::CheapFuncRefFast);
 BENCHMARK(*Bench<FewStrings>::StdFuncFull);
 BENCHMARK(*Bench<FewStrings>::CheapFuncFull);
+BENCHMARK(*Bench<FewStrings>::VirtualFuncFast);
+BENCHMARK(*Bench<FewStrings>::VirtualFuncFull);
 
 BENCHMARK(*Bench<FewSharedPtrs>::StdFuncFast);
 BENCHMARK(*Bench<FewSharedPtrs>::CheapFuncFast);
+BENCHMARK(*Bench<FewSharedPtrs>::CheapFuncRefFast);
 BENCHMARK(*Bench<FewSharedPtrs>::StdFuncFull);
 BENCHMARK(*Bench<FewSharedPtrs>::CheapFuncFull);
+BENCHMARK(*Bench<FewSharedPtrs>::VirtualFuncFast);
+BENCHMARK(*Bench<FewSharedPtrs>::VirtualFuncFull);
 
 BENCHMARK(*Bench<VeryBigObj>::StdFuncFast);
 BENCHMARK(*Bench<VeryBigObj>::CheapFuncFast);
+BENCHMARK(*Bench<VeryBigObj>::CheapFuncRefFast);
 BENCHMARK(*Bench<VeryBigObj>::StdFuncFull);
 BENCHMARK(*Bench<VeryBigObj>::CheapFuncFull);
+BENCHMARK(*Bench<VeryBigObj>::VirtualFuncFast);
+BENCHMARK(*Bench<VeryBigObj>::VirtualFuncFull);
+
+
+// Moves a queue of small tasks back and forth to show memory and move cost of every capacity
+template <std::size_t Capacity>
+static void CheapFuncCapacityMove(benchmark::State& state)
+{
+    using Task = cheap_function<int(int), Capacity>;
+    constexpr int Count = 1000;
+
+    const int delta = globalValue;
+    std::vector<Task> source;
+    std::vector<Task> destination;
+    source.reserve(Count);
+    destination.reserve(Count);
+    for (int i = 0; i < Count; ++i)
+    {
+        source.emplace_back([delta, i](int value) { return value + delta + i; });
+    }
+
+    bench::Harness harness(state, Count, 1);
+    for (auto _ : state)
+    {
+        harness.Measure([&]() {
+            for (Task& task : source)
+            {
+                destination.emplace_back(std::move(task));
+            }
+            source.clear();
+            std::swap(source, destination);
+            benchmark::DoNotOptimize(source.data());
+        });
+    }
+
+    harness.Finish();
+    state.SetBytesProcessed(state.iterations() * Count * sizeof(Task));
+    state.counters["BytesPerTask"] = sizeof(Task);
+}
+
+BENCHMARK(CheapFuncCapacityMove<32>);
+BENCHMARK(CheapFuncCapacityMove<64>);
+BENCHMARK(CheapFuncCapacityMove<128>);
+BENCHMARK(CheapFuncCapacityMove<cheap_function_default_capacity>);
+
+
+// Same size as VeryBigObj, but it does not allocate memory by itself, so only the storage of the functor is measured
+struct BigInts
+{
+    int values[sizeof(VeryBigObj) / sizeof(int)] = {1, 33, 55, 23, 765, 22, 567, 543};
+};
+
+// Every thread creates and destroys batches of functors which are too big for the inline storage
+template <typename Func>
+static void OversizedChurn(benchmark::State& state)
+{
+    constexpr int BatchSize = 32;
+    const int delta = globalValue;
+    std::vector<Func> batch;
+    batch.reserve(BatchSize);
+
+    bench::Harness harness(state, BatchSize, 8);
+    for (auto _ : state)
+    {
+        harness.Measure([&]() {
+            for (int i = 0; i < BatchSize; ++i)
+            {
+                BigInts data;
+                data.values[0] = i;
+                batch.emplace_back([delta, data](int value) { return value + delta + data.values[0]; });
+            }
+            int sum = 0;
+            for (const Func& func : batch)
+            {
+                sum += func(1);
+            }
+            benchmark::DoNotOptimize(sum);
+            batch.clear();
+        });
+    }
+    harness.Finish();
+}
+
+static_assert(!hybrid_function<int(int)>::fits<BigInts>);
+
+BENCHMARK(OversizedChurn<std::function<int(int)>>)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(OversizedChurn<hybrid_function<int(int)>>)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
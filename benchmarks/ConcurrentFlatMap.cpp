@@ -0,0 +1,164 @@
+#include <losync/concurrent_flat_map.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+constexpr std::uint64_t KeyCount = 1 << 16;
+
+
+// Keys drawn from a Zipf distribution with exponent 0.99: a few hot keys take most of the accesses.
+// The sequence is generated up front, so drawing a key costs only an array read in the measured loop.
+class ZipfKeys
+{
+public:
+    explicit ZipfKeys(const std::uint32_t seed) : keys(SequenceLength)
+    {
+        const std::vector<double>& cdf = Cdf();
+        std::mt19937_64 random(seed);
+        std::uniform_real_distribution<double> distribution(0.0, 1.0);
+        for (std::uint64_t& key : keys)
+        {
+            const std::uint64_t rank = static_cast<std::uint64_t>(
+                std::lower_bound(cdf.begin(), cdf.end(), distribution(random)) - cdf.begin());
+            // Scatter the ranks, so hot keys do not land in neighbouring slots
+            key = (std::min(rank, KeyCount - 1) * 0x9E3779B97F4A7C15ull) % KeyCount;
+        }
+    }
+
+    std::uint64_t Next()
+    {
+        return keys[next++ % SequenceLength];
+    }
+
+private:
+    static const std::vector<double>& Cdf()
+    {
+        static const std::vector<double> cdf = []() {
+            std::vector<double> result(KeyCount);
+            double sum = 0;
+            for (std::uint64_t rank = 0; rank < KeyCount; ++rank)
+            {
+                sum += 1.0 / std::pow(static_cast<double>(rank + 1), 0.99);
+                result[rank] = sum;
+            }
+            for (double& value : result)
+            {
+                value /= sum;
+            }
+            return result;
+        }();
+        return cdf;
+    }
+
+    static constexpr std::size_t SequenceLength = 1 << 20;
+
+    std::vector<std::uint64_t> keys;
+    std::size_t next = 0;
+};
+
+
+class LosyncFlatMap
+{
+public:
+    NOINLINE std::uint64_t Find(const std::uint64_t key) const
+    {
+        return map.find(key).value_or(0);
+    }
+
+    NOINLINE void Assign(const std::uint64_t key, const std::uint64_t value)
+    {
+        map.insert_or_assign(key, value);
+    }
+
+private:
+    losync::concurrent_flat_map<std::uint64_t, std::uint64_t> map;
+};
+
+
+class MutexUnorderedMap
+{
+public:
+    NOINLINE std::uint64_t Find(const std::uint64_t key) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = map.find(key);
+        return it != map.end() ? it->second : 0;
+    }
+
+    NOINLINE void Assign(const std::uint64_t key, const std::uint64_t value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        map.insert_or_assign(key, value);
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::uint64_t, std::uint64_t> map;
+};
+
+
+// Every thread reads `state.range(0)` percent of the time and assigns otherwise.
+// Half of the keys are present, so reads of missing keys are measured too.
+template <typename Map>
+class ZipfMix
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        static Map* map = nullptr;
+        if (state.thread_index() == 0)
+        {
+            map = new Map();
+            for (std::uint64_t key = 0; key < KeyCount; key += 2)
+            {
+                map->Assign(key, key);
+            }
+        }
+        const std::int64_t readPercent = state.range(0);
+        ZipfKeys keys(static_cast<std::uint32_t>(state.thread_index()) + 1);
+        std::minstd_rand choice(static_cast<std::uint32_t>(state.thread_index()) + 1);
+        std::uint64_t sum = 0;
+        for (auto _ : state)
+        {
+            const std::uint64_t key = keys.Next();
+            if (static_cast<std::int64_t>(choice() % 100) < readPercent)
+            {
+                sum += map->Find(key);
+            }
+            else if (key % 2 == 0)
+            {
+                map->Assign(key, sum);
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+        if (state.thread_index() == 0)
+        {
+            delete map;
+        }
+    }
+};
+
+
+BENCHMARK(ZipfMix<LosyncFlatMap>::Benchmark)
+    ->Arg(50)
+    ->Arg(90)
+    ->Arg(99)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(ZipfMix<MutexUnorderedMap>::Benchmark)
+    ->Arg(50)
+    ->Arg(90)
+    ->Arg(99)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
@@ -0,0 +1,100 @@
+#include <losync/flat_combiner.h>
+#include <losync/mutex.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+
+using Heap = std::priority_queue<std::uint32_t>;
+
+// Elements in the queue before and after every push-pop pair
+constexpr int QueueSize = 1024;
+
+
+class FlatCombined
+{
+public:
+    NOINLINE static std::uint32_t PushPop(const std::uint32_t value)
+    {
+        queue.apply([value](Heap& heap) { heap.push(value); });
+        return queue.apply([](Heap& heap) {
+            const std::uint32_t top = heap.top();
+            heap.pop();
+            return top;
+        });
+    }
+
+    static Heap& Unsafe()
+    {
+        return queue.unsafe_data();
+    }
+
+private:
+    inline static losync::flat_combiner<Heap> queue;
+};
+
+
+template <typename Mutex>
+class Locked
+{
+public:
+    NOINLINE static std::uint32_t PushPop(const std::uint32_t value)
+    {
+        {
+            std::lock_guard<Mutex> lock(mutex);
+            heap.push(value);
+        }
+        std::lock_guard<Mutex> lock(mutex);
+        const std::uint32_t top = heap.top();
+        heap.pop();
+        return top;
+    }
+
+    static Heap& Unsafe()
+    {
+        return heap;
+    }
+
+private:
+    inline static Mutex mutex;
+    inline static Heap heap;
+};
+
+
+template <typename Queue>
+class PushPop
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        if (state.thread_index() == 0)
+        {
+            Heap& heap = Queue::Unsafe();
+            while (heap.size() < QueueSize)
+            {
+                heap.push(static_cast<std::uint32_t>(heap.size()) * 2654435761u);
+            }
+        }
+        std::uint32_t random = static_cast<std::uint32_t>(state.thread_index()) * 2654435761u + 1;
+        for (auto _ : state)
+        {
+            // xorshift32
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            benchmark::DoNotOptimize(Queue::PushPop(random));
+        }
+        state.SetItemsProcessed(state.iterations() * 2);
+    }
+};
+
+
+BENCHMARK(PushPop<FlatCombined>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(PushPop<Locked<losync::mutex>>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(PushPop<Locked<std::mutex>>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
@@ -0,0 +1,199 @@
+#include <losync/future.h>
+#include <losync/thread_pool.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <new>
+
+
+// Every allocation of the process is counted to report allocations per operation. All the forms of
+// `new` and `delete` are replaced, so every pointer which reaches `free` comes from `malloc` or `aligned_alloc`.
+static std::atomic<std::uint64_t> allocations{0};
+
+static void* countedAllocate(const std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* const ptr = std::malloc(size != 0 ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+static void* countedAllocate(const std::size_t size, const std::align_val_t align)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t alignment = static_cast<std::size_t>(align);
+    // `aligned_alloc` requires the size to be a multiple of the alignment
+    const std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+    if (void* const ptr = std::aligned_alloc(alignment, rounded != 0 ? rounded : alignment))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(const std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](const std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new(const std::size_t size, const std::align_val_t align)
+{
+    return countedAllocate(size, align);
+}
+
+void* operator new[](const std::size_t size, const std::align_val_t align)
+{
+    return countedAllocate(size, align);
+}
+
+void operator delete(void* const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* const ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* const ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* const ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+
+class LosyncFuture
+{
+public:
+    // `length` continuations attached before the value arrives
+    NOINLINE static int Chain(const int length)
+    {
+        losync::promise<int> source;
+        losync::future<int> result = source.get_future();
+        for (int i = 0; i < length; ++i)
+        {
+            result = result.then([](const int value) { return value + 1; });
+        }
+        source.set_value(0);
+        return result.get();
+    }
+
+    NOINLINE static int Hop(losync::thread_pool& pool)
+    {
+        losync::promise<int> source;
+        losync::future<int> result = source.get_future().then(pool, [](const int value) { return value + 1; });
+        source.set_value(0);
+        return result.get();
+    }
+};
+
+
+// `std::future` has no continuations: every step of the chain is a separate promise and future
+class StdFuture
+{
+public:
+    NOINLINE static int Chain(const int length)
+    {
+        int value = 0;
+        for (int i = 0; i < length; ++i)
+        {
+            std::promise<int> step;
+            std::future<int> result = step.get_future();
+            step.set_value(value);
+            value = result.get() + 1;
+        }
+        return value;
+    }
+
+    NOINLINE static int Hop(losync::thread_pool& pool)
+    {
+        std::promise<int> step;
+        std::future<int> result = step.get_future();
+        pool.submit([&step]() { step.set_value(1); });
+        return result.get();
+    }
+};
+
+
+template <typename Future>
+class Chain
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const int length = static_cast<int>(state.range(0));
+        const std::uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(Future::Chain(length));
+        }
+        const std::uint64_t operations = state.iterations() * static_cast<std::uint64_t>(length);
+        state.SetItemsProcessed(static_cast<std::int64_t>(operations));
+        state.counters["AllocsPerOp"] =
+            static_cast<double>(allocations.load(std::memory_order_relaxed) - allocationsBefore) / operations;
+    }
+};
+
+
+// The value crosses to a worker of the pool and back
+template <typename Future>
+class Hop
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        losync::thread_pool pool(1);
+        const std::uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(Future::Hop(pool));
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.counters["AllocsPerOp"] =
+            static_cast<double>(allocations.load(std::memory_order_relaxed) - allocationsBefore) / state.iterations();
+    }
+};
+
+
+BENCHMARK(Chain<LosyncFuture>::Benchmark)->Arg(1)->Arg(8);
+BENCHMARK(Chain<StdFuture>::Benchmark)->Arg(1)->Arg(8);
+BENCHMARK(Hop<LosyncFuture>::Benchmark)->UseRealTime();
+BENCHMARK(Hop<StdFuture>::Benchmark)->UseRealTime();
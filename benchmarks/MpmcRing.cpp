@@ -0,0 +1,161 @@
+#include <losync/cheap_function.h>
+#include <losync/mpmc_ring.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+
+// The first `state.range(0)` threads are producers, the other `state.range(1)` threads are consumers.
+// Both sides never block: a round which found the ring full or empty just counts nothing,
+// so the reported items are tasks which went through the queue and were executed.
+constexpr std::size_t RingCapacity = 1024;
+
+
+template <std::size_t Batch>
+class LosyncMpmcRing
+{
+public:
+    using task = losync::cheap_function<void()>;
+
+    static void Benchmark(benchmark::State& state)
+    {
+        const bool producer = state.thread_index() < state.range(0);
+        std::vector<task> batch;
+        batch.reserve(Batch);
+        std::int64_t processed = 0;
+        for (auto _ : state)
+        {
+            if (producer)
+            {
+                Produce(batch);
+            }
+            else
+            {
+                processed += static_cast<std::int64_t>(Consume(batch));
+            }
+        }
+        state.SetItemsProcessed(processed);
+    }
+
+private:
+    static void Produce(std::vector<task>& batch)
+    {
+        if constexpr (Batch == 1)
+        {
+            ring.try_emplace([]() { executed.fetch_add(1, std::memory_order_relaxed); });
+        }
+        else
+        {
+            while (batch.size() < Batch)
+            {
+                batch.emplace_back([]() { executed.fetch_add(1, std::memory_order_relaxed); });
+            }
+            const std::size_t pushed = ring.push_n(batch.begin(), batch.size());
+            batch.erase(batch.begin(), batch.begin() + pushed);
+        }
+    }
+
+    static std::size_t Consume(std::vector<task>& batch)
+    {
+        if constexpr (Batch == 1)
+        {
+            if (std::optional<task> value = ring.try_pop())
+            {
+                (*value)();
+                return 1;
+            }
+            return 0;
+        }
+        else
+        {
+            const std::size_t popped = ring.pop_n(std::back_inserter(batch), Batch);
+            for (auto& value : batch)
+            {
+                value();
+            }
+            batch.clear();
+            return popped;
+        }
+    }
+
+    inline static losync::mpmc_ring<task> ring{RingCapacity};
+    inline static std::atomic<std::int64_t> executed{0};
+};
+
+
+class MutexDequeRing
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const bool producer = state.thread_index() < state.range(0);
+        std::int64_t processed = 0;
+        for (auto _ : state)
+        {
+            if (producer)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (queue.size() < RingCapacity)
+                {
+                    queue.emplace_back([]() { executed.fetch_add(1, std::memory_order_relaxed); });
+                }
+            }
+            else
+            {
+                std::function<void()> value;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!queue.empty())
+                    {
+                        value = std::move(queue.front());
+                        queue.pop_front();
+                    }
+                }
+                if (value)
+                {
+                    value();
+                    ++processed;
+                }
+            }
+        }
+        state.SetItemsProcessed(processed);
+    }
+
+private:
+    inline static std::mutex mutex;
+    inline static std::deque<std::function<void()>> queue;
+    inline static std::atomic<std::int64_t> executed{0};
+};
+
+
+// The thread count depends on both arguments, so every combination is registered separately
+template <typename Ring>
+bool RegisterMatrix(const char* name)
+{
+    for (const int producers : {1, 2, 4})
+    {
+        for (const int consumers : {1, 2, 4})
+        {
+            benchmark::RegisterBenchmark(name, &Ring::Benchmark)
+                ->Args({producers, consumers})
+                ->ArgNames({"producers", "consumers"})
+                ->Threads(producers + consumers)
+                ->UseRealTime();
+        }
+    }
+    return true;
+}
+
+static const bool registered = RegisterMatrix<LosyncMpmcRing<1>>("LosyncMpmcRing<1>") &&
+                               RegisterMatrix<LosyncMpmcRing<16>>("LosyncMpmcRing<16>") &&
+                               RegisterMatrix<MutexDequeRing>("MutexDequeRing");
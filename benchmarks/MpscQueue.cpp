@@ -0,0 +1,106 @@
+#include <losync/mpsc_queue.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+// Every thread posts tasks, thread 0 also plays the role of the consumer and runs them in batches
+class LosyncMpscQueue
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const bool consumer = state.thread_index() == 0;
+        std::int64_t processed = 0;
+        for (auto _ : state)
+        {
+            // 10 tasks per round
+            processed += 10;
+            for (int i = 0; i < 10; ++i)
+            {
+                queue.push([]() { executed.fetch_add(1, std::memory_order_relaxed); });
+            }
+            if (consumer)
+            {
+                queue.run();
+            }
+        }
+        state.SetItemsProcessed(processed);
+
+        if (consumer)
+        {
+            state.PauseTiming();
+            // Producers may still push their last round after the consumer stopped: run leftovers on the next start
+            queue.run();
+            state.ResumeTiming();
+        }
+    }
+
+private:
+    inline static losync::mpsc_queue<> queue;
+    inline static std::atomic<std::int64_t> executed{0};
+};
+
+
+class MutexDequeQueue
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const bool consumer = state.thread_index() == 0;
+        std::deque<std::function<void()>> batch;
+        std::int64_t processed = 0;
+        for (auto _ : state)
+        {
+            // 10 tasks per round
+            processed += 10;
+            for (int i = 0; i < 10; ++i)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.emplace_back([]() { executed.fetch_add(1, std::memory_order_relaxed); });
+            }
+            if (consumer)
+            {
+                Run(batch);
+            }
+        }
+        state.SetItemsProcessed(processed);
+
+        if (consumer)
+        {
+            state.PauseTiming();
+            Run(batch);
+            state.ResumeTiming();
+        }
+    }
+
+private:
+    static void Run(std::deque<std::function<void()>>& batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batch.swap(queue);
+        }
+        for (auto& task : batch)
+        {
+            task();
+        }
+        batch.clear();
+    }
+
+    inline static std::mutex mutex;
+    inline static std::deque<std::function<void()>> queue;
+    inline static std::atomic<std::int64_t> executed{0};
+};
+
+
+BENCHMARK(LosyncMpscQueue::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(MutexDequeQueue::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
@@ -0,0 +1,52 @@
+#include <losync/mutex.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+
+// Critical section of `state.range(0)` dependent multiplications over shared data
+template <typename Mutex>
+class LockUnlock
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const std::int64_t length = state.range(0);
+        for (auto _ : state)
+        {
+            std::lock_guard<Mutex> lock(mutex);
+            for (std::int64_t i = 0; i < length; ++i)
+            {
+                shared.value = shared.value * 6364136223846793005ull + 1;
+            }
+            ++shared.value;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    struct CACHE_ALIGNED Shared
+    {
+        std::uint64_t value = 0;
+    };
+
+    inline static Mutex mutex;
+    inline static Shared shared;
+};
+
+
+BENCHMARK(LockUnlock<losync::mutex>::Benchmark)
+    ->Arg(0)
+    ->Arg(20)
+    ->Arg(200)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(LockUnlock<std::mutex>::Benchmark)
+    ->Arg(0)
+    ->Arg(20)
+    ->Arg(200)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
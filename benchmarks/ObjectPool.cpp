@@ -0,0 +1,176 @@
+#include <losync/mpmc_ring.h>
+#include <losync/object_pool.h>
+#include <losync/pool_allocator.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+
+// Size of a typical queue node or shared state
+struct Message
+{
+    std::uint64_t payload[6];
+};
+
+
+class ObjectPool
+{
+public:
+    static Message* Create()
+    {
+        return pool.create();
+    }
+
+    static void Destroy(Message* const message)
+    {
+        pool.destroy(message);
+    }
+
+private:
+    inline static losync::object_pool<Message> pool;
+};
+
+
+class NewDelete
+{
+public:
+    static Message* Create()
+    {
+        return new Message();
+    }
+
+    static void Destroy(Message* const message)
+    {
+        delete message;
+    }
+};
+
+
+class PoolAllocator
+{
+public:
+    static Message* Create()
+    {
+        return new (losync::pool_allocator::allocate(sizeof(Message))) Message();
+    }
+
+    static void Destroy(Message* const message)
+    {
+        message->~Message();
+        losync::pool_allocator::deallocate(message, sizeof(Message));
+    }
+};
+
+
+// Every thread allocates and frees its own objects. A latency sample is a whole batch.
+template <typename Allocator>
+class LocalChurn
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        constexpr int BatchSize = 64;
+        Message* batch[BatchSize];
+        bench::Harness harness(state, 2 * BatchSize, 1);
+        for (auto _ : state)
+        {
+            harness.Measure([&batch]() {
+                for (Message*& message : batch)
+                {
+                    message = Allocator::Create();
+                }
+                for (Message* const message : batch)
+                {
+                    Allocator::Destroy(message);
+                }
+            });
+        }
+        harness.Finish();
+    }
+};
+
+
+// Producers allocate messages and pass them to their consumers, which free them.
+// A measured operation is one allocation on a producer or one free on a consumer.
+template <typename Allocator>
+class ProducerConsumer
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const bench::RoleAssignment role = bench::AssignRole(state);
+        // Pairs of a producer and a consumer with the same index share a ring
+        losync::mpmc_ring<Message*>& ring = *rings[role.index];
+        bench::Harness harness(state);
+        if (role.role == bench::Role::Producer)
+        {
+            for (auto _ : state)
+            {
+                Message* message = nullptr;
+                harness.Measure([&message]() { message = Allocator::Create(); });
+                message->payload[0] = 1;
+                ring.push(std::move(message));
+            }
+        }
+        else
+        {
+            for (auto _ : state)
+            {
+                Message* const message = ring.pop();
+                benchmark::DoNotOptimize(message->payload[0]);
+                harness.Measure([message]() { Allocator::Destroy(message); });
+            }
+        }
+        harness.Finish();
+    }
+
+    static void Setup(const benchmark::State& state)
+    {
+        for (int i = 0; i < state.threads() / 2; ++i)
+        {
+            rings[i].emplace(RingCapacity);
+        }
+    }
+
+    static void Teardown(const benchmark::State& state)
+    {
+        for (int i = 0; i < state.threads() / 2; ++i)
+        {
+            rings[i].reset();
+        }
+    }
+
+private:
+    static constexpr int MaxPairs = 128;
+    static constexpr std::size_t RingCapacity = 256;
+
+    inline static std::optional<losync::mpmc_ring<Message*>> rings[MaxPairs];
+};
+
+
+BENCHMARK(LocalChurn<ObjectPool>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(LocalChurn<NewDelete>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(LocalChurn<PoolAllocator>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+
+BENCHMARK(ProducerConsumer<ObjectPool>::Benchmark)
+    ->Setup(ProducerConsumer<ObjectPool>::Setup)
+    ->Teardown(ProducerConsumer<ObjectPool>::Teardown)
+    ->ThreadRange(2, 4 * std::thread::hardware_concurrency())
+    ->UseRealTime();
+BENCHMARK(ProducerConsumer<NewDelete>::Benchmark)
+    ->Setup(ProducerConsumer<NewDelete>::Setup)
+    ->Teardown(ProducerConsumer<NewDelete>::Teardown)
+    ->ThreadRange(2, 4 * std::thread::hardware_concurrency())
+    ->UseRealTime();
+BENCHMARK(ProducerConsumer<PoolAllocator>::Benchmark)
+    ->Setup(ProducerConsumer<PoolAllocator>::Setup)
+    ->Teardown(ProducerConsumer<PoolAllocator>::Teardown)
+    ->ThreadRange(2, 4 * std::thread::hardware_concurrency())
+    ->UseRealTime();
@@ -0,0 +1,192 @@
+#include <losync/rcu_cell.h>
+#include <losync/seqlock.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+struct Config
+{
+    std::uint64_t version = 0;
+    std::uint64_t payload[7] = {};
+};
+
+
+struct RcuCellConfig
+{
+    losync::rcu_cell<Config> cell;
+
+    std::uint64_t Read()
+    {
+        const auto guard = cell.read();
+        return guard->version + guard->payload[3];
+    }
+
+    void Write(const std::uint64_t version)
+    {
+        cell.update([version](Config& config) { config.version = version; });
+    }
+};
+
+
+struct SeqlockConfig
+{
+    losync::seqlock<Config> value;
+
+    std::uint64_t Read()
+    {
+        const Config config = value.load();
+        return config.version + config.payload[3];
+    }
+
+    void Write(const std::uint64_t version)
+    {
+        Config config;
+        config.version = version;
+        value.store(config);
+    }
+};
+
+
+// std::atomic<std::shared_ptr> appears in C++20, the free functions are the same lock-based implementation in libstdc++
+struct AtomicSharedPtrConfig
+{
+    std::shared_ptr<const Config> current = std::make_shared<Config>();
+
+    std::uint64_t Read()
+    {
+        const auto config = std::atomic_load_explicit(&current, std::memory_order_acquire);
+        return config->version + config->payload[3];
+    }
+
+    void Write(const std::uint64_t version)
+    {
+        auto config = std::make_shared<Config>();
+        config->version = version;
+        std::atomic_store_explicit(&current, std::shared_ptr<const Config>(std::move(config)),
+                                   std::memory_order_release);
+    }
+};
+
+
+struct MutexSharedPtrConfig
+{
+    std::mutex mutex;
+    std::shared_ptr<const Config> current = std::make_shared<Config>();
+
+    std::uint64_t Read()
+    {
+        std::shared_ptr<const Config> config;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            config = current;
+        }
+        return config->version + config->payload[3];
+    }
+
+    void Write(const std::uint64_t version)
+    {
+        auto config = std::make_shared<Config>();
+        config->version = version;
+        std::lock_guard<std::mutex> lock(mutex);
+        current = std::move(config);
+    }
+};
+
+
+// All threads read. With `state.range(0)` != 0 thread 0 also publishes a new version every `state.range(0)`-th round.
+template <typename Holder>
+class ReadLatency
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const std::int64_t writePeriod = state.thread_index() == 0 ? state.range(0) : 0;
+        std::int64_t round = 0;
+        std::uint64_t sum = 0;
+        for (auto _ : state)
+        {
+            if (writePeriod != 0 && ++round % writePeriod == 0)
+            {
+                holder.Write(static_cast<std::uint64_t>(round));
+            }
+            else
+            {
+                sum += holder.Read();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    inline static Holder holder;
+};
+
+
+// Every iteration publishes a version and waits until a polling reader thread reports that it saw it
+template <typename Holder>
+void UpdateVisibility(benchmark::State& state)
+{
+    Holder holder;
+    std::atomic<std::uint64_t> seen{0};
+    std::atomic<bool> stop{false};
+    std::thread reader([&]() {
+        std::uint64_t last = 0;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            const std::uint64_t version = holder.Read();
+            if (version != last)
+            {
+                last = version;
+                seen.store(version, std::memory_order_release);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::uint64_t version = 0;
+    for (auto _ : state)
+    {
+        holder.Write(++version);
+        while (seen.load(std::memory_order_acquire) != version)
+        {
+            std::this_thread::yield();
+        }
+    }
+    stop.store(true, std::memory_order_relaxed);
+    reader.join();
+}
+
+
+BENCHMARK(ReadLatency<RcuCellConfig>::Benchmark)
+    ->Arg(0)
+    ->Arg(1000)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(ReadLatency<SeqlockConfig>::Benchmark)
+    ->Arg(0)
+    ->Arg(1000)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(ReadLatency<AtomicSharedPtrConfig>::Benchmark)
+    ->Arg(0)
+    ->Arg(1000)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(ReadLatency<MutexSharedPtrConfig>::Benchmark)
+    ->Arg(0)
+    ->Arg(1000)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+
+BENCHMARK(UpdateVisibility<RcuCellConfig>)->UseRealTime();
+BENCHMARK(UpdateVisibility<SeqlockConfig>)->UseRealTime();
+BENCHMARK(UpdateVisibility<AtomicSharedPtrConfig>)->UseRealTime();
+BENCHMARK(UpdateVisibility<MutexSharedPtrConfig>)->UseRealTime();
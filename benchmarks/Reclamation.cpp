@@ -0,0 +1,148 @@
+#include <losync/reclamation.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+
+struct Node
+{
+    std::uint64_t value;
+    Node* next;
+    std::uint64_t payload[6];
+};
+
+
+// Treiber stack whose popped nodes are reclaimed by `Scheme`
+template <typename Scheme>
+class ReclaimedStack
+{
+public:
+    void Push(Node* node)
+    {
+        node->next = top.load(std::memory_order_relaxed);
+        while (!top.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Pop()
+    {
+        Node* node = nullptr;
+        if constexpr (std::is_same<Scheme, losync::ebr>::value)
+        {
+            losync::ebr::guard guard;
+            node = top.load(std::memory_order_acquire);
+            while (node != nullptr && !top.compare_exchange_weak(node, node->next, std::memory_order_acquire))
+            {
+            }
+        }
+        else
+        {
+            losync::hazard_pointers::holder holder;
+            for (;;)
+            {
+                node = holder.protect(top);
+                Node* expected = node;
+                if (node == nullptr || top.compare_exchange_strong(expected, node->next, std::memory_order_acquire))
+                {
+                    break;
+                }
+            }
+        }
+        if (node != nullptr)
+        {
+            Scheme::retire(node);
+        }
+    }
+
+    static std::int64_t Unreclaimed()
+    {
+        return Scheme::unreclaimed();
+    }
+
+private:
+    std::atomic<Node*> top{nullptr};
+};
+
+
+// Objects are deleted under the lock, nothing is ever unreclaimed
+class MutexStack
+{
+public:
+    void Push(Node* node)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        node->next = top;
+        top = node;
+    }
+
+    void Pop()
+    {
+        Node* node = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            node = top;
+            if (node != nullptr)
+            {
+                top = node->next;
+            }
+        }
+        delete node;
+    }
+
+    static std::int64_t Unreclaimed()
+    {
+        return 0;
+    }
+
+private:
+    std::mutex mutex;
+    Node* top = nullptr;
+};
+
+
+// Every round pushes a new node and pops one, so every round retires an object.
+// Thread 0 samples the number of retired but not yet destroyed objects.
+template <typename Stack>
+class PushPop
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const bool sampler = state.thread_index() == 0;
+        std::int64_t round = 0;
+        std::int64_t peak = 0;
+        for (auto _ : state)
+        {
+            stack.Push(new Node{});
+            stack.Pop();
+            if (sampler && ++round % 256 == 0)
+            {
+                peak = std::max(peak, Stack::Unreclaimed());
+            }
+        }
+        state.SetItemsProcessed(state.iterations());
+        if (sampler)
+        {
+            state.counters["PeakUnreclaimed"] = static_cast<double>(peak);
+            state.counters["PeakUnreclaimedBytes"] = static_cast<double>(peak * sizeof(Node));
+        }
+    }
+
+private:
+    inline static Stack stack;
+};
+
+
+BENCHMARK(PushPop<ReclaimedStack<losync::ebr>>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(PushPop<ReclaimedStack<losync::hazard_pointers>>::Benchmark)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(PushPop<MutexStack>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
@@ -1,11 +1,11 @@
-#include <losync/cheap_function.h>
+#include <losync/batched_counter.h>
+#include <losync/sharded_counter.h>
 
 #include "BenchCommon.h"
 
 #include <benchmark/benchmark.h>
 
 #include <atomic>
-#include <cassert>
 #include <cstdint>
 #include <new>
 #include <thread>
@@ -20,23 +20,24 @@ public:
         {
             counter = 0;
         }
-        std::int64_t processed = 0;
+        // 10 operations per round
+        bench::Harness harness(state, 10);
         for (auto _ : state)
         {
-            // 10 operations per round
-            processed += 10;
-            ++counter;
-            ++counter;
-            ++counter;
-            ++counter;
-            ++counter;
-            ++counter;
-            ++counter;
-            ++counter;
-            ++counter;
-            ++counter;
+            harness.Measure([]() {
+                ++counter;
+                ++counter;
+                ++counter;
+                ++counter;
+                ++counter;
+                ++counter;
+                ++counter;
+                ++counter;
+                ++counter;
+                ++counter;
+            });
         }
-        state.SetItemsProcessed(processed);
+        harness.Finish();
     }
 
 private:
@@ -44,129 +45,243 @@ private:
 };
 
 
-class CounterBase
+// Upper bound of sharded counters: every benchmark thread owns its cell and never looks it up
+class IdealShardedCounter
 {
-protected:
-    inline static const thread_local size_t threadUniqueId = std::hash<std::thread::id>{}(std::this_thread::get_id());
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        Counter& counter = counters[state.thread_index() % ShardSize];
+        counter.cnt = 0;
 
+        // 10 operations per round
+        bench::Harness harness(state, 10);
+        for (auto _ : state)
+        {
+            harness.Measure([&counter]() {
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+                ++counter.cnt;
+            });
+        }
+        harness.Finish();
+    }
+
+private:
     struct CACHE_ALIGNED Counter
     {
-        std::atomic<unsigned> cnt = 0;
+        std::atomic<unsigned> cnt{0};
     };
 
     static constexpr size_t ShardSize = 256 * 32;
-    inline static Counter counters[ShardSize];
-    inline static const size_t ShardActualSize = std::thread::hardware_concurrency() * 16 + 1;
+    static Counter counters[ShardSize];
 };
 
+IdealShardedCounter::Counter IdealShardedCounter::counters[ShardSize];
 
-class IdealShardedCounter : private CounterBase
+
+// The shard of the thread is looked up once before the loop
+class SimplifiedShardedCounter
 {
 public:
     static void Benchmark(benchmark::State& state)
     {
-        Counter& counter = counters[state.thread_index() % ShardSize];
-        counter.cnt = 0;
+        if (state.thread_index() == 0)
+        {
+            counter.reset();
+        }
+        auto shard = counter.local();
 
-        std::int64_t processed = 0;
+        // 10 operations per round
+        bench::Harness harness(state, 10);
         for (auto _ : state)
         {
-            // 10 operations per round
-            processed += 10;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
+            harness.Measure([&shard]() {
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+            });
         }
-        state.SetItemsProcessed(processed);
+        harness.Finish();
     }
+
+private:
+    inline static losync::sharded_counter counter;
 };
 
 
-class SimplifiedShardedCounter : private CounterBase
+// The shard of the thread is looked up on every increment
+class ShardedCounter
 {
 public:
+    NOINLINE static void Inc()
+    {
+        counter.add();
+    }
+
     static void Benchmark(benchmark::State& state)
     {
-        assert(ShardActualSize <= ShardSize);
-        const auto threadIdHash = std::hash<std::thread::id>{}(std::this_thread::get_id());
-        const size_t shardIndex = threadIdHash % ShardActualSize;
-        Counter& counter = counters[shardIndex];
-        counter.cnt = 0;
+        if (state.thread_index() == 0)
+        {
+            counter.reset();
+        }
 
-        std::int64_t processed = 0;
+        // 10 operations per round
+        bench::Harness harness(state, 10);
         for (auto _ : state)
         {
-            // 10 operations per round
-            processed += 10;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
-            ++counter.cnt;
+            harness.Measure([]() {
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+            });
         }
-        state.SetItemsProcessed(processed);
+        harness.Finish();
     }
+
+private:
+    inline static losync::sharded_counter counter;
 };
 
 
-class ShardedCounter : private CounterBase
+// The cell of the thread is looked up once, additions are published every 256 of them
+class SimplifiedBatchedCounter
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        if (state.thread_index() == 0)
+        {
+            counter.reset();
+        }
+        auto shard = counter.local();
+
+        // 10 operations per round
+        bench::Harness harness(state, 10);
+        for (auto _ : state)
+        {
+            harness.Measure([&shard]() {
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+                shard.add();
+            });
+        }
+        harness.Finish();
+    }
+
+private:
+    inline static losync::batched_counter counter;
+};
+
+
+// The cell of the thread is looked up on every increment
+class BatchedCounter
 {
 public:
     NOINLINE static void Inc()
     {
-        ++counters[threadUniqueId % ShardActualSize].cnt;
+        counter.add();
     }
 
     static void Benchmark(benchmark::State& state)
     {
-        assert(ShardActualSize <= ShardSize);
-        counters[threadUniqueId % ShardActualSize].cnt = 0;
+        if (state.thread_index() == 0)
+        {
+            counter.reset();
+        }
 
-        std::int64_t processed = 0;
+        // 10 operations per round
+        bench::Harness harness(state, 10);
         for (auto _ : state)
         {
-            // 10 operations per round
-            processed += 10;
-            Inc();
-            Inc();
-            Inc();
-            Inc();
-            Inc();
-            Inc();
-            Inc();
-            Inc();
-            Inc();
-            Inc();
+            harness.Measure([]() {
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+                Inc();
+            });
         }
-        state.SetItemsProcessed(processed);
+        harness.Finish();
     }
+
+private:
+    inline static losync::batched_counter counter;
 };
 
 
+// Cost of reading a counter while other threads increment it, latencies are of the reads only
+template <bool Exact>
+class BatchedCounterRead
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        bench::Harness harness(state);
+        if (state.thread_index() != 0)
+        {
+            auto shard = counter.local();
+            for (auto _ : state)
+            {
+                shard.add();
+            }
+        }
+        else
+        {
+            for (auto _ : state)
+            {
+                harness.Measure([]() {
+                    benchmark::DoNotOptimize(Exact ? counter.read() : counter.read_approximate());
+                });
+            }
+        }
+        harness.Finish();
+    }
+
+private:
+    inline static losync::batched_counter counter;
+};
+
+
+BENCHMARK(BatchedCounter::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(SimplifiedBatchedCounter::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
 BENCHMARK(ShardedCounter::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
 BENCHMARK(SimplifiedShardedCounter::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
 BENCHMARK(IdealShardedCounter::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
 BENCHMARK(NaiveCounter::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
 
-#if 0
-#ifdef WIN32
-#include <windows.h>
-
-const bool affinity = []()
-{
-    return !!SetProcessAffinityMask(GetCurrentProcess(), 0x0FFFF);
-}();
-#endif
-#endif
+BENCHMARK(BatchedCounterRead<true>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(BatchedCounterRead<false>::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
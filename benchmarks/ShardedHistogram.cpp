@@ -0,0 +1,77 @@
+#include <losync/sharded_histogram.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <thread>
+
+
+// Recorded values look like latencies: mostly small with a long tail
+NOINLINE std::uint64_t NextValue(std::uint64_t& seed)
+{
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return (seed >> 40) >> ((seed >> 20) & 15);
+}
+
+
+// Every thread records through its own shard
+class LosyncShardedHistogram
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        auto shard = histogram.local();
+        std::uint64_t seed = state.thread_index();
+        std::int64_t processed = 0;
+        for (auto _ : state)
+        {
+            // 10 records per round
+            processed += 10;
+            for (int i = 0; i < 10; ++i)
+            {
+                shard.record(NextValue(seed));
+            }
+        }
+        state.SetItemsProcessed(processed);
+
+        if (state.thread_index() == 0)
+        {
+            const auto snapshot = histogram.read();
+            state.counters["p99"] = static_cast<double>(snapshot.p99());
+        }
+    }
+
+private:
+    inline static losync::sharded_histogram histogram;
+};
+
+
+// The same buckets shared by all threads
+class SharedHistogram
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        std::uint64_t seed = state.thread_index();
+        std::int64_t processed = 0;
+        for (auto _ : state)
+        {
+            // 10 records per round
+            processed += 10;
+            for (int i = 0; i < 10; ++i)
+            {
+                histogram.record(NextValue(seed));
+            }
+        }
+        state.SetItemsProcessed(processed);
+    }
+
+private:
+    inline static losync::sharded_histogram histogram{1};
+};
+
+
+BENCHMARK(LosyncShardedHistogram::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(SharedHistogram::Benchmark)->ThreadRange(1, 4 * std::thread::hardware_concurrency());
@@ -0,0 +1,55 @@
+#include <losync/shared_mutex.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+
+// Readers look up a small table. With `state.range(0)` != 0 thread 0 also writes every `state.range(0)`-th round.
+template <typename SharedMutex>
+class ReadMostly
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const std::int64_t writePeriod = state.thread_index() == 0 ? state.range(0) : 0;
+        std::int64_t round = 0;
+        std::uint64_t sum = 0;
+        for (auto _ : state)
+        {
+            if (writePeriod != 0 && ++round % writePeriod == 0)
+            {
+                std::lock_guard<SharedMutex> lock(mutex);
+                ++table[round % TableSize];
+            }
+            else
+            {
+                std::shared_lock<SharedMutex> lock(mutex);
+                sum += table[round % TableSize];
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    static constexpr std::int64_t TableSize = 16;
+
+    inline static SharedMutex mutex;
+    inline static std::uint64_t table[TableSize] = {};
+};
+
+
+BENCHMARK(ReadMostly<losync::shared_mutex>::Benchmark)
+    ->Arg(0)
+    ->Arg(1000)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
+BENCHMARK(ReadMostly<std::shared_mutex>::Benchmark)
+    ->Arg(0)
+    ->Arg(1000)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency());
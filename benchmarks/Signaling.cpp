@@ -0,0 +1,299 @@
+#include <losync/barrier.h>
+#include <losync/event.h>
+#include <losync/semaphore.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+
+// Reference implementations with a mutex and a condition variable
+
+class CvEvent
+{
+public:
+    explicit CvEvent(const losync::event_reset reset) : autoReset(reset == losync::event_reset::automatic)
+    {
+    }
+
+    void set()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            flag = true;
+        }
+        if (autoReset)
+        {
+            condition.notify_one();
+        }
+        else
+        {
+            condition.notify_all();
+        }
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        flag = false;
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return flag; });
+        if (autoReset)
+        {
+            flag = false;
+        }
+    }
+
+private:
+    const bool autoReset;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool flag = false;
+};
+
+
+class CvSemaphore
+{
+public:
+    explicit CvSemaphore(const std::uint32_t desired) : count(desired)
+    {
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++count;
+        }
+        condition.notify_one();
+    }
+
+    void acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return count != 0; });
+        --count;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::uint32_t count;
+};
+
+
+class CvBarrier
+{
+public:
+    explicit CvBarrier(const std::uint32_t expected) : expected(expected), remaining(expected)
+    {
+    }
+
+    bool arrive_and_wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (--remaining == 0)
+        {
+            remaining = expected;
+            ++phase;
+            lock.unlock();
+            condition.notify_all();
+            return true;
+        }
+        const std::uint64_t current = phase;
+        condition.wait(lock, [this, current]() { return phase != current; });
+        return false;
+    }
+
+private:
+    const std::uint32_t expected;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::uint32_t remaining;
+    std::uint64_t phase = 0;
+};
+
+
+// Signal throughput without waiters: nobody ever sleeps on the event
+template <typename Event>
+class SetReset
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            event.set();
+            event.reset();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    inline static Event event{losync::event_reset::manual};
+};
+
+
+// Signal throughput without waiters: the count never drops to zero
+template <typename Semaphore>
+class ReleaseAcquire
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            semaphore.release();
+            semaphore.acquire();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    inline static Semaphore semaphore{1};
+};
+
+
+// Wake-up latency: two threads pass the turn to each other with automatic-reset events,
+// an iteration is a round trip of two wake-ups
+template <typename Event>
+class PingPong
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const bool first = state.thread_index() == 0;
+        Event& mine = first ? pong : ping;
+        Event& other = first ? ping : pong;
+        for (auto _ : state)
+        {
+            if (first)
+            {
+                other.set();
+                mine.wait();
+            }
+            else
+            {
+                mine.wait();
+                other.set();
+            }
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    inline static Event ping{losync::event_reset::automatic};
+    inline static Event pong{losync::event_reset::automatic};
+};
+
+
+// Signal throughput with waiters: a token goes around a ring of threads, each waits on its own semaphore.
+// Every round leaves the token with thread 0, where it starts.
+template <typename Semaphore>
+class TokenRing
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const int index = state.thread_index();
+        Semaphore& mine = *ring[index];
+        Semaphore& next = *ring[(index + 1) % state.threads()];
+        for (auto _ : state)
+        {
+            mine.acquire();
+            next.release();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    static void Setup(const benchmark::State& state)
+    {
+        for (int i = 0; i < state.threads(); ++i)
+        {
+            ring[i].emplace(i == 0 ? 1 : 0);
+        }
+    }
+
+    static void Teardown(const benchmark::State& state)
+    {
+        for (int i = 0; i < state.threads(); ++i)
+        {
+            ring[i].reset();
+        }
+    }
+
+private:
+    static constexpr int MaxThreads = 256;
+
+    inline static std::optional<Semaphore> ring[MaxThreads];
+};
+
+
+// Phase throughput: all threads meet at the barrier in every iteration
+template <typename Barrier>
+class Rendezvous
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(sync->arrive_and_wait());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    static void Setup(const benchmark::State& state)
+    {
+        sync.emplace(static_cast<std::uint32_t>(state.threads()));
+    }
+
+    static void Teardown(const benchmark::State&)
+    {
+        sync.reset();
+    }
+
+private:
+    inline static std::optional<Barrier> sync;
+};
+
+
+BENCHMARK(SetReset<losync::event>::Benchmark);
+BENCHMARK(SetReset<CvEvent>::Benchmark);
+BENCHMARK(ReleaseAcquire<losync::counting_semaphore>::Benchmark);
+BENCHMARK(ReleaseAcquire<CvSemaphore>::Benchmark);
+
+BENCHMARK(PingPong<losync::event>::Benchmark)->Threads(2)->UseRealTime();
+BENCHMARK(PingPong<CvEvent>::Benchmark)->Threads(2)->UseRealTime();
+
+BENCHMARK(TokenRing<losync::counting_semaphore>::Benchmark)
+    ->Setup(TokenRing<losync::counting_semaphore>::Setup)
+    ->Teardown(TokenRing<losync::counting_semaphore>::Teardown)
+    ->ThreadRange(2, 4 * std::thread::hardware_concurrency())
+    ->UseRealTime();
+BENCHMARK(TokenRing<CvSemaphore>::Benchmark)
+    ->Setup(TokenRing<CvSemaphore>::Setup)
+    ->Teardown(TokenRing<CvSemaphore>::Teardown)
+    ->ThreadRange(2, 4 * std::thread::hardware_concurrency())
+    ->UseRealTime();
+
+BENCHMARK(Rendezvous<losync::barrier>::Benchmark)
+    ->Setup(Rendezvous<losync::barrier>::Setup)
+    ->Teardown(Rendezvous<losync::barrier>::Teardown)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency())
+    ->UseRealTime();
+BENCHMARK(Rendezvous<CvBarrier>::Benchmark)
+    ->Setup(Rendezvous<CvBarrier>::Setup)
+    ->Teardown(Rendezvous<CvBarrier>::Teardown)
+    ->ThreadRange(1, 4 * std::thread::hardware_concurrency())
+    ->UseRealTime();
@@ -0,0 +1,166 @@
+#include <losync/mpmc_ring.h>
+#include <losync/spsc_ring.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <thread>
+
+
+constexpr std::size_t RingCapacity = 1024;
+
+
+struct SpscPushPop
+{
+    losync::spsc_ring<std::uint64_t> ring{RingCapacity};
+
+    bool Push(const std::uint64_t value)
+    {
+        return ring.try_push(std::uint64_t{value});
+    }
+
+    std::optional<std::uint64_t> Pop()
+    {
+        return ring.try_pop();
+    }
+};
+
+
+struct MpmcPushPop
+{
+    losync::mpmc_ring<std::uint64_t> ring{RingCapacity};
+
+    bool Push(const std::uint64_t value)
+    {
+        return ring.try_push(std::uint64_t{value});
+    }
+
+    std::optional<std::uint64_t> Pop()
+    {
+        return ring.try_pop();
+    }
+};
+
+
+// Thread 0 produces, thread 1 consumes. A round moves one element, or up to `Batch` elements
+// through `reserve`/`commit` and `peek`/`consume`. Items are the consumed elements.
+template <typename Ring, std::size_t Batch = 1>
+class Throughput
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const bool producer = state.thread_index() == 0;
+        std::uint64_t next = 0;
+        std::int64_t processed = 0;
+        for (auto _ : state)
+        {
+            if (producer)
+            {
+                next += Produce(next);
+            }
+            else
+            {
+                processed += static_cast<std::int64_t>(Consume());
+            }
+        }
+        state.SetItemsProcessed(processed);
+    }
+
+private:
+    static std::size_t Produce(const std::uint64_t next)
+    {
+        if constexpr (Batch == 1)
+        {
+            return ring.Push(next) ? 1 : 0;
+        }
+        else
+        {
+            const auto free = ring.ring.reserve(Batch);
+            for (std::size_t i = 0; i < free.size; ++i)
+            {
+                new (free.data + i) std::uint64_t(next + i);
+            }
+            ring.ring.commit(free.size);
+            return free.size;
+        }
+    }
+
+    static std::size_t Consume()
+    {
+        if constexpr (Batch == 1)
+        {
+            if (const auto value = ring.Pop())
+            {
+                benchmark::DoNotOptimize(*value);
+                return 1;
+            }
+            return 0;
+        }
+        else
+        {
+            const auto ready = ring.ring.peek(Batch);
+            for (std::size_t i = 0; i < ready.size; ++i)
+            {
+                benchmark::DoNotOptimize(ready.data[i]);
+            }
+            ring.ring.consume(ready.size);
+            return ready.size;
+        }
+    }
+
+    inline static Ring ring;
+};
+
+
+// Every iteration sends a value to an echo thread and waits until it comes back through the second ring
+template <typename Ring>
+void PingPong(benchmark::State& state)
+{
+    Ring ping;
+    Ring pong;
+    std::atomic<bool> stop{false};
+    std::thread echo([&]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (const auto value = ping.Pop())
+            {
+                while (!pong.Push(*value))
+                {
+                }
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::uint64_t next = 0;
+    for (auto _ : state)
+    {
+        ping.Push(next);
+        std::optional<std::uint64_t> value;
+        while (!(value = pong.Pop()))
+        {
+            std::this_thread::yield();
+        }
+        benchmark::DoNotOptimize(*value);
+        ++next;
+    }
+    stop.store(true, std::memory_order_relaxed);
+    echo.join();
+}
+
+
+BENCHMARK(Throughput<SpscPushPop>::Benchmark)->Threads(2)->UseRealTime();
+BENCHMARK(Throughput<SpscPushPop, 64>::Benchmark)->Threads(2)->UseRealTime();
+BENCHMARK(Throughput<MpmcPushPop>::Benchmark)->Threads(2)->UseRealTime();
+BENCHMARK(PingPong<SpscPushPop>)->UseRealTime();
+BENCHMARK(PingPong<MpmcPushPop>)->UseRealTime();
@@ -0,0 +1,116 @@
+#include <losync/mutex.h>
+#include <losync/strand.h>
+#include <losync/thread_pool.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+// Messages posted per iteration, spread round-robin over the objects
+constexpr int MessagesPerRound = 100000;
+
+
+struct LOSYNC_CACHE_ALIGNED Object
+{
+    std::uint64_t state = 0;
+};
+
+NOINLINE static void Handle(Object& object)
+{
+    object.state = object.state * 31 + 1;
+}
+
+
+// Every object has a strand, its messages run in order without a lock
+class StrandPerObject
+{
+public:
+    StrandPerObject(thread_pool& pool, const std::size_t count) : objects(count)
+    {
+        strands.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            strands.push_back(std::make_unique<strand>(pool));
+        }
+    }
+
+    void Post(const std::size_t index, std::atomic<int>& done)
+    {
+        strands[index]->post([&object = objects[index], &done]() {
+            Handle(object);
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+private:
+    std::vector<Object> objects;
+    std::vector<std::unique_ptr<strand>> strands;
+};
+
+
+// Every message is a pool task which locks its object: no ordering, and workers block on busy objects
+class MutexPerObject
+{
+public:
+    MutexPerObject(thread_pool& pool, const std::size_t count) : pool(pool), objects(count), mutexes(count)
+    {
+    }
+
+    void Post(const std::size_t index, std::atomic<int>& done)
+    {
+        pool.submit([&object = objects[index], &mutex = mutexes[index], &done]() {
+            {
+                std::lock_guard<losync::mutex> lock(mutex);
+                Handle(object);
+            }
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+private:
+    thread_pool& pool;
+    std::vector<Object> objects;
+    std::vector<losync::mutex> mutexes;
+};
+
+
+template <typename Objects>
+class Throughput
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const std::size_t count = static_cast<std::size_t>(state.range(0));
+        thread_pool pool(std::thread::hardware_concurrency());
+        Objects objects(pool, count);
+        std::atomic<int> done{0};
+        for (auto _ : state)
+        {
+            done.store(0, std::memory_order_relaxed);
+            for (int i = 0; i < MessagesPerRound; ++i)
+            {
+                objects.Post(static_cast<std::size_t>(i) % count, done);
+            }
+            while (done.load(std::memory_order_acquire) != MessagesPerRound)
+            {
+                std::this_thread::yield();
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * MessagesPerRound);
+    }
+};
+
+
+BENCHMARK(Throughput<StrandPerObject>::Benchmark)->RangeMultiplier(10)->Range(1, 100000)->UseRealTime();
+BENCHMARK(Throughput<MutexPerObject>::Benchmark)->RangeMultiplier(10)->Range(1, 100000)->UseRealTime();
@@ -0,0 +1,132 @@
+// The coroutine support needs C++20, see LOSYNC_ENABLE_CXX20
+#if defined(__cpp_impl_coroutine)
+
+#include <losync/cheap_function.h>
+#include <losync/task.h>
+#include <losync/thread_pool.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+
+using namespace losync;
+
+
+// The work of a coroutine or a callback: a call which is not inlined
+NOINLINE static int Work(const int value)
+{
+    return value + 1;
+}
+
+
+class Coroutine
+{
+public:
+    static task<int> Child(const int value)
+    {
+        co_return Work(value);
+    }
+
+    // A child task is created, started and finished, its frame comes from the pool and back
+    static void Call(benchmark::State& state)
+    {
+        auto body = [&state]() -> task<> {
+            int value = 0;
+            for (auto _ : state)
+            {
+                value = co_await Child(value);
+            }
+            benchmark::DoNotOptimize(value);
+        };
+        sync_wait(body());
+    }
+
+    static void Post(thread_pool& pool, std::atomic<int>& done, const int count)
+    {
+        auto child = [&done]() -> task<> {
+            Work(0);
+            done.fetch_add(1, std::memory_order_release);
+            co_return;
+        };
+        for (int i = 0; i < count; ++i)
+        {
+            spawn(pool, child());
+        }
+    }
+};
+
+
+class Callback
+{
+public:
+    static void Call(benchmark::State& state)
+    {
+        int value = 0;
+        for (auto _ : state)
+        {
+            const cheap_function<int(int)> child([](const int current) { return Work(current); });
+            value = child(value);
+        }
+        benchmark::DoNotOptimize(value);
+    }
+
+    static void Post(thread_pool& pool, std::atomic<int>& done, const int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            pool.submit([&done]() {
+                Work(0);
+                done.fetch_add(1, std::memory_order_release);
+            });
+        }
+    }
+};
+
+
+template <typename Kind>
+class Call
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        Kind::Call(state);
+        state.SetItemsProcessed(state.iterations());
+    }
+};
+
+
+// A batch of coroutines or callbacks is posted to a worker and the poster waits until all of them run
+template <typename Kind>
+class Post
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        const int batch = static_cast<int>(state.range(0));
+        thread_pool pool(1);
+        std::atomic<int> done{0};
+        for (auto _ : state)
+        {
+            done.store(0, std::memory_order_relaxed);
+            Kind::Post(pool, done, batch);
+            while (done.load(std::memory_order_acquire) != batch)
+            {
+                std::this_thread::yield();
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * batch);
+    }
+};
+
+
+BENCHMARK(Call<Coroutine>::Benchmark);
+BENCHMARK(Call<Callback>::Benchmark);
+BENCHMARK(Post<Coroutine>::Benchmark)->Arg(256)->UseRealTime();
+BENCHMARK(Post<Callback>::Benchmark)->Arg(256)->UseRealTime();
+
+#endif
@@ -0,0 +1,172 @@
+#include <losync/thread_pool.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Baseline: one deque of std::function protected by a mutex, workers sleep on a condition variable
+class NaivePool
+{
+public:
+    explicit NaivePool(const std::size_t threads)
+    {
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~NaivePool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+    template <typename F>
+    void parallel_for(const std::size_t begin, const std::size_t end, F&& body, const std::size_t grain)
+    {
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        std::size_t remaining = (end - begin + grain - 1) / grain;
+        for (std::size_t from = begin; from < end; from += grain)
+        {
+            const std::size_t to = std::min(end, from + grain);
+            submit([&, from, to]() {
+                for (std::size_t i = from; i < to; ++i)
+                {
+                    body(i);
+                }
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (--remaining == 0)
+                {
+                    doneCondition.notify_one();
+                }
+            });
+        }
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [&remaining]() { return remaining == 0; });
+    }
+
+private:
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+
+// Blocks until `count` tasks report completion
+class Completion
+{
+public:
+    void Reset(const std::int64_t count)
+    {
+        remaining.store(count);
+    }
+
+    void Done()
+    {
+        remaining.fetch_sub(1, std::memory_order_release);
+    }
+
+    void Wait() const
+    {
+        while (remaining.load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    std::atomic<std::int64_t> remaining{0};
+};
+
+
+constexpr std::size_t ForkJoinItems = 1000;
+constexpr std::int64_t SmallTasks = 10000;
+
+template <typename Pool>
+static void ForkJoin(benchmark::State& state)
+{
+    Pool pool(static_cast<std::size_t>(state.range(0)));
+    std::vector<int> data(ForkJoinItems, 1);
+    for (auto _ : state)
+    {
+        pool.parallel_for(
+            0, data.size(), [&data](std::size_t i) { benchmark::DoNotOptimize(data[i] += 1); }, 16);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Pool>
+static void SmallTaskThroughput(benchmark::State& state)
+{
+    Pool pool(static_cast<std::size_t>(state.range(0)));
+    Completion completion;
+    for (auto _ : state)
+    {
+        completion.Reset(SmallTasks);
+        for (std::int64_t i = 0; i < SmallTasks; ++i)
+        {
+            pool.submit([&completion]() { completion.Done(); });
+        }
+        completion.Wait();
+    }
+    state.SetItemsProcessed(state.iterations() * SmallTasks);
+}
+
+static void PoolSizes(benchmark::internal::Benchmark* bench)
+{
+    bench->RangeMultiplier(2)->Range(1, 4 * std::thread::hardware_concurrency())->UseRealTime();
+}
+
+BENCHMARK(ForkJoin<losync::thread_pool>)->Apply(PoolSizes);
+BENCHMARK(ForkJoin<NaivePool>)->Apply(PoolSizes);
+BENCHMARK(SmallTaskThroughput<losync::thread_pool>)->Apply(PoolSizes);
+BENCHMARK(SmallTaskThroughput<NaivePool>)->Apply(PoolSizes);
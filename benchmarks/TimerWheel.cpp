@@ -0,0 +1,159 @@
+#include <losync/timer_wheel.h>
+
+#include "BenchCommon.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+
+// Time is simulated, one tick is a millisecond
+const std::chrono::steady_clock::time_point Start{};
+
+
+class LosyncTimerWheel
+{
+public:
+    using Id = losync::timer_wheel::timer_id;
+
+    NOINLINE Id Schedule(const std::int64_t tick, std::uint64_t& counter)
+    {
+        return wheel.schedule(Start + std::chrono::milliseconds(tick), [&counter]() { ++counter; });
+    }
+
+    NOINLINE void Cancel(const Id id)
+    {
+        wheel.cancel(id);
+    }
+
+    NOINLINE std::size_t Advance(const std::int64_t tick)
+    {
+        return wheel.advance(Start + std::chrono::milliseconds(tick));
+    }
+
+private:
+    losync::timer_wheel wheel{std::chrono::milliseconds(1), Start};
+};
+
+
+// A binary heap of `std::function` with lazy cancellation, the usual baseline
+class PriorityQueueTimers
+{
+public:
+    using Id = std::uint64_t;
+
+    NOINLINE Id Schedule(const std::int64_t tick, std::uint64_t& counter)
+    {
+        const Id id = ++lastId;
+        heap.push(Entry{tick, id, [&counter]() { ++counter; }});
+        return id;
+    }
+
+    NOINLINE void Cancel(const Id id)
+    {
+        cancelled.insert(id);
+    }
+
+    NOINLINE std::size_t Advance(const std::int64_t tick)
+    {
+        std::size_t fired = 0;
+        while (!heap.empty() && heap.top().tick <= tick)
+        {
+            Entry entry = std::move(const_cast<Entry&>(heap.top()));
+            heap.pop();
+            if (cancelled.erase(entry.id) == 0)
+            {
+                entry.callback();
+                ++fired;
+            }
+        }
+        return fired;
+    }
+
+private:
+    struct Entry
+    {
+        std::int64_t tick;
+        Id id;
+        std::function<void()> callback;
+
+        bool operator<(const Entry& other) const
+        {
+            return tick > other.tick;
+        }
+    };
+
+    std::priority_queue<Entry> heap;
+    std::unordered_set<Id> cancelled;
+    Id lastId = 0;
+};
+
+
+// Timeouts which almost never fire: `state.range(0)` timers stay pending while one is scheduled and cancelled
+template <typename Timers>
+class ScheduleCancel
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        Timers timers;
+        std::uint64_t counter = 0;
+        std::mt19937_64 random(1);
+        for (std::int64_t i = 0; i < state.range(0); ++i)
+        {
+            timers.Schedule(LongTimeout + static_cast<std::int64_t>(random() % LongTimeout), counter);
+        }
+        // One tick per round, so cancelled entries of the heap are dropped after about a thousand rounds
+        std::int64_t now = 0;
+        for (auto _ : state)
+        {
+            const auto id = timers.Schedule(now + 1000 + static_cast<std::int64_t>(random() % 1000), counter);
+            timers.Cancel(id);
+            if ((++now & 63) == 0)
+            {
+                timers.Advance(now);
+            }
+        }
+        benchmark::DoNotOptimize(counter);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    static constexpr std::int64_t LongTimeout = 1000000000;
+};
+
+
+// Every round schedules a timer up to `state.range(0)` ticks ahead and advances the time by one tick
+template <typename Timers>
+class ScheduleFire
+{
+public:
+    static void Benchmark(benchmark::State& state)
+    {
+        Timers timers;
+        std::uint64_t counter = 0;
+        std::mt19937_64 random(1);
+        const std::uint64_t horizon = static_cast<std::uint64_t>(state.range(0));
+        std::int64_t now = 0;
+        for (auto _ : state)
+        {
+            timers.Schedule(now + 1 + static_cast<std::int64_t>(random() % horizon), counter);
+            timers.Advance(++now);
+        }
+        benchmark::DoNotOptimize(counter);
+        state.SetItemsProcessed(state.iterations());
+        state.counters["Fired"] = static_cast<double>(counter);
+    }
+};
+
+
+BENCHMARK(ScheduleCancel<LosyncTimerWheel>::Benchmark)->Arg(0)->Arg(100000);
+BENCHMARK(ScheduleCancel<PriorityQueueTimers>::Benchmark)->Arg(0)->Arg(100000);
+BENCHMARK(ScheduleFire<LosyncTimerWheel>::Benchmark)->Arg(100)->Arg(100000);
+BENCHMARK(ScheduleFire<PriorityQueueTimers>::Benchmark)->Arg(100)->Arg(100000);
@@ -1,6 +1,12 @@
 
+option(LOSYNC_ENABLE_CXX20 "Build with C++20, which enables the coroutine support of losync/task.h" OFF)
+
 if(NOT DEFINED CMAKE_CXX_STANDARD)
-    set(CMAKE_CXX_STANDARD 17)
+    if(LOSYNC_ENABLE_CXX20)
+        set(CMAKE_CXX_STANDARD 20)
+    else()
+        set(CMAKE_CXX_STANDARD 17)
+    endif()
     set(CMAKE_CXX_STANDARD_REQUIRED ON)
 endif()
 
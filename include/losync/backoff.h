@@ -0,0 +1,76 @@
+// `exponential_backoff` is a helper for spin loops which wait for another thread.
+// Its features:
+//
+// 1. `cpu_relax()` issues the processor's spin-wait hint, which saves power and frees the core for a hyper-thread.
+// 2. Every `spin()` waits twice as many hints as the previous one, so spinning threads stop hammering
+//    a contended cache line. `spin()` reports when the limit is reached, so the caller may go to sleep.
+// 3. `before_sleep()` does not spin at all on a single processor, where the awaited thread cannot run meanwhile.
+
+#pragma once
+
+#include <cstdint>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+
+namespace losync
+{
+
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+
+class exponential_backoff
+{
+public:
+    // `limit` is the maximal number of hints in one `spin()`
+    explicit exponential_backoff(const std::uint32_t limit = DefaultLimit) noexcept : limit(limit)
+    {
+    }
+
+    // For spinning before going to sleep
+    static exponential_backoff before_sleep() noexcept
+    {
+        static const bool multiprocessor = std::thread::hardware_concurrency() > 1;
+        return exponential_backoff(multiprocessor ? DefaultLimit : 0);
+    }
+
+    // Returns false without waiting when the previous spin already reached the limit
+    bool spin() noexcept
+    {
+        if (count > limit)
+        {
+            return false;
+        }
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            cpu_relax();
+        }
+        count *= 2;
+        return true;
+    }
+
+    void reset() noexcept
+    {
+        count = 1;
+    }
+
+private:
+    static constexpr std::uint32_t DefaultLimit = 64;
+
+    const std::uint32_t limit;
+    std::uint32_t count = 1;
+};
+
+} // namespace losync
@@ -0,0 +1,108 @@
+// `barrier` is a reusable rendezvous of a fixed number of threads, like `std::barrier` without a completion function.
+// Its features:
+//
+// 1. The state is one 32-bit word: the number of threads which did not arrive yet, the phase and a "has waiters" flag.
+//    The number of threads expected in the next phases is kept aside for `arrive_and_drop()`.
+// 2. Arriving is one atomic operation. The last thread starts the next phase and makes a syscall only when
+//    somebody sleeps. It is told so by `arrive_and_wait()`, so it can do the serial part of the work.
+// 3. Waiting spins with exponential backoff on a multiprocessor before it goes to sleep on a futex.
+
+#pragma once
+
+#include <losync/backoff.h>
+#include <losync/futex.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+
+namespace losync
+{
+
+class barrier
+{
+public:
+    explicit barrier(const std::uint32_t expected) noexcept : state(expected), expected(expected)
+    {
+        assert(expected > 0 && expected <= max());
+    }
+
+    barrier(const barrier&) = delete;
+    barrier& operator=(const barrier&) = delete;
+
+    static constexpr std::uint32_t max() noexcept
+    {
+        return RemainingMask;
+    }
+
+    // Returns true in the thread which arrived last and started the next phase.
+    // Work done before the call by all threads is visible to all of them after it.
+    bool arrive_and_wait() noexcept
+    {
+        const std::uint32_t previous = state.fetch_sub(1, std::memory_order_acq_rel);
+        if ((previous & RemainingMask) == 1)
+        {
+            completePhase(previous);
+            return true;
+        }
+        waitPhase(previous & Phase);
+        return false;
+    }
+
+    // Arrives at the current phase and leaves the barrier: the next phases expect one thread less.
+    // At least one thread has to stay.
+    void arrive_and_drop() noexcept
+    {
+        // Is visible to the last thread of the phase, which reads it after its own arrival
+        const std::uint32_t left = expected.fetch_sub(1, std::memory_order_relaxed);
+        assert(left > 1);
+        (void)left;
+        const std::uint32_t previous = state.fetch_sub(1, std::memory_order_acq_rel);
+        if ((previous & RemainingMask) == 1)
+        {
+            completePhase(previous);
+        }
+    }
+
+private:
+    static constexpr std::uint32_t RemainingMask = (1u << 30) - 1;
+    static constexpr std::uint32_t Phase = 1u << 30;
+    static constexpr std::uint32_t HasWaiters = 1u << 31;
+
+    // Nobody else changes the state until the exchange: all threads arrived and waiters only add the flag
+    void completePhase(const std::uint32_t previous) noexcept
+    {
+        const std::uint32_t next = expected.load(std::memory_order_relaxed) | ((previous & Phase) ^ Phase);
+        if ((state.exchange(next, std::memory_order_acq_rel) & HasWaiters) != 0)
+        {
+            futex_wake_all(state);
+        }
+    }
+
+    void waitPhase(const std::uint32_t phase) noexcept
+    {
+        exponential_backoff backoff = exponential_backoff::before_sleep();
+        std::uint32_t current = state.load(std::memory_order_acquire);
+        while ((current & Phase) == phase)
+        {
+            if (backoff.spin())
+            {
+                current = state.load(std::memory_order_acquire);
+                continue;
+            }
+            if ((current & HasWaiters) == 0 &&
+                !state.compare_exchange_weak(current, current | HasWaiters, std::memory_order_acquire))
+            {
+                continue;
+            }
+            futex_wait(state, current | HasWaiters);
+            current = state.load(std::memory_order_acquire);
+        }
+    }
+
+    std::atomic<std::uint32_t> state;
+    std::atomic<std::uint32_t> expected;
+};
+
+} // namespace losync
@@ -0,0 +1,295 @@
+// `batched_counter` is a counter for hot paths which are executed billions of times, like statistics of a server.
+// Its features:
+//
+// 1. Every thread slot has its own cell written only by the thread of the slot, so an addition is a relaxed load
+//    and store of a private cache line: plain instructions without the lock prefix of `sharded_counter::add()`.
+// 2. Every `flush_every` additions the thread publishes the growth of its cell to a shared total with one atomic
+//    addition. `read_approximate()` reads the total without visiting the cells, it lags behind by at most
+//    `flush_every - 1` additions per cell, see `max_error()`.
+// 3. `read()` is exact: it sums the cells of all slots, which hold everything added so far including
+//    the part which is not published yet.
+// 4. A cell belongs to the thread slot, not to the thread. Additions of an exited thread are never lost:
+//    `read()` sees them at once and the next thread of the slot publishes them with its first flush.
+//    Threads whose slot exceeds the number of cells add to a shared atomic directly.
+//
+// `batched_counter_registry` owns counters with names and reads all of them at once for export.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/mutex.h>
+#include <losync/thread_slot.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace losync
+{
+
+class batched_counter
+{
+    struct Cell;
+
+public:
+    static constexpr std::uint32_t default_flush_every = 256;
+
+    // Reference to the cell of one thread. It saves the lookup of the cell in a hot loop.
+    class local_shard
+    {
+    public:
+        void add(const std::int64_t delta = 1) noexcept
+        {
+            if (cell != nullptr)
+            {
+                counter->addToCell(*cell, delta);
+            }
+            else
+            {
+                counter->unbatched.fetch_add(delta, std::memory_order_relaxed);
+            }
+        }
+
+        // Publishes additions of this thread to the approximate value
+        void flush() noexcept
+        {
+            if (cell != nullptr)
+            {
+                counter->flushCell(*cell, cell->value.load(std::memory_order_relaxed));
+            }
+        }
+
+    private:
+        friend class batched_counter;
+
+        local_shard(batched_counter& counter, Cell* const cell) : counter(&counter), cell(cell)
+        {
+        }
+
+        batched_counter* counter;
+        Cell* cell;
+    };
+
+    batched_counter() : batched_counter(default_flush_every)
+    {
+    }
+
+    explicit batched_counter(const std::uint32_t flush_every, const std::size_t cells = default_cell_count())
+        : flushEvery(flush_every), cellCount(cells), cells(cells != 0 ? new Cell[cells] : nullptr)
+    {
+        assert(flush_every > 0);
+        if (cellCount == 0)
+        {
+            // Every thread adds to `unbatched`
+            return;
+        }
+        for (std::size_t i = 0; i < cellCount; ++i)
+        {
+            this->cells[i].countdown = flushEvery;
+        }
+    }
+
+    batched_counter(const batched_counter&) = delete;
+    batched_counter& operator=(const batched_counter&) = delete;
+
+    void add(const std::int64_t delta = 1) noexcept
+    {
+        const std::size_t slot = thread_slot::index();
+        if (slot < cellCount)
+        {
+            addToCell(cells[slot], delta);
+        }
+        else
+        {
+            unbatched.fetch_add(delta, std::memory_order_relaxed);
+        }
+    }
+
+    // The cell of the calling thread. It should be used only by this thread.
+    local_shard local() noexcept
+    {
+        const std::size_t slot = thread_slot::index();
+        return local_shard(*this, slot < cellCount ? &cells[slot] : nullptr);
+    }
+
+    // Publishes additions of the calling thread to the approximate value
+    void flush() noexcept
+    {
+        local().flush();
+    }
+
+    // Sum of all cells. Concurrent additions may be partially visible.
+    std::int64_t read() const noexcept
+    {
+        std::int64_t sum = unbatched.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < cellCount; ++i)
+        {
+            sum += cells[i].value.load(std::memory_order_relaxed);
+        }
+        return sum - base.load(std::memory_order_relaxed);
+    }
+
+    // The value published by flushes, it reads two cache lines regardless of the number of cells.
+    // Misses at most `max_error()` additions, each of them counts as `delta` of its `add()`.
+    std::int64_t read_approximate() const noexcept
+    {
+        return published.load(std::memory_order_relaxed) + unbatched.load(std::memory_order_relaxed) -
+               base.load(std::memory_order_relaxed);
+    }
+
+    // Maximal number of additions which `read_approximate()` may miss
+    std::uint64_t max_error() const noexcept
+    {
+        return static_cast<std::uint64_t>(flushEvery - 1) * cellCount;
+    }
+
+    // Makes the counter start from zero. Additions which run concurrently with it may be lost or kept.
+    void reset() noexcept
+    {
+        base.store(read() + base.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    std::uint32_t flush_every() const noexcept
+    {
+        return flushEvery;
+    }
+
+    std::size_t cell_count() const noexcept
+    {
+        return cellCount;
+    }
+
+    static std::size_t default_cell_count() noexcept
+    {
+        const std::size_t concurrency = std::thread::hardware_concurrency();
+        return 4 * (concurrency != 0 ? concurrency : 1);
+    }
+
+private:
+    struct LOSYNC_CACHE_ALIGNED Cell
+    {
+        // Written only by the thread of the slot, read by everybody
+        std::atomic<std::int64_t> value{0};
+        // Fields below are accessed only by the thread of the slot
+        std::int64_t flushed = 0;
+        std::uint32_t countdown = 0;
+    };
+
+    void addToCell(Cell& cell, const std::int64_t delta) noexcept
+    {
+        const std::int64_t value = cell.value.load(std::memory_order_relaxed) + delta;
+        cell.value.store(value, std::memory_order_relaxed);
+        if (--cell.countdown == 0)
+        {
+            flushCell(cell, value);
+        }
+    }
+
+    void flushCell(Cell& cell, const std::int64_t value) noexcept
+    {
+        if (value != cell.flushed)
+        {
+            published.fetch_add(value - cell.flushed, std::memory_order_relaxed);
+            cell.flushed = value;
+        }
+        cell.countdown = flushEvery;
+    }
+
+    const std::uint32_t flushEvery;
+    const std::size_t cellCount;
+    const std::unique_ptr<Cell[]> cells;
+
+    LOSYNC_CACHE_ALIGNED std::atomic<std::int64_t> published{0};
+    // Additions of threads without a cell
+    std::atomic<std::int64_t> unbatched{0};
+    // Sum of the cells at the last reset
+    std::atomic<std::int64_t> base{0};
+};
+
+
+class batched_counter_registry
+{
+public:
+    struct entry
+    {
+        std::string name;
+        std::int64_t value;
+    };
+
+    batched_counter_registry() : batched_counter_registry(batched_counter::default_flush_every)
+    {
+    }
+
+    // Parameters of all counters of the registry
+    explicit batched_counter_registry(const std::uint32_t flush_every,
+                                      const std::size_t cells = batched_counter::default_cell_count())
+        : flushEvery(flush_every), cellCount(cells)
+    {
+    }
+
+    batched_counter_registry(const batched_counter_registry&) = delete;
+    batched_counter_registry& operator=(const batched_counter_registry&) = delete;
+
+    // The counter with the name, it is created on the first call. The reference is valid as long as the registry.
+    // Takes a lock, so hot paths should look their counters up once.
+    batched_counter& counter(const std::string_view name)
+    {
+        std::lock_guard<losync::mutex> lock(mutex);
+        auto found = counters.find(name);
+        if (found == counters.end())
+        {
+            found = counters.emplace(std::string(name), std::make_unique<batched_counter>(flushEvery, cellCount)).first;
+        }
+        return *found->second;
+    }
+
+    // Exact values of all counters sorted by name
+    std::vector<entry> snapshot() const
+    {
+        return collect([](const batched_counter& counter) { return counter.read(); });
+    }
+
+    // Approximate values of all counters sorted by name, cheap enough for frequent export of many counters
+    std::vector<entry> snapshot_approximate() const
+    {
+        return collect([](const batched_counter& counter) { return counter.read_approximate(); });
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<losync::mutex> lock(mutex);
+        return counters.size();
+    }
+
+private:
+    template <typename Read>
+    std::vector<entry> collect(const Read read) const
+    {
+        std::lock_guard<losync::mutex> lock(mutex);
+        std::vector<entry> entries;
+        entries.reserve(counters.size());
+        for (const auto& [name, counter] : counters)
+        {
+            entries.push_back({name, read(*counter)});
+        }
+        return entries;
+    }
+
+    const std::uint32_t flushEvery;
+    const std::size_t cellCount;
+
+    mutable losync::mutex mutex;
+    std::map<std::string, std::unique_ptr<batched_counter>, std::less<>> counters;
+};
+
+} // namespace losync
@@ -0,0 +1,17 @@
+// Helpers to keep data of different threads on different cache lines and avoid false sharing.
+
+#pragma once
+
+#include <cstddef>
+
+
+namespace losync
+{
+
+// `std::hardware_destructive_interference_size` is not used here: its value depends on compiler flags,
+// so it would change the layout of the library types between translation units.
+constexpr std::size_t cache_line_size = 64;
+
+} // namespace losync
+
+#define LOSYNC_CACHE_ALIGNED alignas(losync::cache_line_size)
@@ -0,0 +1,579 @@
+// `callback_list` is a list of subscribed callables which are all invoked by one call, like a signal.
+// Its features:
+//
+// 1. Callables of different types are packed back to back in chunks of memory, each behind a 16-byte header
+//    with its call pointer. A subscriber takes its real size rounded up to 16 bytes plus the header,
+//    not a `cheap_function` of 256 bytes, and dispatch walks the memory linearly.
+// 2. `unsubscribe` is O(1): it swaps the call pointer of the record for a no-op. Dead callables are destroyed
+//    when the list compacts itself, after they take more memory than the live ones.
+// 3. Dispatch takes no lock: it is one atomic increment and decrement of the list state. It may run on many threads
+//    at once and concurrently with `subscribe` and `unsubscribe`, also from inside of the callables.
+//    Compaction moves callables, so it runs only while no dispatch is running: if one is, the last dispatch
+//    to leave compacts the list. At most 16383 dispatches of one list may run at once, nested ones included.
+// 4. `unsubscribe` waits for the dispatches which were running when it was called, so the callable is not running
+//    and no call of it starts after `unsubscribe` returns. Called from inside of a callable of any `callback_list`,
+//    it returns without waiting, because the dispatch would wait for itself: dispatches running on other threads
+//    may still call the callable. A callable subscribed during a dispatch may or may not be called by it.
+// 5. Callables are invoked as const, concurrent dispatches may call the same callable on several threads.
+//    Their destructors must not use the list.
+
+#pragma once
+
+#include <losync/futex.h>
+#include <losync/mutex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace losync
+{
+
+namespace detail
+{
+
+// Dispatches of all lists running on the current thread
+inline thread_local std::uint32_t callbackDispatchDepth = 0;
+
+} // namespace detail
+
+
+template <typename Sig>
+class callback_list;
+
+template <typename... Args>
+class callback_list<void(Args...)>
+{
+public:
+    // Identifies a subscribed callable. Ids of unsubscribed callables are not reused for a long time.
+    using subscription = std::uint64_t;
+    static constexpr subscription invalid_subscription = 0;
+
+    callback_list() = default;
+
+    callback_list(const callback_list&) = delete;
+    callback_list& operator=(const callback_list&) = delete;
+
+    // No dispatch may run
+    ~callback_list()
+    {
+        for (Chunk* chunk = first.load(std::memory_order_relaxed); chunk != nullptr;)
+        {
+            forEachRecord(chunk, [this](Header* header) { slots[header->slot].ops->destroy(header->callable()); });
+            Chunk* const next = chunk->next.load(std::memory_order_relaxed);
+            freeChunk(chunk);
+            chunk = next;
+        }
+    }
+
+    template <typename F>
+    subscription subscribe(F&& func)
+    {
+        using T = std::decay_t<F>;
+        static_assert(std::is_invocable<const T&, Args&...>::value,
+                      "Provided object is not callable with the arguments of the list");
+        static_assert(alignof(T) <= RecordAlign, "Callable requires stricter alignment than records provide");
+        static_assert(sizeof(T) < (std::size_t{1} << 31), "Callable is too large");
+        static_assert(std::is_nothrow_move_constructible<T>::value, "Compaction moves callables, it cannot fail");
+
+        constexpr std::size_t recordSize = sizeof(Header) + roundUp(sizeof(T), RecordAlign);
+
+        std::lock_guard<losync::mutex> lock(writer);
+        const std::uint32_t slot = acquireSlot();
+        Chunk* chunk;
+        try
+        {
+            chunk = reserve(recordSize);
+        }
+        catch (...)
+        {
+            releaseSlot(slot);
+            throw;
+        }
+        const std::size_t offset = chunk->used.load(std::memory_order_relaxed);
+        Header* const header = new (chunk->data() + offset) Header{{&OpsFor<T>::invoke}, recordSize, slot};
+        try
+        {
+            new (header->callable()) T(std::forward<F>(func));
+        }
+        catch (...)
+        {
+            header->~Header();
+            releaseSlot(slot);
+            throw;
+        }
+        slots[slot].header = header;
+        slots[slot].ops = &OpsFor<T>::value;
+        liveBytes += recordSize;
+        ++liveCount;
+        // Publishes the record to dispatches which read `used` with acquire
+        chunk->used.store(offset + recordSize, std::memory_order_release);
+        return idOf(slot);
+    }
+
+    // Returns false if the callable was already unsubscribed. Outside of callables it waits for running dispatches,
+    // so it must not be called under a lock which the callables take.
+    bool unsubscribe(const subscription id)
+    {
+        {
+            std::lock_guard<losync::mutex> lock(writer);
+            const std::uint32_t slot = static_cast<std::uint32_t>(id);
+            if (slot >= slots.size() || slots[slot].header == nullptr ||
+                slots[slot].generation != static_cast<std::uint32_t>(id >> 32))
+            {
+                return false;
+            }
+            Header* const header = slots[slot].header;
+            header->invoke.store(&invokeDead, std::memory_order_release);
+            // The slot stays taken until the callable is destroyed, but the id stops matching it
+            nextGeneration(slots[slot]);
+            liveBytes -= header->size;
+            deadBytes += header->size;
+            --liveCount;
+            if (deadBytes > liveBytes && deadBytes >= MinCompactedBytes)
+            {
+                // Compaction only saves memory and time of dispatches, the unsubscription is done anyway
+                try
+                {
+                    compactLocked();
+                }
+                catch (const std::bad_alloc&)
+                {
+                }
+            }
+        }
+        if (detail::callbackDispatchDepth == 0)
+        {
+            waitForDispatches();
+        }
+        return true;
+    }
+
+    // Calls all live callables in the order of subscription. Exceptions propagate after the running callable.
+    void operator()(Args... args) const
+    {
+        const DispatchScope scope(*this);
+        for (Chunk* chunk = first.load(std::memory_order_acquire); chunk != nullptr;
+             chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            const unsigned char* const data = chunk->data();
+            const std::size_t end = chunk->used.load(std::memory_order_acquire);
+            for (std::size_t offset = 0; offset < end;)
+            {
+                const Header* const header = reinterpret_cast<const Header*>(data + offset);
+                // The next record is found before the call, so the walk does not wait for the callable to return
+                offset += header->size;
+                header->invoke.load(std::memory_order_acquire)(header->callable(), args...);
+            }
+        }
+    }
+
+    // Moves live callables together and destroys dead ones. Returns false without waiting if a dispatch is running,
+    // then the last dispatch to leave compacts the list.
+    bool compact()
+    {
+        std::lock_guard<losync::mutex> lock(writer);
+        return compactLocked();
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<losync::mutex> lock(writer);
+        return liveCount;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // Bytes taken by records of live and of unsubscribed callables
+    std::size_t memory_usage() const
+    {
+        std::lock_guard<losync::mutex> lock(writer);
+        return liveBytes + deadBytes;
+    }
+
+private:
+    using Invoke = void (*)(const void* callable, Args&... args);
+
+    struct Ops
+    {
+        void (*relocate)(void* destination, void* source) noexcept;
+        void (*destroy)(void* callable) noexcept;
+    };
+
+    template <typename T>
+    struct OpsFor
+    {
+        static void invoke(const void* callable, Args&... args)
+        {
+            (*static_cast<const T*>(callable))(args...);
+        }
+
+        static void relocate(void* destination, void* source) noexcept
+        {
+            T* const sourcePtr = static_cast<T*>(source);
+            new (destination) T(std::move(*sourcePtr));
+            sourcePtr->~T();
+        }
+
+        static void destroy(void* callable) noexcept
+        {
+            static_cast<T*>(callable)->~T();
+        }
+
+        static constexpr Ops value = {&relocate, &destroy};
+    };
+
+    // The callable follows the header. Records start at multiples of `RecordAlign`.
+    struct Header
+    {
+        std::atomic<Invoke> invoke;
+        // Bytes from this header to the next one
+        std::uint32_t size;
+        std::uint32_t slot;
+
+        void* callable() const noexcept
+        {
+            return const_cast<Header*>(this) + 1;
+        }
+    };
+
+    struct Chunk
+    {
+        explicit Chunk(const std::size_t capacity) : capacity(capacity)
+        {
+        }
+
+        unsigned char* data() noexcept
+        {
+            return reinterpret_cast<unsigned char*>(this) + DataOffset;
+        }
+
+        std::atomic<Chunk*> next{nullptr};
+        // Bytes of published records, written under the writer lock
+        std::atomic<std::size_t> used{0};
+        const std::size_t capacity;
+    };
+
+    // Records of unsubscribed callables keep their slot until they are destroyed, so compaction finds their `ops`
+    struct Slot
+    {
+        Header* header = nullptr;
+        const Ops* ops = nullptr;
+        std::uint32_t generation = 1;
+        std::uint32_t nextFree = NoSlot;
+    };
+
+    // Counts the dispatch in the current epoch of the list. Dispatches wait while callables move.
+    class DispatchScope
+    {
+    public:
+        explicit DispatchScope(const callback_list& list) noexcept : list(list)
+        {
+            std::uint32_t current = list.state.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                if ((current & Compacting) != 0)
+                {
+                    futex_wait(list.state, current);
+                    current = list.state.load(std::memory_order_relaxed);
+                    continue;
+                }
+                epoch = current & Epoch;
+                const std::uint32_t previous = list.state.fetch_add(dispatchOf(epoch), std::memory_order_acquire);
+                assert(dispatchesOf(previous, epoch) < MaxDispatches);
+                if ((previous & (Compacting | Epoch)) == epoch)
+                {
+                    break;
+                }
+                // Compaction started or the epoch changed since the load
+                list.leave(list.state.fetch_sub(dispatchOf(epoch), std::memory_order_seq_cst), epoch);
+                current = list.state.load(std::memory_order_relaxed);
+            }
+            ++detail::callbackDispatchDepth;
+        }
+
+        ~DispatchScope()
+        {
+            --detail::callbackDispatchDepth;
+            const std::uint32_t previous = list.state.fetch_sub(dispatchOf(epoch), std::memory_order_seq_cst);
+            if ((previous & (Epoch | CompactWanted)) != epoch)
+            {
+                list.leave(previous, epoch);
+            }
+        }
+
+    private:
+        const callback_list& list;
+        // `Epoch` bit of the epoch which counts this dispatch
+        std::uint32_t epoch;
+    };
+
+    static constexpr std::size_t RecordAlign = 16;
+    static constexpr std::size_t DataOffset = (sizeof(Chunk) + RecordAlign - 1) / RecordAlign * RecordAlign;
+    static constexpr std::size_t FirstChunkSize = 1024;
+    static constexpr std::size_t MaxChunkSize = 64 * 1024;
+    // Compaction is not worth it for less
+    static constexpr std::size_t MinCompactedBytes = 1024;
+    // The state holds counters of dispatches of two epochs, the current epoch and flags
+    static constexpr unsigned DispatchBits = 14;
+    static constexpr std::uint32_t MaxDispatches = (std::uint32_t{1} << DispatchBits) - 1;
+    static constexpr std::uint32_t Dispatches = (std::uint32_t{1} << (2 * DispatchBits)) - 1;
+    static constexpr std::uint32_t Epoch = 0x20000000u;
+    // A dispatch was running when compaction was due, so the last one to leave compacts
+    static constexpr std::uint32_t CompactWanted = 0x40000000u;
+    static constexpr std::uint32_t Compacting = 0x80000000u;
+    static constexpr std::uint32_t NoSlot = ~std::uint32_t{0};
+
+    static_assert(sizeof(Header) == RecordAlign, "The callable is expected right after the header");
+
+    static constexpr std::size_t roundUp(const std::size_t value, const std::size_t align) noexcept
+    {
+        return (value + align - 1) / align * align;
+    }
+
+    static void invokeDead(const void*, Args&...)
+    {
+    }
+
+    // Counter increment of a dispatch in the epoch
+    static std::uint32_t dispatchOf(const std::uint32_t epoch) noexcept
+    {
+        return epoch != 0 ? std::uint32_t{1} << DispatchBits : 1;
+    }
+
+    static std::uint32_t dispatchesOf(const std::uint32_t state, const std::uint32_t epoch) noexcept
+    {
+        return (epoch != 0 ? state >> DispatchBits : state) & MaxDispatches;
+    }
+
+    // Called by a dispatch of `epoch` which left an old epoch or found `CompactWanted` in the `previous` state
+    void leave(const std::uint32_t previous, const std::uint32_t epoch) const noexcept
+    {
+        if ((previous & Epoch) != epoch && dispatchesOf(previous, epoch) == 1)
+        {
+            // The last dispatch of the epoch which an unsubscription waits for
+            drained.fetch_add(1, std::memory_order_seq_cst);
+            futex_wake_all(drained);
+        }
+        if ((previous & CompactWanted) != 0 && (previous & Dispatches) == dispatchOf(epoch))
+        {
+            compactAfterDispatches();
+        }
+    }
+
+    // Starts a new epoch and waits until dispatches of the previous one leave. Dispatches of the new epoch
+    // see the callables unsubscribed before, because they join it after the switch.
+    void waitForDispatches()
+    {
+        std::lock_guard<losync::mutex> lock(epochSwitch);
+        const std::uint32_t previous = state.fetch_xor(Epoch, std::memory_order_seq_cst) & Epoch;
+        for (;;)
+        {
+            const std::uint32_t seen = drained.load(std::memory_order_seq_cst);
+            if (dispatchesOf(state.load(std::memory_order_seq_cst), previous) == 0)
+            {
+                return;
+            }
+            futex_wait(drained, seen);
+        }
+    }
+
+    subscription idOf(const std::uint32_t slot) const noexcept
+    {
+        return (static_cast<subscription>(slots[slot].generation) << 32) | slot;
+    }
+
+    static void nextGeneration(Slot& slot) noexcept
+    {
+        // 0 is skipped so that no id equals `invalid_subscription`
+        if (++slot.generation == 0)
+        {
+            slot.generation = 1;
+        }
+    }
+
+    std::uint32_t acquireSlot()
+    {
+        if (freeSlot == NoSlot)
+        {
+            slots.emplace_back();
+            return static_cast<std::uint32_t>(slots.size() - 1);
+        }
+        const std::uint32_t slot = freeSlot;
+        freeSlot = slots[slot].nextFree;
+        return slot;
+    }
+
+    void releaseSlot(const std::uint32_t slot) noexcept
+    {
+        nextGeneration(slots[slot]);
+        slots[slot].header = nullptr;
+        slots[slot].ops = nullptr;
+        slots[slot].nextFree = freeSlot;
+        freeSlot = slot;
+    }
+
+    static Chunk* allocateChunk(const std::size_t capacity)
+    {
+        void* const memory = ::operator new(DataOffset + capacity, std::align_val_t{RecordAlign});
+        return new (memory) Chunk(capacity);
+    }
+
+    static void freeChunk(Chunk* const chunk) noexcept
+    {
+        chunk->~Chunk();
+        ::operator delete(chunk, std::align_val_t{RecordAlign});
+    }
+
+    template <typename Visitor>
+    static void forEachRecord(Chunk* const chunk, Visitor&& visitor)
+    {
+        const std::size_t end = chunk->used.load(std::memory_order_relaxed);
+        for (std::size_t offset = 0; offset < end;)
+        {
+            Header* const header = reinterpret_cast<Header*>(chunk->data() + offset);
+            offset += header->size;
+            visitor(header);
+        }
+    }
+
+    // The chunk with room for a record of `size` bytes, a new one is linked after the last chunk if needed
+    Chunk* reserve(const std::size_t size)
+    {
+        if (last != nullptr && last->capacity - last->used.load(std::memory_order_relaxed) >= size)
+        {
+            return last;
+        }
+        const std::size_t grown = last != nullptr ? std::min(last->capacity * 2, MaxChunkSize) : FirstChunkSize;
+        Chunk* const chunk = allocateChunk(std::max(grown, size));
+        if (last != nullptr)
+        {
+            last->next.store(chunk, std::memory_order_release);
+        }
+        else
+        {
+            first.store(chunk, std::memory_order_release);
+        }
+        last = chunk;
+        return chunk;
+    }
+
+    bool compactLocked()
+    {
+        if (deadBytes == 0)
+        {
+            return true;
+        }
+        std::uint32_t current = state.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if ((current & Dispatches) != 0)
+            {
+                if (state.compare_exchange_weak(current, current | CompactWanted, std::memory_order_relaxed))
+                {
+                    return false;
+                }
+            }
+            else if (state.compare_exchange_weak(current, (current & Epoch) | Compacting, std::memory_order_acquire,
+                                                 std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        Chunk* compacted = nullptr;
+        try
+        {
+            compacted = liveBytes != 0 ? allocateChunk(std::max(liveBytes, FirstChunkSize)) : nullptr;
+        }
+        catch (...)
+        {
+            finishCompaction();
+            throw;
+        }
+        std::size_t used = 0;
+        for (Chunk* chunk = first.load(std::memory_order_relaxed); chunk != nullptr;)
+        {
+            forEachRecord(chunk, [this, compacted, &used](Header* header) {
+                Slot& slot = slots[header->slot];
+                if (header->invoke.load(std::memory_order_relaxed) == &invokeDead)
+                {
+                    slot.ops->destroy(header->callable());
+                    releaseSlot(header->slot);
+                    return;
+                }
+                Header* const moved = new (compacted->data() + used)
+                    Header{{header->invoke.load(std::memory_order_relaxed)}, header->size, header->slot};
+                slot.ops->relocate(moved->callable(), header->callable());
+                slot.header = moved;
+                used += moved->size;
+            });
+            Chunk* const next = chunk->next.load(std::memory_order_relaxed);
+            freeChunk(chunk);
+            chunk = next;
+        }
+        if (compacted != nullptr)
+        {
+            compacted->used.store(used, std::memory_order_relaxed);
+        }
+        first.store(compacted, std::memory_order_relaxed);
+        last = compacted;
+        deadBytes = 0;
+        finishCompaction();
+        return true;
+    }
+
+    void finishCompaction() noexcept
+    {
+        state.fetch_and(~Compacting, std::memory_order_release);
+        futex_wake_all(state);
+    }
+
+    // Runs in the last dispatch to leave when compaction was wanted. A writer holding the lock
+    // leaves `CompactWanted` set for the next one.
+    void compactAfterDispatches() const noexcept
+    {
+        if (!writer.try_lock())
+        {
+            return;
+        }
+        const std::lock_guard<losync::mutex> lock(writer, std::adopt_lock);
+        try
+        {
+            // Only non-const members want compaction, so the list is not a const object
+            const_cast<callback_list&>(*this).compactLocked();
+        }
+        catch (const std::bad_alloc&)
+        {
+        }
+    }
+
+    std::atomic<Chunk*> first{nullptr};
+    // Running dispatches of two epochs, the current epoch, `CompactWanted` and `Compacting`
+    mutable std::atomic<std::uint32_t> state{0};
+    // Bumped by the last dispatch of the epoch which an unsubscription waits for
+    mutable std::atomic<std::uint32_t> drained{0};
+    // Serializes the waits of unsubscriptions, so that an epoch ends before the next one starts
+    losync::mutex epochSwitch;
+
+    // Guards the fields below and serializes subscribe, unsubscribe and compaction
+    mutable losync::mutex writer;
+    Chunk* last = nullptr;
+    std::vector<Slot> slots;
+    std::uint32_t freeSlot = NoSlot;
+    std::size_t liveBytes = 0;
+    std::size_t deadBytes = 0;
+    std::size_t liveCount = 0;
+};
+
+} // namespace losync
@@ -4,70 +4,148 @@
 // 1. The implementation does not allocate dynamic memory.
 //    But the class is limited by the maximum size of the functor.
 // 2. The class does not support copying. It only supports move semantics.
-//    So it can wrap the lambda that captured the `std::unique_ptr`.
+//    So it can wrap the lambda that captured the `std::unique_ptr`. Functors stored inline must be nothrow
+//    move constructible, so moves of `cheap_function` do not throw and it may live in lock-free queues.
+// 3. Calls, moves and destruction go through a static per-type table of function pointers.
+//    Trivially relocatable functors are moved with `memcpy` and trivially destructible ones are not destroyed.
+// 4. The size of the inline storage is a template parameter: `cheap_function<Sig, Capacity, Align>`.
+//    `Capacity` is the total size of the object in bytes, so `sizeof(cheap_function<Sig, 64>) == 64`.
+//    Use `cheap_function_capacity_v<F>` to find out which capacity a functor needs.
+// 5. `hybrid_function` is an opt-in variant which accepts functors of any size.
+//    Functors which do not fit are placed into blocks of `pool_allocator`, so moves still copy one pointer.
 
 #pragma once
 
+#include <losync/pool_allocator.h>
+
 #include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
 #include <type_traits>
+#include <utility>
 
 
 namespace losync
 {
 
-template <typename T>
+constexpr std::size_t cheap_function_default_capacity = 256;
+constexpr std::size_t cheap_function_default_align = alignof(std::max_align_t);
+
+
+// What cheap_function does with functors which do not fit into its inline storage
+enum class cheap_function_overflow
+{
+    reject, // compilation error
+    pool,   // the functor is placed into a block of pool_allocator
+};
+
+
+template <typename T, std::size_t Capacity = cheap_function_default_capacity,
+          std::size_t Align = cheap_function_default_align,
+          cheap_function_overflow Overflow = cheap_function_overflow::reject>
 class cheap_function;
 
+template <typename T>
+using cheap_function_32 = cheap_function<T, 32>;
+
+template <typename T>
+using cheap_function_64 = cheap_function<T, 64>;
+
+template <typename T>
+using cheap_function_128 = cheap_function<T, 128>;
+
+template <typename T, std::size_t Capacity = 64, std::size_t Align = cheap_function_default_align>
+using hybrid_function = cheap_function<T, Capacity, Align, cheap_function_overflow::pool>;
+
+
+namespace detail
+{
+
+// Mirrors the layout of `cheap_function`: the functor followed by the pointer to its operations table.
+template <typename F>
+struct cheap_function_layout
+{
+    F functor;
+    const void* ops;
+};
+
+constexpr std::size_t round_up(const std::size_t value, const std::size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+// Instantiated only to report the sizes in the compiler output when the functor does not fit.
+template <std::size_t Required, std::size_t Capacity>
+struct cheap_function_fits
+{
+    static_assert(Required <= Capacity,
+                  "Functor does not fit into cheap_function: compare Required and Capacity template arguments");
+    static constexpr bool value = true;
+};
+
+template <typename T>
+struct dependent_false : std::false_type
+{
+};
+
+} // namespace detail
+
+
+// Functors of such types are moved by copying their bytes, the source is not destroyed afterwards.
+// Specialize it for the types whose move constructor followed by destructor is equivalent to `memcpy`.
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T>
+{
+};
+
+template <typename T>
+constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+
+// Minimal `Capacity` of `cheap_function<Sig, Capacity, Align>` which can hold the functor `F`.
+template <typename F, std::size_t Align = cheap_function_default_align>
+struct cheap_function_capacity
+    : std::integral_constant<std::size_t, detail::round_up(sizeof(detail::cheap_function_layout<F>), Align)>
+{
+};
+
+template <typename F, std::size_t Align = cheap_function_default_align>
+constexpr std::size_t cheap_function_capacity_v = cheap_function_capacity<F, Align>::value;
 
-template <typename Ret, typename... Args>
-class cheap_function<Ret(Args...)>
+
+template <typename Ret, typename... Args, std::size_t Capacity, std::size_t Align, cheap_function_overflow Overflow>
+class cheap_function<Ret(Args...), Capacity, Align, Overflow>
 {
 public:
     cheap_function() = delete;
     cheap_function(const cheap_function&) = delete;
 
+    // Does not throw unless the functor goes to `pool_allocator`
     template <typename TRef>
-    cheap_function(TRef&& obj)
+    cheap_function(TRef&& obj) noexcept(fits<std::remove_reference_t<TRef>>)
     {
-        static_assert(std::is_invocable<TRef, Args...>::value,
-                      "Provided object is not callable or it has incompatible arguments");
-        static_assert(std::is_same<typename std::invoke_result<TRef, Args...>::type, Ret>::value,
-                      "Provided callable object has incorrect return type");
-
-        static_assert(std::is_move_constructible<TRef>::value);
-        static_assert(!std::is_const<TRef>::value);
-        static_assert(!std::is_lvalue_reference<TRef>::value, "It seems you forgot to wrap argument with std::move");
-
-        using T = typename std::remove_reference<TRef>::type;
-        using ActualWrapper = Wrapper<T>;
-
-        static_assert(sizeof(T) <= sizeOfWrapperBuffer);
-        static_assert(static_cast<WrapperBase*>(static_cast<ActualWrapper*>(nullptr)) == nullptr,
-                      "ActualWrapper pointer is expected to be binary equal to its interface pointer");
-        static_assert(!std::is_same<T, cheap_function>::value,
-                      "ensure another specialization is used for cheap_function");
-
-        ActualWrapper* const wrapper = reinterpret_cast<ActualWrapper*>(&wrapperBuffer);
-        new (wrapper) ActualWrapper(std::move(obj));
+        emplace(std::forward<TRef>(obj));
     }
 
-    template <typename T2>
-    cheap_function(cheap_function<T2>&& b)
+    template <typename T2, std::size_t Capacity2, std::size_t Align2, cheap_function_overflow Overflow2>
+    cheap_function(cheap_function<T2, Capacity2, Align2, Overflow2>&& b)
     {
         // This function prevents wrapping of cheap_function<T> into cheap_function<U>
         // and gives informative error in case of mistake
-        static_assert(false, "Cannot convert different specializations of cheap_function template");
+        static_assert(detail::dependent_false<T2>::value,
+                      "Cannot convert different specializations of cheap_function template");
     }
 
-    template <>
-    cheap_function(cheap_function&& b)
+    // The source is left empty: calling it throws `std::bad_function_call`
+    cheap_function(cheap_function&& b) noexcept
     {
-        b.getWrapper()->placement_move_self(getWrapper());
+        relocateFrom(b);
     }
 
     ~cheap_function()
     {
-        getWrapper()->~WrapperBase();
+        destroy();
     }
 
     cheap_function& operator=(const cheap_function&) = delete;
@@ -75,104 +153,257 @@ public:
     template <typename TRef>
     cheap_function& operator=(TRef&& obj)
     {
-        static_assert(std::is_invocable<TRef, Args...>::value,
-                      "Provided object is not callable or it has incompatible arguments");
-        static_assert(std::is_same<typename std::invoke_result<TRef, Args...>::type, Ret>::value,
-                      "Provided callable object has incorrect return type");
-
-        static_assert(std::is_move_constructible<TRef>::value);
-        static_assert(!std::is_const<TRef>::value);
-        static_assert(!std::is_lvalue_reference<TRef>::value, "It seems you forgot to wrap argument with std::move");
-
-        using T = typename std::remove_reference<TRef>::type;
-        using ActualWrapper = Wrapper<T>;
-
-        static_assert(sizeof(T) <= sizeOfWrapperBuffer);
-        static_assert(static_cast<WrapperBase*>(static_cast<ActualWrapper*>(nullptr)) == nullptr,
-                      "ActualWrapper pointer is expected to be binary equal to its interface pointer");
-        static_assert(!std::is_same<T, cheap_function>::value,
-                      "ensure another specialization is used for cheap_function");
-
-        getWrapper()->~WrapperBase();
-        ActualWrapper* const wrapper = reinterpret_cast<ActualWrapper*>(&wrapperBuffer);
-        new (wrapper) ActualWrapper(std::move(obj));
-
+        destroy();
+        ops = &emptyOps;
+        emplace(std::forward<TRef>(obj));
         return *this;
     }
 
-    template <typename T2>
-    cheap_function& operator=(cheap_function<T2>&& b)
+    template <typename T2, std::size_t Capacity2, std::size_t Align2, cheap_function_overflow Overflow2>
+    cheap_function& operator=(cheap_function<T2, Capacity2, Align2, Overflow2>&& b)
     {
         // This function prevents wrapping of cheap_function<T> into cheap_function<U>
         // and gives informative error in case of mistake
-        static_assert(false, "Cannot convert different specializations of cheap_function template");
+        static_assert(detail::dependent_false<T2>::value,
+                      "Cannot convert different specializations of cheap_function template");
+        return *this;
     }
 
-    template <>
-    cheap_function& operator=(cheap_function&& b)
+    cheap_function& operator=(cheap_function&& b) noexcept
     {
         if (this != &b)
         {
-            getWrapper()->~WrapperBase();
-            b.getWrapper()->placement_move_self(getWrapper());
+            destroy();
+            relocateFrom(b);
         }
         return *this;
     }
 
     Ret operator()(Args... args) const
     {
-        return getWrapper()->call(std::forward<Args>(args)...);
+        return ops->invoke(&storage, std::forward<Args>(args)...);
     }
 
+    // Returns false only for a moved-from object
+    explicit operator bool() const
+    {
+        return ops != &emptyOps;
+    }
+
+    // Minimal capacity of cheap_function which can hold the functor `F` with the same alignment.
+    template <typename F>
+    static constexpr std::size_t required_capacity = cheap_function_capacity_v<F, Align>;
+
+    // Whether the functor `F` is stored inline. Functors whose move may throw are not, so moves stay noexcept.
+    template <typename F>
+    static constexpr bool fits = required_capacity<F> <= Capacity && alignof(F) <= Align &&
+                                 std::is_nothrow_move_constructible<F>::value;
+
 private:
-    class WrapperBase
+    struct Ops
     {
-    public:
-        virtual ~WrapperBase() = default;
-        virtual void placement_move_self(WrapperBase* destination) = 0;
-        virtual Ret call(Args... args) const = 0;
+        Ret (*invoke)(const void* functor, Args&&... args);
+        // nullptr means that `size` bytes of the functor are copied with memcpy
+        void (*relocate)(void* destination, void* source);
+        // nullptr means that the functor is trivially destructible
+        void (*destroy)(void* functor);
+        std::size_t size;
     };
 
     template <typename T>
-    class Wrapper : public WrapperBase
+    struct OpsFor
     {
-    public:
-        explicit Wrapper(T&& value) : wrapped_value(std::move(value))
+        static Ret invoke(const void* functor, Args&&... args)
         {
+            return (*static_cast<const T*>(functor))(std::forward<Args>(args)...);
         }
 
-        virtual void placement_move_self(WrapperBase* destination) override
+        static void relocate(void* destination, void* source)
         {
-            Wrapper* const destinationPtr = static_cast<Wrapper*>(destination);
-            new (destinationPtr) Wrapper(std::move(wrapped_value));
+            T* const sourcePtr = static_cast<T*>(source);
+            new (destination) T(std::move(*sourcePtr));
+            sourcePtr->~T();
         }
 
-        virtual Ret call(Args... args) const override
+        static void destroy(void* functor)
         {
-            return wrapped_value(std::forward<Args>(args)...);
+            static_cast<T*>(functor)->~T();
         }
 
-    private:
-        T wrapped_value;
+        static constexpr Ops value = {
+            &invoke,
+            is_trivially_relocatable_v<T> ? nullptr : &relocate,
+            std::is_trivially_destructible<T>::value ? nullptr : &destroy,
+            sizeof(T),
+        };
     };
 
-    constexpr WrapperBase* getWrapper()
+    // Operations for a functor which lives in a block of pool_allocator, the storage keeps the pointer to it
+    template <typename T>
+    struct PooledOpsFor
+    {
+        static Ret invoke(const void* functor, Args&&... args)
+        {
+            return (**static_cast<const T* const*>(functor))(std::forward<Args>(args)...);
+        }
+
+        static void destroy(void* functor)
+        {
+            T* const ptr = *static_cast<T**>(functor);
+            ptr->~T();
+            pool_allocator::deallocate(ptr, sizeof(T));
+        }
+
+        static constexpr Ops value = {&invoke, nullptr, &destroy, sizeof(T*)};
+    };
+
+    static Ret invokeEmpty(const void*, Args&&...)
+    {
+        throw std::bad_function_call();
+    }
+
+    static constexpr Ops emptyOps = {&invokeEmpty, nullptr, nullptr, 0};
+
+    template <typename TRef>
+    void emplace(TRef&& obj)
     {
-        return reinterpret_cast<WrapperBase*>(&wrapperBuffer);
+        static_assert(std::is_invocable<TRef, Args...>::value,
+                      "Provided object is not callable or it has incompatible arguments");
+        static_assert(std::is_same<typename std::invoke_result<TRef, Args...>::type, Ret>::value,
+                      "Provided callable object has incorrect return type");
+
+        static_assert(std::is_move_constructible<TRef>::value);
+        static_assert(!std::is_const<TRef>::value);
+        static_assert(!std::is_lvalue_reference<TRef>::value, "It seems you forgot to wrap argument with std::move");
+
+        using T = typename std::remove_reference<TRef>::type;
+
+        static_assert(!std::is_same<T, cheap_function>::value,
+                      "ensure another specialization is used for cheap_function");
+
+        if constexpr (Overflow == cheap_function_overflow::pool && !fits<T>)
+        {
+            static_assert(alignof(T) <= alignof(std::max_align_t),
+                          "Functor requires stricter alignment than pool_allocator provides");
+
+            void* const block = pool_allocator::allocate(sizeof(T));
+            T* ptr;
+            try
+            {
+                ptr = new (block) T(std::move(obj));
+            }
+            catch (...)
+            {
+                pool_allocator::deallocate(block, sizeof(T));
+                throw;
+            }
+            new (&storage) T*(ptr);
+            ops = &PooledOpsFor<T>::value;
+            clearCopiedTail(sizeof(T*));
+        }
+        else
+        {
+            static_assert(detail::cheap_function_fits<required_capacity<T>, Capacity>::value);
+            static_assert(sizeof(T) <= sizeof(storage));
+            static_assert(alignof(T) <= Align, "Functor requires stricter alignment than cheap_function has");
+            static_assert(std::is_nothrow_move_constructible<T>::value, "Functor must be nothrow move constructible");
+
+            new (&storage) T(std::move(obj));
+            ops = &OpsFor<T>::value;
+            clearCopiedTail(sizeof(T));
+        }
     }
 
-    constexpr const WrapperBase* getWrapper() const
+    void relocateFrom(cheap_function& b) noexcept
     {
-        return reinterpret_cast<const WrapperBase*>(&wrapperBuffer);
+        ops = b.ops;
+        if (ops->relocate)
+        {
+            ops->relocate(&storage, &b.storage);
+        }
+        else
+        {
+            copyBytes(b);
+        }
+        b.ops = &emptyOps;
+    }
+
+    // Copies the used bytes rounded up to 8 with one or two overlapping moves of a constant size,
+    // so the compiler emits a few vector moves instead of a memcpy call with a variable length
+    void copyBytes(const cheap_function& b)
+    {
+        const std::size_t size = copiedBytes(ops->size);
+        if (size <= 8)
+        {
+            copyPrefix<8>(b);
+        }
+        else if (size <= 16 || sizeof(storage) <= 16)
+        {
+            copyPrefix<16>(b);
+        }
+        else if (size <= 32 || sizeof(storage) <= 32)
+        {
+            copyEnds<32>(b, size);
+        }
+        else if (size <= 64 || sizeof(storage) <= 64)
+        {
+            copyEnds<64>(b, size);
+        }
+        else if (size <= 128 || sizeof(storage) <= 128)
+        {
+            copyEnds<128>(b, size);
+        }
+        else
+        {
+            std::memcpy(storage, b.storage, size);
+        }
+    }
+
+    template <std::size_t Size>
+    void copyPrefix(const cheap_function& b)
+    {
+        std::memcpy(storage, b.storage, Size < sizeof(storage) ? Size : sizeof(storage));
+    }
+
+    // Copies the first and the last halves of `Size` in the first `size` bytes, which are more than a half
+    template <std::size_t Size>
+    void copyEnds(const cheap_function& b, const std::size_t size)
+    {
+        constexpr std::size_t Half = Size / 2 < sizeof(storage) ? Size / 2 : sizeof(storage);
+        std::memcpy(storage, b.storage, Half);
+        std::memcpy(storage + size - Half, b.storage + size - Half, Half);
+    }
+
+    // Number of bytes which `copyBytes` copies for a functor of `size` bytes
+    static constexpr std::size_t copiedBytes(const std::size_t size) noexcept
+    {
+        return size <= 8 ? 8 : detail::round_up(size, 8);
+    }
+
+    // Zeroes the bytes after the functor which `copyBytes` copies along with it, or along with the empty function
+    // which is left behind, so no uninitialized byte is read. It is less than a word, and nothing for most functors.
+    void clearCopiedTail(const std::size_t size) noexcept
+    {
+        std::memset(storage + size, 0, copiedBytes(size) - size);
+    }
+
+    void destroy()
+    {
+        if (ops->destroy)
+        {
+            ops->destroy(&storage);
+        }
     }
 
 private:
-    constexpr static size_t alignValue = alignof(std::max_align_t);
-    constexpr static size_t sizeOfWrapperBuffer = 256;
-    static_assert(sizeOfWrapperBuffer % alignValue == 0,
+    static_assert(Align >= alignof(void*) && (Align & (Align - 1)) == 0,
+                  "Align should be a power of two not less than pointer alignment");
+    static_assert(Capacity >= 2 * sizeof(void*), "Capacity is too small to hold any functor");
+    static_assert(Capacity % Align == 0,
                   "size of buffer should be greater and a multiple of alignValue to optimize memory usage");
 
-    alignas(alignValue) char wrapperBuffer[sizeOfWrapperBuffer];
+    alignas(Align) unsigned char storage[Capacity - sizeof(const Ops*)];
+    const Ops* ops;
 };
 
 } // namespace losync
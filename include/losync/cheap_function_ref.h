@@ -0,0 +1,96 @@
+// `cheap_function_ref` is a non-owning reference to a callable object.
+// Its features:
+//
+// 1. The object consists of two pointers and is trivially copyable, so it is passed in registers.
+// 2. Binding does not copy or move the callable, including `cheap_function`.
+//    The callable should outlive the reference, so it is meant for function parameters.
+// 3. The callable is invoked through the reference it was bound with:
+//    a non-const callable may have a mutable call operator, a const one should have a const call operator.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T>
+class cheap_function_ref;
+
+
+template <typename Ret, typename... Args>
+class cheap_function_ref<Ret(Args...)>
+{
+public:
+    cheap_function_ref() = delete;
+    cheap_function_ref(const cheap_function_ref&) = default;
+    cheap_function_ref& operator=(const cheap_function_ref&) = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, cheap_function_ref>::value>>
+    cheap_function_ref(F&& obj) noexcept
+    {
+        using T = typename std::remove_reference<F>::type;
+        static_assert(std::is_invocable_r<Ret, T&, Args...>::value,
+                      "Provided object is not callable or it has incompatible arguments");
+
+        if constexpr (std::is_function<T>::value)
+        {
+            object = reinterpret_cast<void*>(&obj);
+            callback = &invokeFunction<T>;
+        }
+        else if constexpr (std::is_pointer<T>::value && std::is_function<std::remove_pointer_t<T>>::value)
+        {
+            // The pointer itself may be a temporary, so keep its value
+            object = reinterpret_cast<void*>(obj);
+            callback = &invokeFunction<std::remove_pointer_t<T>>;
+        }
+        else
+        {
+            // const_cast only erases the type: `invokeObject<T>` restores constness
+            object = const_cast<void*>(static_cast<const void*>(std::addressof(obj)));
+            callback = &invokeObject<T>;
+        }
+    }
+
+    Ret operator()(Args... args) const
+    {
+        return callback(object, std::forward<Args>(args)...);
+    }
+
+private:
+    template <typename T>
+    static Ret invokeObject(void* obj, Args&&... args)
+    {
+        if constexpr (std::is_void<Ret>::value)
+        {
+            std::invoke(*static_cast<T*>(obj), std::forward<Args>(args)...);
+        }
+        else
+        {
+            return std::invoke(*static_cast<T*>(obj), std::forward<Args>(args)...);
+        }
+    }
+
+    template <typename T>
+    static Ret invokeFunction(void* obj, Args&&... args)
+    {
+        if constexpr (std::is_void<Ret>::value)
+        {
+            std::invoke(reinterpret_cast<T*>(obj), std::forward<Args>(args)...);
+        }
+        else
+        {
+            return std::invoke(reinterpret_cast<T*>(obj), std::forward<Args>(args)...);
+        }
+    }
+
+private:
+    void* object;
+    Ret (*callback)(void* obj, Args&&... args);
+};
+
+} // namespace losync
@@ -0,0 +1,840 @@
+// `concurrent_flat_map` is a hash map split into independently locked open-addressing shards.
+// Its features:
+//
+// 1. Every shard is a Swiss table: one metadata byte per slot holds 7 bits of the hash or an empty/deleted mark,
+//    and lookups compare 16 metadata bytes at once with SSE2 (a portable scalar loop elsewhere).
+// 2. Writers lock their shard with `losync::mutex` and bump the shard version before and after the change.
+// 3. When keys and values are trivially copyable, `find` and `contains` take no lock: they copy the data out
+//    and validate it with the shard version like a seqlock, and retired tables are reclaimed with `ebr`.
+//    Metadata bytes, keys and values are kept in relaxed atomic words like in `seqlock`, so racing copies are not
+//    data races, and keys are compared only after their copy is validated. After several failed validations
+//    the reader takes the lock.
+// 4. Values may be move-only, like `cheap_function`: `visit` and `update` pass them to a callback
+//    under the shard lock, so callbacks stored in the map may be invoked in place.
+
+#pragma once
+
+#include <losync/backoff.h>
+#include <losync/cache_aligned.h>
+#include <losync/mutex.h>
+#include <losync/reclamation.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOSYNC_FLAT_MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+namespace losync
+{
+
+namespace detail
+{
+
+constexpr std::size_t flat_map_group_width = 16;
+constexpr std::int8_t flat_map_empty = -128;
+constexpr std::int8_t flat_map_deleted = -2;
+
+// Bit masks of the metadata bytes of one group which match a condition
+class flat_map_group
+{
+public:
+    // Metadata bytes 0-7 and 8-15 of the group in memory order
+    flat_map_group(const std::uint64_t low, const std::uint64_t high) noexcept
+    {
+#if defined(LOSYNC_FLAT_MAP_SSE2)
+        bytes = _mm_set_epi64x(static_cast<long long>(high), static_cast<long long>(low));
+#else
+        std::memcpy(bytes, &low, sizeof(low));
+        std::memcpy(bytes + sizeof(low), &high, sizeof(high));
+#endif
+    }
+
+    std::uint32_t match(const std::int8_t h2) const noexcept
+    {
+#if defined(LOSYNC_FLAT_MAP_SSE2)
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2))));
+#else
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < flat_map_group_width; ++i)
+        {
+            mask |= static_cast<std::uint32_t>(bytes[i] == h2) << i;
+        }
+        return mask;
+#endif
+    }
+
+    std::uint32_t match_empty() const noexcept
+    {
+        return match(flat_map_empty);
+    }
+
+    // Empty and deleted bytes are the only ones with the high bit set
+    std::uint32_t match_empty_or_deleted() const noexcept
+    {
+#if defined(LOSYNC_FLAT_MAP_SSE2)
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+#else
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < flat_map_group_width; ++i)
+        {
+            mask |= static_cast<std::uint32_t>(bytes[i] < 0) << i;
+        }
+        return mask;
+#endif
+    }
+
+    static std::size_t lowest_bit(const std::uint32_t mask) noexcept
+    {
+#if defined(__GNUC__)
+        return static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+        std::size_t index = 0;
+        while ((mask & (1u << index)) == 0)
+        {
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+private:
+#if defined(LOSYNC_FLAT_MAP_SSE2)
+    __m128i bytes;
+#else
+    std::int8_t bytes[flat_map_group_width];
+#endif
+};
+
+} // namespace detail
+
+
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class concurrent_flat_map
+{
+public:
+    // Whether `find` and `contains` run without locking
+    static constexpr bool optimistic_reads = std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value;
+
+    concurrent_flat_map() : concurrent_flat_map(default_shard_count())
+    {
+    }
+
+    // `shards` is rounded up to a power of two
+    explicit concurrent_flat_map(const std::size_t shards)
+        : shardBits(log2RoundUp(shards)), shards(new Shard[std::size_t{1} << shardBits])
+    {
+    }
+
+    concurrent_flat_map(const concurrent_flat_map&) = delete;
+    concurrent_flat_map& operator=(const concurrent_flat_map&) = delete;
+
+    // No thread may access the map anymore
+    ~concurrent_flat_map()
+    {
+        for (std::size_t i = 0; i < shard_count(); ++i)
+        {
+            if (Table* const table = shards[i].table.load(std::memory_order_relaxed))
+            {
+                table->destroyEntries();
+                Table::destroy(table);
+            }
+        }
+    }
+
+    // Constructs the value from `args` if the key is absent. Returns whether it was inserted.
+    template <typename... ArgsT>
+    bool emplace(const K& key, ArgsT&&... args)
+    {
+        const std::uint64_t hash = hashOf(key);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<losync::mutex> lock(shard.mutex);
+        if (findLocked(shard, key, hash) != NotFound)
+        {
+            return false;
+        }
+        insertNew(shard, hash, key, std::forward<ArgsT>(args)...);
+        return true;
+    }
+
+    bool insert(const K& key, V value)
+    {
+        return emplace(key, std::move(value));
+    }
+
+    // Returns true if the key was inserted, false if the existing value was assigned
+    template <typename M>
+    bool insert_or_assign(const K& key, M&& value)
+    {
+        const std::uint64_t hash = hashOf(key);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<losync::mutex> lock(shard.mutex);
+        const std::size_t index = findLocked(shard, key, hash);
+        if (index != NotFound)
+        {
+            WriteSection section(shard);
+            shard.table.load(std::memory_order_relaxed)->modifyValue(index, [&value](V& current) {
+                current = std::forward<M>(value);
+            });
+            return false;
+        }
+        insertNew(shard, hash, key, std::forward<M>(value));
+        return true;
+    }
+
+    bool erase(const K& key)
+    {
+        const std::uint64_t hash = hashOf(key);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<losync::mutex> lock(shard.mutex);
+        const std::size_t index = findLocked(shard, key, hash);
+        if (index == NotFound)
+        {
+            return false;
+        }
+        Table* const table = shard.table.load(std::memory_order_relaxed);
+        WriteSection section(shard);
+        table->destroyAt(index);
+        // A probe which reaches a group with an empty byte stops there anyway, so no chain is cut
+        const std::size_t group = index & ~(detail::flat_map_group_width - 1);
+        if (table->group(group).match_empty() != 0)
+        {
+            table->setControl(index, detail::flat_map_empty);
+        }
+        else
+        {
+            table->setControl(index, detail::flat_map_deleted);
+            ++shard.tombstones;
+        }
+        shard.size.store(shard.size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Returns a copy of the value
+    std::optional<V> find(const K& key) const
+    {
+        std::optional<V> result;
+        const std::uint64_t hash = hashOf(key);
+        const Shard& shard = shardOf(hash);
+        if constexpr (optimistic_reads)
+        {
+            if (readOptimistic(shard, key, hash, result))
+            {
+                return result;
+            }
+        }
+        std::lock_guard<losync::mutex> lock(shard.mutex);
+        if (const std::size_t index = findLocked(shard, key, hash); index != NotFound)
+        {
+            result.emplace(shard.table.load(std::memory_order_relaxed)->valueAt(index));
+        }
+        return result;
+    }
+
+    bool contains(const K& key) const
+    {
+        const std::uint64_t hash = hashOf(key);
+        const Shard& shard = shardOf(hash);
+        if constexpr (optimistic_reads)
+        {
+            std::optional<V> result;
+            if (readOptimistic(shard, key, hash, result))
+            {
+                return result.has_value();
+            }
+        }
+        std::lock_guard<losync::mutex> lock(shard.mutex);
+        return findLocked(shard, key, hash) != NotFound;
+    }
+
+    // Calls `func(const V&)` under the shard lock, with optimistic reads on a copy. Returns false if the key is absent.
+    template <typename F>
+    bool visit(const K& key, F&& func) const
+    {
+        const std::uint64_t hash = hashOf(key);
+        const Shard& shard = shardOf(hash);
+        std::lock_guard<losync::mutex> lock(shard.mutex);
+        const std::size_t index = findLocked(shard, key, hash);
+        if (index == NotFound)
+        {
+            return false;
+        }
+        func(shard.table.load(std::memory_order_relaxed)->valueAt(index));
+        return true;
+    }
+
+    // Calls `func(V&)` under the shard lock. Returns false if the key is absent.
+    // With optimistic reads `func` changes a copy, which is stored back if it returns.
+    template <typename F>
+    bool update(const K& key, F&& func)
+    {
+        const std::uint64_t hash = hashOf(key);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<losync::mutex> lock(shard.mutex);
+        const std::size_t index = findLocked(shard, key, hash);
+        if (index == NotFound)
+        {
+            return false;
+        }
+        WriteSection section(shard);
+        shard.table.load(std::memory_order_relaxed)->modifyValue(index, std::forward<F>(func));
+        return true;
+    }
+
+    // Calls `func(const K&, const V&)` for every element, locking one shard at a time
+    template <typename F>
+    void for_each(F&& func) const
+    {
+        for (std::size_t i = 0; i < shard_count(); ++i)
+        {
+            const Shard& shard = shards[i];
+            std::lock_guard<losync::mutex> lock(shard.mutex);
+            const Table* const table = shard.table.load(std::memory_order_relaxed);
+            if (table == nullptr)
+            {
+                continue;
+            }
+            for (std::size_t index = 0; index < table->capacity; ++index)
+            {
+                if (table->controlAt(index) >= 0)
+                {
+                    func(table->keyAt(index), table->valueAt(index));
+                }
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (std::size_t i = 0; i < shard_count(); ++i)
+        {
+            Shard& shard = shards[i];
+            std::lock_guard<losync::mutex> lock(shard.mutex);
+            Table* const table = shard.table.load(std::memory_order_relaxed);
+            if (table == nullptr)
+            {
+                continue;
+            }
+            WriteSection section(shard);
+            shard.table.store(nullptr, std::memory_order_release);
+            table->destroyEntries();
+            retireTable(table);
+            shard.size.store(0, std::memory_order_relaxed);
+            shard.tombstones = 0;
+        }
+    }
+
+    // Concurrent modifications may be partially visible
+    std::size_t size() const noexcept
+    {
+        std::size_t result = 0;
+        for (std::size_t i = 0; i < shard_count(); ++i)
+        {
+            result += shards[i].size.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    std::size_t shard_count() const noexcept
+    {
+        return std::size_t{1} << shardBits;
+    }
+
+    static std::size_t default_shard_count() noexcept
+    {
+        const std::size_t concurrency = std::thread::hardware_concurrency();
+        return 4 * (concurrency != 0 ? concurrency : 1);
+    }
+
+private:
+    struct Entry
+    {
+        K key;
+        V value;
+    };
+
+    // Metadata bytes and entries of one shard. Capacity is a power of two, at least one group.
+    // With optimistic reads the entries are kept as words of keys and words of values instead of `Entry` objects.
+    struct Table
+    {
+        std::size_t capacity;
+        // Metadata bytes in memory order, eight per word
+        std::atomic<std::uint64_t>* control;
+        Entry* slots;
+        std::atomic<std::uint64_t>* keyWords;
+        std::atomic<std::uint64_t>* valueWords;
+
+        static Table* create(const std::size_t capacity)
+        {
+            const std::size_t align = alignment();
+            const std::size_t headerBytes = (sizeof(Table) + align - 1) / align * align;
+            const std::size_t controlBytes = (capacity + align - 1) / align * align;
+            const std::size_t slotWords = capacity * (KeyWords + ValueWords);
+            const std::size_t slotBytes = optimistic_reads ? slotWords * sizeof(std::uint64_t) : capacity * sizeof(Entry);
+            unsigned char* const memory = static_cast<unsigned char*>(
+                ::operator new(headerBytes + controlBytes + slotBytes, std::align_val_t{align}));
+            Table* const table = new (memory) Table;
+            table->capacity = capacity;
+            table->control = createWords(memory + headerBytes, capacity / sizeof(std::uint64_t), EmptyControlWord);
+            table->slots = nullptr;
+            table->keyWords = nullptr;
+            table->valueWords = nullptr;
+            if constexpr (optimistic_reads)
+            {
+                table->keyWords = createWords(memory + headerBytes + controlBytes, slotWords, 0);
+                table->valueWords = table->keyWords + capacity * KeyWords;
+            }
+            else
+            {
+                table->slots = reinterpret_cast<Entry*>(memory + headerBytes + controlBytes);
+            }
+            return table;
+        }
+
+        static void destroy(Table* const table) noexcept
+        {
+            ::operator delete(table, std::align_val_t{alignment()});
+        }
+
+        detail::flat_map_group group(const std::size_t first) const noexcept
+        {
+            const std::size_t word = first / sizeof(std::uint64_t);
+            return detail::flat_map_group(control[word].load(std::memory_order_relaxed),
+                                          control[word + 1].load(std::memory_order_relaxed));
+        }
+
+        std::int8_t controlAt(const std::size_t index) const noexcept
+        {
+            const std::uint64_t word = control[index / sizeof(std::uint64_t)].load(std::memory_order_relaxed);
+            std::int8_t bytes[sizeof(std::uint64_t)];
+            std::memcpy(bytes, &word, sizeof(word));
+            return bytes[index % sizeof(std::uint64_t)];
+        }
+
+        // Only under the shard lock
+        void setControl(const std::size_t index, const std::int8_t value) noexcept
+        {
+            std::atomic<std::uint64_t>& word = control[index / sizeof(std::uint64_t)];
+            std::uint64_t current = word.load(std::memory_order_relaxed);
+            std::int8_t bytes[sizeof(std::uint64_t)];
+            std::memcpy(bytes, &current, sizeof(current));
+            bytes[index % sizeof(std::uint64_t)] = value;
+            std::memcpy(&current, bytes, sizeof(current));
+            word.store(current, std::memory_order_relaxed);
+        }
+
+        // A copy with optimistic reads, a reference otherwise
+        decltype(auto) keyAt(const std::size_t index) const noexcept
+        {
+            if constexpr (optimistic_reads)
+            {
+                return loadAs<K>(keyWords + index * KeyWords);
+            }
+            else
+            {
+                return static_cast<const K&>(entry(index).key);
+            }
+        }
+
+        decltype(auto) valueAt(const std::size_t index) const noexcept
+        {
+            if constexpr (optimistic_reads)
+            {
+                return loadAs<V>(valueWords + index * ValueWords);
+            }
+            else
+            {
+                return static_cast<const V&>(entry(index).value);
+            }
+        }
+
+        template <typename F>
+        void modifyValue(const std::size_t index, F&& func)
+        {
+            if constexpr (optimistic_reads)
+            {
+                V value = loadAs<V>(valueWords + index * ValueWords);
+                func(value);
+                storeWords(valueWords + index * ValueWords, value);
+            }
+            else
+            {
+                func(entry(index).value);
+            }
+        }
+
+        template <typename... ArgsT>
+        void construct(const std::size_t index, const K& key, ArgsT&&... args)
+        {
+            if constexpr (optimistic_reads)
+            {
+                storeWords(keyWords + index * KeyWords, K(key));
+                storeWords(valueWords + index * ValueWords, V(std::forward<ArgsT>(args)...));
+            }
+            else
+            {
+                new (slots + index) Entry{K(key), V(std::forward<ArgsT>(args)...)};
+            }
+        }
+
+        void destroyAt(const std::size_t index) noexcept
+        {
+            if constexpr (!optimistic_reads)
+            {
+                entry(index).~Entry();
+            }
+        }
+
+        // Moves the entry to a table which is not published yet
+        void moveTo(const std::size_t index, Table& target, const std::size_t targetIndex) noexcept
+        {
+            if constexpr (optimistic_reads)
+            {
+                copyWords(keyWords + index * KeyWords, target.keyWords + targetIndex * KeyWords, KeyWords);
+                copyWords(valueWords + index * ValueWords, target.valueWords + targetIndex * ValueWords, ValueWords);
+            }
+            else
+            {
+                new (target.slots + targetIndex) Entry{std::move(entry(index))};
+                entry(index).~Entry();
+            }
+        }
+
+        void destroyEntries() noexcept
+        {
+            for (std::size_t index = 0; index < capacity; ++index)
+            {
+                if (controlAt(index) >= 0)
+                {
+                    destroyAt(index);
+                }
+            }
+        }
+
+    private:
+        static std::size_t alignment() noexcept
+        {
+            const std::size_t align = alignof(Table) > alignof(Entry) ? alignof(Table) : alignof(Entry);
+            return align > alignof(std::atomic<std::uint64_t>) ? align : alignof(std::atomic<std::uint64_t>);
+        }
+
+        static std::atomic<std::uint64_t>* createWords(void* const memory, const std::size_t count,
+                                                       const std::uint64_t value) noexcept
+        {
+            std::atomic<std::uint64_t>* const words = static_cast<std::atomic<std::uint64_t>*>(memory);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                new (words + i) std::atomic<std::uint64_t>(value);
+            }
+            return words;
+        }
+
+        Entry& entry(const std::size_t index) noexcept
+        {
+            return *std::launder(slots + index);
+        }
+
+        const Entry& entry(const std::size_t index) const noexcept
+        {
+            return *std::launder(slots + index);
+        }
+    };
+
+    struct LOSYNC_CACHE_ALIGNED Shard
+    {
+        mutable losync::mutex mutex;
+        // Odd while a writer changes the shard
+        std::atomic<std::uint64_t> version{0};
+        std::atomic<Table*> table{nullptr};
+        std::atomic<std::size_t> size{0};
+        std::size_t tombstones = 0;
+    };
+
+    // Makes the version odd for the duration of a change, like a seqlock writer
+    class WriteSection
+    {
+    public:
+        explicit WriteSection(Shard& shard) noexcept : shard(shard)
+        {
+            shard.version.store(shard.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        WriteSection(const WriteSection&) = delete;
+        WriteSection& operator=(const WriteSection&) = delete;
+
+        ~WriteSection()
+        {
+            shard.version.store(shard.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        Shard& shard;
+    };
+
+    static constexpr std::size_t NotFound = ~std::size_t{0};
+    static constexpr int OptimisticAttempts = 8;
+    static constexpr std::size_t KeyWords = (sizeof(K) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    static constexpr std::size_t ValueWords = (sizeof(V) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    static constexpr std::uint64_t EmptyControlWord =
+        0x0101010101010101ull * static_cast<std::uint8_t>(detail::flat_map_empty);
+
+    std::uint64_t hashOf(const K& key) const
+    {
+        // Standard hashes of integers are identities, mix the bits so that all of them matter
+        std::uint64_t hash = static_cast<std::uint64_t>(Hash()(key)) * 0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 29);
+    }
+
+    Shard& shardOf(const std::uint64_t hash) const noexcept
+    {
+        return shards[shardBits == 0 ? 0 : hash >> (64 - shardBits)];
+    }
+
+    static std::int8_t h2Of(const std::uint64_t hash) noexcept
+    {
+        return static_cast<std::int8_t>(hash & 0x7F);
+    }
+
+    // Visits groups in triangular order, which reaches every group of a power-of-two table.
+    // `matches(index)` tells whether the slot with the same metadata holds the key.
+    template <typename Matches>
+    static std::size_t probe(const Table& table, const std::uint64_t hash, Matches&& matches)
+    {
+        const std::size_t groupMask = table.capacity / detail::flat_map_group_width - 1;
+        std::size_t group = static_cast<std::size_t>(hash >> 7) & groupMask;
+        for (std::size_t step = 1; step <= groupMask + 1; ++step)
+        {
+            const std::size_t first = group * detail::flat_map_group_width;
+            const detail::flat_map_group bytes = table.group(first);
+            for (std::uint32_t mask = bytes.match(h2Of(hash)); mask != 0; mask &= mask - 1)
+            {
+                const std::size_t index = first + detail::flat_map_group::lowest_bit(mask);
+                if (matches(index))
+                {
+                    return index;
+                }
+            }
+            if (bytes.match_empty() != 0)
+            {
+                return NotFound;
+            }
+            group = (group + step) & groupMask;
+        }
+        return NotFound;
+    }
+
+    // Index of the key in the table of a locked shard
+    std::size_t findLocked(const Shard& shard, const K& key, const std::uint64_t hash) const
+    {
+        const Table* const table = shard.table.load(std::memory_order_relaxed);
+        if (table == nullptr)
+        {
+            return NotFound;
+        }
+        return probe(*table, hash, [&](const std::size_t index) { return KeyEqual()(table->keyAt(index), key); });
+    }
+
+    // Words are accessed with relaxed atomics, so copies racing with a writer are not data races.
+    // Such copies are turned into objects only after the shard version validates them.
+    static void loadWords(const std::atomic<std::uint64_t>* const words, std::uint64_t* const copy,
+                          const std::size_t count) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            copy[i] = words[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    static void copyWords(const std::atomic<std::uint64_t>* const source, std::atomic<std::uint64_t>* const target,
+                          const std::size_t count) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            target[i].store(source[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    template <typename T>
+    static T fromWords(const std::uint64_t* const copy) noexcept
+    {
+        alignas(T) unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, copy, sizeof(T));
+        return *std::launder(reinterpret_cast<const T*>(bytes));
+    }
+
+    template <typename T>
+    static T loadAs(const std::atomic<std::uint64_t>* const words) noexcept
+    {
+        std::uint64_t copy[(sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t)];
+        loadWords(words, copy, std::size(copy));
+        return fromWords<T>(copy);
+    }
+
+    template <typename T>
+    static void storeWords(std::atomic<std::uint64_t>* const words, const T& value) noexcept
+    {
+        std::uint64_t copy[(sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t)] = {};
+        std::memcpy(copy, &value, sizeof(T));
+        for (std::size_t i = 0; i < std::size(copy); ++i)
+        {
+            words[i].store(copy[i], std::memory_order_relaxed);
+        }
+    }
+
+    // Returns false if the validation failed too many times, the caller should take the lock then
+    bool readOptimistic(const Shard& shard, const K& key, const std::uint64_t hash, std::optional<V>& result) const
+    {
+        // Tables replaced meanwhile are not freed while the guard exists
+        ebr::guard guard;
+        exponential_backoff backoff;
+        for (int attempt = 0; attempt < OptimisticAttempts; ++attempt)
+        {
+            const std::uint64_t before = shard.version.load(std::memory_order_acquire);
+            if ((before & 1) != 0)
+            {
+                backoff.spin();
+                continue;
+            }
+            const Table* const table = shard.table.load(std::memory_order_acquire);
+            bool torn = false;
+            std::size_t index = NotFound;
+            std::uint64_t value[ValueWords];
+            if (table != nullptr)
+            {
+                index = probe(*table, hash, [&](const std::size_t slot) {
+                    std::uint64_t candidate[KeyWords];
+                    loadWords(table->keyWords + slot * KeyWords, candidate, KeyWords);
+                    // A torn key could break the comparison, so it is validated first
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    torn = shard.version.load(std::memory_order_relaxed) != before;
+                    return torn || KeyEqual()(fromWords<K>(candidate), key);
+                });
+                if (!torn && index != NotFound)
+                {
+                    loadWords(table->valueWords + index * ValueWords, value, ValueWords);
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (!torn && shard.version.load(std::memory_order_relaxed) == before)
+            {
+                if (index != NotFound)
+                {
+                    result.emplace(fromWords<V>(value));
+                }
+                return true;
+            }
+            backoff.spin();
+        }
+        return false;
+    }
+
+    template <typename... ArgsT>
+    void insertNew(Shard& shard, const std::uint64_t hash, const K& key, ArgsT&&... args)
+    {
+        Table* table = shard.table.load(std::memory_order_relaxed);
+        const std::size_t size = shard.size.load(std::memory_order_relaxed);
+        if (table == nullptr || (size + shard.tombstones + 1) * 8 > table->capacity * 7)
+        {
+            // Only purge tombstones if the live elements take less than half of the maximal load
+            const std::size_t capacity = table == nullptr                        ? detail::flat_map_group_width
+                                         : (size + 1) * 16 > table->capacity * 7 ? table->capacity * 2
+                                                                                 : table->capacity;
+            table = rehash(shard, capacity);
+        }
+        const std::size_t index = firstFree(*table, hash);
+        WriteSection section(shard);
+        table->construct(index, key, std::forward<ArgsT>(args)...);
+        if (table->controlAt(index) == detail::flat_map_deleted)
+        {
+            --shard.tombstones;
+        }
+        table->setControl(index, h2Of(hash));
+        shard.size.store(shard.size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    Table* rehash(Shard& shard, const std::size_t capacity)
+    {
+        Table* const previous = shard.table.load(std::memory_order_relaxed);
+        Table* const table = Table::create(capacity);
+        if (previous != nullptr)
+        {
+            for (std::size_t index = 0; index < previous->capacity; ++index)
+            {
+                if (previous->controlAt(index) < 0)
+                {
+                    continue;
+                }
+                const std::uint64_t hash = hashOf(previous->keyAt(index));
+                const std::size_t target = firstFree(*table, hash);
+                previous->moveTo(index, *table, target);
+                table->setControl(target, h2Of(hash));
+            }
+        }
+        WriteSection section(shard);
+        shard.table.store(table, std::memory_order_release);
+        shard.tombstones = 0;
+        if (previous != nullptr)
+        {
+            retireTable(previous);
+        }
+        return table;
+    }
+
+    static std::size_t firstFree(const Table& table, const std::uint64_t hash) noexcept
+    {
+        const std::size_t groupMask = table.capacity / detail::flat_map_group_width - 1;
+        std::size_t group = static_cast<std::size_t>(hash >> 7) & groupMask;
+        for (std::size_t step = 1;; ++step)
+        {
+            const std::size_t first = group * detail::flat_map_group_width;
+            const std::uint32_t free = table.group(first).match_empty_or_deleted();
+            if (free != 0)
+            {
+                return first + detail::flat_map_group::lowest_bit(free);
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+    static void retireTable(Table* table)
+    {
+        if constexpr (optimistic_reads)
+        {
+            ebr::retire(table, &Table::destroy);
+        }
+        else
+        {
+            Table::destroy(table);
+        }
+    }
+
+    static std::size_t log2RoundUp(const std::size_t value) noexcept
+    {
+        std::size_t bits = 0;
+        while ((std::size_t{1} << bits) < value)
+        {
+            ++bits;
+        }
+        return bits;
+    }
+
+    const std::size_t shardBits;
+    const std::unique_ptr<Shard[]> shards;
+};
+
+} // namespace losync
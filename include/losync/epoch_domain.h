@@ -0,0 +1,75 @@
+// The epoch domain tracks read sections of all threads for `rcu_cell` and `ebr`.
+// Its features:
+//
+// 1. Every thread which ever entered a read section owns a reader record padded to a separate cache line.
+//    Records are never freed, a record of an exited thread is reused by a new one.
+// 2. Entering a read section stores the global epoch into the record and issues a fence, no atomic RMW is done.
+//    Leaving it stores 0. Read sections may be nested.
+// 3. An updater which unlinked an object advances the global epoch and may destroy the object once
+//    the oldest epoch of active read sections is newer than the epoch the object was retired with.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace losync
+{
+
+namespace detail
+{
+
+struct LOSYNC_CACHE_ALIGNED rcu_reader
+{
+    // Epoch of the current read section, 0 outside of read sections. Written only by the owner.
+    std::atomic<std::uint64_t> epoch{0};
+    // Accessed only by the owner
+    std::uint32_t nesting = 0;
+    std::atomic<bool> used{true};
+    rcu_reader* next = nullptr;
+};
+
+// Starts from 1: 0 in a reader record means a quiescent thread
+inline std::atomic<std::uint64_t> rcuGlobalEpoch{1};
+
+inline thread_local rcu_reader* currentRcuReader = nullptr;
+
+rcu_reader& rcu_register_reader() noexcept;
+
+// Finishes the epoch of an update which already published its object. Returns the epoch to retire the old object with.
+std::uint64_t rcu_advance_epoch() noexcept;
+
+// Objects retired with an epoch less than the returned value are not visible to any reader
+std::uint64_t rcu_oldest_active_epoch() noexcept;
+
+inline void rcu_read_lock() noexcept
+{
+    rcu_reader* reader = currentRcuReader;
+    if (reader == nullptr)
+    {
+        reader = &rcu_register_reader();
+    }
+    if (reader->nesting++ == 0)
+    {
+        reader->epoch.store(rcuGlobalEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+        // Pairs with the fence in rcu_oldest_active_epoch(): either the writer sees our epoch
+        // or we see the object it published
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+inline void rcu_read_unlock() noexcept
+{
+    rcu_reader* const reader = currentRcuReader;
+    if (--reader->nesting == 0)
+    {
+        reader->epoch.store(0, std::memory_order_release);
+    }
+}
+
+} // namespace detail
+
+} // namespace losync
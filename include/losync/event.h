@@ -0,0 +1,181 @@
+// `event` is a flag which threads wait for, with manual or automatic reset.
+// Its features:
+//
+// 1. The state is one 32-bit word: the flag, the reset mode and the number of sleeping waiters.
+// 2. `set()` is one atomic operation and makes a syscall only when somebody sleeps. `wait()` on a set event
+//    is one load for manual reset and one CAS for automatic reset.
+// 3. A manual-reset event stays set and releases all waiters until `reset()`. An automatic-reset event releases
+//    one waiter, which resets it, and setting an event which is already set does nothing.
+// 4. Waiting spins with exponential backoff on a multiprocessor before it goes to sleep on a futex,
+//    `wait_for` gives up after a timeout.
+
+#pragma once
+
+#include <losync/backoff.h>
+#include <losync/futex.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+namespace losync
+{
+
+enum class event_reset
+{
+    manual,
+    automatic,
+};
+
+
+class event
+{
+public:
+    explicit event(const event_reset reset = event_reset::manual, const bool initially_set = false) noexcept
+        : state((reset == event_reset::automatic ? AutoReset : 0) | (initially_set ? Set : 0))
+    {
+    }
+
+    event(const event&) = delete;
+    event& operator=(const event&) = delete;
+
+    void set() noexcept
+    {
+        const std::uint32_t previous = state.fetch_or(Set, std::memory_order_release);
+        if ((previous & Set) == 0 && previous >= Waiter)
+        {
+            if ((previous & AutoReset) != 0)
+            {
+                futex_wake_one(state);
+            }
+            else
+            {
+                futex_wake_all(state);
+            }
+        }
+    }
+
+    void reset() noexcept
+    {
+        state.fetch_and(~Set, std::memory_order_relaxed);
+    }
+
+    bool is_set() const noexcept
+    {
+        return (state.load(std::memory_order_acquire) & Set) != 0;
+    }
+
+    // Returns true if the event was set. An automatic-reset event is reset then.
+    bool try_wait() noexcept
+    {
+        std::uint32_t current = state.load(std::memory_order_acquire);
+        return tryConsume(current);
+    }
+
+    void wait() noexcept
+    {
+        std::uint32_t current = state.load(std::memory_order_acquire);
+        if (!tryConsume(current) && !spinWait())
+        {
+            sleepWait(nullptr);
+        }
+    }
+
+    // Returns false if the event was not set within `timeout`
+    template <typename Rep, typename Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout) noexcept
+    {
+        std::uint32_t current = state.load(std::memory_order_acquire);
+        if (tryConsume(current) || spinWait())
+        {
+            return true;
+        }
+        const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::nanoseconds>(timeout);
+        return sleepWait(&deadline);
+    }
+
+private:
+    static constexpr std::uint32_t Set = 1;
+    static constexpr std::uint32_t AutoReset = 2;
+    // Sleeping waiters are counted in the rest of the word
+    static constexpr std::uint32_t Waiter = 4;
+
+    // Takes the signal from `current`, which is refreshed when the CAS of an automatic-reset event fails
+    bool tryConsume(std::uint32_t& current, const std::uint32_t registered = 0) noexcept
+    {
+        while ((current & Set) != 0)
+        {
+            if ((current & AutoReset) == 0)
+            {
+                if (registered != 0)
+                {
+                    state.fetch_sub(registered, std::memory_order_relaxed);
+                }
+                return true;
+            }
+            if (state.compare_exchange_weak(current, (current & ~Set) - registered, std::memory_order_acquire,
+                                            std::memory_order_acquire))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool spinWait() noexcept
+    {
+        exponential_backoff backoff = exponential_backoff::before_sleep();
+        while (backoff.spin())
+        {
+            std::uint32_t current = state.load(std::memory_order_acquire);
+            if (tryConsume(current))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The waiter stays counted until it takes the signal or times out
+    bool sleepWait(const std::chrono::steady_clock::time_point* deadline) noexcept
+    {
+        std::uint32_t current = state.fetch_add(Waiter, std::memory_order_acquire) + Waiter;
+        while (!tryConsume(current, Waiter))
+        {
+            if (deadline == nullptr)
+            {
+                futex_wait(state, current);
+            }
+            else
+            {
+                const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= *deadline)
+                {
+                    return leave(current);
+                }
+                futex_wait_for(state, current, *deadline - now);
+            }
+            current = state.load(std::memory_order_acquire);
+        }
+        return true;
+    }
+
+    // The wake-up of a signal set at the timeout may have gone to this waiter, so it takes the signal if there is one
+    bool leave(std::uint32_t current) noexcept
+    {
+        while (!tryConsume(current, Waiter))
+        {
+            if (state.compare_exchange_weak(current, current - Waiter, std::memory_order_relaxed))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::atomic<std::uint32_t> state;
+};
+
+} // namespace losync
@@ -0,0 +1,246 @@
+// `flat_combiner` protects a sequential data structure with flat combining.
+// Its features:
+//
+// 1. `apply(f)` publishes the operation `f(DS&)` as a `cheap_function` in a publication record of the calling thread.
+//    Records are padded to separate cache lines and chosen by `thread_slot`, so publishing touches no shared line.
+// 2. The thread which gets the combiner lock applies all published operations in one pass, while the structure
+//    stays in its cache. The other threads wait for their record to be marked done instead of queueing on a lock.
+//    Without contention the operation runs directly under the lock and nothing is published.
+// 3. Results and exceptions of `f` are returned to the calling thread. The operation lives on the caller's stack,
+//    the record only keeps a reference to it, so functors of any size are accepted without allocation.
+// 4. Operations of one thread are applied in the order of calls. Operations are applied one at a time.
+//
+// Flat combining pays off when the structure is contended and its operations are short, like a priority queue.
+
+#pragma once
+
+#include <losync/backoff.h>
+#include <losync/cache_aligned.h>
+#include <losync/cheap_function.h>
+#include <losync/mutex.h>
+#include <losync/thread_slot.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename DS>
+class flat_combiner
+{
+public:
+    // There are `default_record_count()` records, more threads share records, which is correct but slower
+    flat_combiner() : flat_combiner(std::in_place)
+    {
+    }
+
+    // Constructs the structure from `args`
+    template <typename... ArgsT>
+    explicit flat_combiner(std::in_place_t, ArgsT&&... args)
+        : mask(roundUpToPowerOfTwo(default_record_count()) - 1), records(new Record[mask + 1]),
+          data(std::forward<ArgsT>(args)...)
+    {
+    }
+
+    flat_combiner(const flat_combiner&) = delete;
+    flat_combiner& operator=(const flat_combiner&) = delete;
+
+    // Applies `func(DS&)` exclusively and returns its result or rethrows its exception
+    template <typename F>
+    std::invoke_result_t<F&, DS&> apply(F&& func)
+    {
+        using R = std::invoke_result_t<F&, DS&>;
+        if (lock.try_lock())
+        {
+            // Uncontended: the operation runs directly, the operations published meanwhile are combined after it
+            const CombineAndUnlock guard{*this};
+            return func(data);
+        }
+        using Result = std::conditional_t<std::is_void<R>::value, bool, std::optional<R>>;
+        Result result{};
+        std::exception_ptr error;
+        Record& record = claimRecord();
+        record.operation.emplace([&func, &result, &error](DS& target) {
+            try
+            {
+                if constexpr (std::is_void<R>::value)
+                {
+                    func(target);
+                }
+                else
+                {
+                    result.emplace(func(target));
+                }
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        });
+        record.state.store(Pending, std::memory_order_release);
+        waitDone(record);
+        record.state.store(Free, std::memory_order_release);
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        if constexpr (!std::is_void<R>::value)
+        {
+            return std::move(*result);
+        }
+    }
+
+    // Direct access without synchronization, for setup and inspection while no thread calls `apply`
+    DS& unsafe_data() noexcept
+    {
+        return data;
+    }
+
+    std::size_t record_count() const noexcept
+    {
+        return mask + 1;
+    }
+
+    static std::size_t default_record_count() noexcept
+    {
+        const std::size_t concurrency = std::thread::hardware_concurrency();
+        return 2 * (concurrency != 0 ? concurrency : 1);
+    }
+
+private:
+    using Operation = cheap_function<void(DS&), 64>;
+
+    enum : std::uint32_t
+    {
+        Free,
+        // Owned by a thread which writes its operation
+        Claimed,
+        Pending,
+        Done,
+    };
+
+    struct LOSYNC_CACHE_ALIGNED Record
+    {
+        std::atomic<std::uint32_t> state{Free};
+        std::optional<Operation> operation;
+    };
+
+    struct CombineAndUnlock
+    {
+        flat_combiner& owner;
+
+        ~CombineAndUnlock()
+        {
+            owner.combine();
+            owner.lock.unlock();
+        }
+    };
+
+    // Combining stops after this many passes or when a pass finds no pending operations
+    static constexpr int MaxPasses = 3;
+
+    static std::size_t roundUpToPowerOfTwo(const std::size_t value) noexcept
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // The record of the thread slot, or the next free one if a thread with a colliding slot uses it
+    Record& claimRecord() noexcept
+    {
+        for (std::size_t index = thread_slot::index();; ++index)
+        {
+            Record& record = records[index & mask];
+            std::uint32_t expected = Free;
+            if (record.state.load(std::memory_order_relaxed) == Free &&
+                record.state.compare_exchange_strong(expected, Claimed, std::memory_order_acquire))
+            {
+                raiseUsed((index & mask) + 1);
+                return record;
+            }
+            if ((index & mask) == mask)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void raiseUsed(const std::size_t count) noexcept
+    {
+        std::size_t current = used.load(std::memory_order_relaxed);
+        while (current < count && !used.compare_exchange_weak(current, count, std::memory_order_release))
+        {
+        }
+    }
+
+    // Combines while the lock is free, otherwise spins until another combiner has done the operation
+    void waitDone(Record& record) noexcept
+    {
+        exponential_backoff backoff;
+        for (;;)
+        {
+            if (record.state.load(std::memory_order_acquire) == Done)
+            {
+                return;
+            }
+            if (lock.try_lock())
+            {
+                combine();
+                lock.unlock();
+                // The own record was pending while the lock was held, so it is done now
+                continue;
+            }
+            if (!backoff.spin())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void combine() noexcept
+    {
+        const std::size_t count = used.load(std::memory_order_acquire);
+        for (int pass = 0; pass < MaxPasses; ++pass)
+        {
+            bool found = false;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                Record& record = records[i];
+                if (record.state.load(std::memory_order_acquire) != Pending)
+                {
+                    continue;
+                }
+                (*record.operation)(data);
+                record.operation.reset();
+                record.state.store(Done, std::memory_order_release);
+                found = true;
+            }
+            if (!found)
+            {
+                return;
+            }
+        }
+    }
+
+    const std::size_t mask;
+    const std::unique_ptr<Record[]> records;
+    // Records with indices below it may be claimed
+    LOSYNC_CACHE_ALIGNED std::atomic<std::size_t> used{0};
+    losync::mutex lock;
+    LOSYNC_CACHE_ALIGNED DS data;
+};
+
+} // namespace losync
@@ -0,0 +1,27 @@
+// Thin wrapper over the address-based wait and wake of the operating system:
+// `futex` on Linux, `WaitOnAddress` on Windows and a table of condition variables elsewhere.
+// Functions do no syscall when nobody waits only if the caller tracks waiters itself,
+// so synchronization primitives keep a "has waiters" state next to the word.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+namespace losync
+{
+
+// Blocks while `word == expected`. May return spuriously, so the caller should recheck its condition.
+void futex_wait(const std::atomic<std::uint32_t>& word, std::uint32_t expected) noexcept;
+
+// Like `futex_wait`, but returns after `timeout` at the latest
+void futex_wait_for(const std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                    std::chrono::nanoseconds timeout) noexcept;
+
+void futex_wake_one(const std::atomic<std::uint32_t>& word) noexcept;
+
+void futex_wake_all(const std::atomic<std::uint32_t>& word) noexcept;
+
+} // namespace losync
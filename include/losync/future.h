@@ -0,0 +1,507 @@
+// `future` and `promise` are a one-shot channel for a value or an exception, like `std::future` and `std::promise`.
+// Their features:
+//
+// 1. The shared state is a block of `pool_allocator`, not a `make_shared` allocation.
+// 2. `then(f)` attaches a continuation which is stored in the shared state as `hybrid_function`
+//    and returns the future of its result. Exceptions skip the continuations and reach the final future.
+// 3. Completion and attaching a continuation are one `fetch_or` each on the state word,
+//    whichever comes second runs the continuation. No lock is taken on either side.
+// 4. `then(executor, f)` posts the continuation to an executor with `submit(task)`, like `thread_pool`,
+//    instead of running it inline on the completing thread.
+// 5. `get` and `wait` sleep on a futex. Completion does a syscall only when somebody sleeps.
+//
+// A promise which is destroyed without a value stores `std::future_errc::broken_promise`.
+
+#pragma once
+
+#include <losync/cheap_function.h>
+#include <losync/futex.h>
+#include <losync/pool_allocator.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T>
+class future;
+
+template <typename T>
+class promise;
+
+
+namespace detail
+{
+
+struct future_unit
+{
+};
+
+template <typename T>
+using future_value_t = std::conditional_t<std::is_void<T>::value, future_unit, T>;
+
+template <typename T, typename F, bool = std::is_void<T>::value>
+struct continuation_result
+{
+    using type = std::invoke_result_t<F, T>;
+};
+
+template <typename T, typename F>
+struct continuation_result<T, F, true>
+{
+    using type = std::invoke_result_t<F>;
+};
+
+template <typename T, typename F>
+using continuation_result_t = typename continuation_result<T, F>::type;
+
+
+// Held by the promise, the future and a pending continuation, and destroyed by the last of them
+template <typename T>
+class future_state
+{
+public:
+    using value_type = future_value_t<T>;
+    using continuation = hybrid_function<void(future_state&), 128>;
+
+    static future_state* create()
+    {
+        static_assert(alignof(future_state) <= alignof(std::max_align_t),
+                      "Value requires stricter alignment than pool_allocator provides");
+        return new (pool_allocator::allocate(sizeof(future_state))) future_state();
+    }
+
+    future_state(const future_state&) = delete;
+    future_state& operator=(const future_state&) = delete;
+
+    void add_ref() noexcept
+    {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            this->~future_state();
+            pool_allocator::deallocate(this, sizeof(future_state));
+        }
+    }
+
+    template <typename... ArgsT>
+    void set_value(ArgsT&&... args)
+    {
+        new (&storage) value_type(std::forward<ArgsT>(args)...);
+        hasValue = true;
+        complete();
+    }
+
+    void set_exception(std::exception_ptr exception) noexcept
+    {
+        error = std::move(exception);
+        complete();
+    }
+
+    // Takes over the reference of the future, even if it throws. Runs the continuation right away if ready.
+    template <typename F>
+    void attach(F&& func)
+    {
+        try
+        {
+            new (&continuationStorage) continuation(std::forward<F>(func));
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+        if ((flags.fetch_or(HasContinuation, std::memory_order_acq_rel) & Ready) != 0)
+        {
+            runContinuation();
+        }
+    }
+
+    bool ready() const noexcept
+    {
+        return (flags.load(std::memory_order_acquire) & Ready) != 0;
+    }
+
+    void wait() const noexcept
+    {
+        std::uint32_t current = flags.load(std::memory_order_acquire);
+        while ((current & Ready) == 0)
+        {
+            if ((current & HasWaiters) == 0 &&
+                !flags.compare_exchange_weak(current, current | HasWaiters, std::memory_order_acquire))
+            {
+                continue;
+            }
+            futex_wait(flags, current | HasWaiters);
+            current = flags.load(std::memory_order_acquire);
+        }
+    }
+
+    // Only after the state is ready
+    const std::exception_ptr& exception() const noexcept
+    {
+        return error;
+    }
+
+    value_type& value() noexcept
+    {
+        return *std::launder(reinterpret_cast<value_type*>(&storage));
+    }
+
+private:
+    static constexpr std::uint32_t Ready = 1;
+    static constexpr std::uint32_t HasContinuation = 2;
+    static constexpr std::uint32_t HasWaiters = 4;
+
+    // The promise and the future
+    future_state() = default;
+
+    ~future_state()
+    {
+        if (hasValue)
+        {
+            value().~value_type();
+        }
+    }
+
+    void complete() noexcept
+    {
+        const std::uint32_t previous = flags.fetch_or(Ready, std::memory_order_acq_rel);
+        if ((previous & HasContinuation) != 0)
+        {
+            runContinuation();
+        }
+        else if ((previous & HasWaiters) != 0)
+        {
+            futex_wake_all(flags);
+        }
+    }
+
+    // The continuation owns the reference of the future it was attached to
+    void runContinuation() noexcept
+    {
+        continuation* const func = std::launder(reinterpret_cast<continuation*>(&continuationStorage));
+        (*func)(*this);
+        func->~continuation();
+        release();
+    }
+
+    mutable std::atomic<std::uint32_t> flags{0};
+    std::atomic<std::uint32_t> refs{2};
+    bool hasValue = false;
+    std::exception_ptr error;
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+    alignas(continuation) unsigned char continuationStorage[sizeof(continuation)];
+};
+
+struct future_state_release
+{
+    template <typename State>
+    void operator()(State* const state) const noexcept
+    {
+        state->release();
+    }
+};
+
+template <typename T>
+using future_state_ptr = std::unique_ptr<future_state<T>, future_state_release>;
+
+
+// Completes `next` with the result of `func` applied to the value of `state`, or with its exception
+template <typename T, typename F, typename R>
+void fulfil(future_state<T>& state, F& func, promise<R>& next) noexcept
+{
+    if (state.exception())
+    {
+        next.set_exception(state.exception());
+        return;
+    }
+    try
+    {
+        if constexpr (std::is_void<T>::value && std::is_void<R>::value)
+        {
+            func();
+            next.set_value();
+        }
+        else if constexpr (std::is_void<T>::value)
+        {
+            next.set_value(func());
+        }
+        else if constexpr (std::is_void<R>::value)
+        {
+            func(std::move(state.value()));
+            next.set_value();
+        }
+        else
+        {
+            next.set_value(func(std::move(state.value())));
+        }
+    }
+    catch (...)
+    {
+        next.set_exception(std::current_exception());
+    }
+}
+
+// `cheap_function` calls const functors, so the members are mutable
+template <typename T, typename F, typename R>
+struct inline_continuation
+{
+    mutable promise<R> next;
+    mutable F func;
+
+    void operator()(future_state<T>& state) const noexcept
+    {
+        fulfil(state, func, next);
+    }
+};
+
+template <typename T, typename F, typename R>
+struct posted_continuation_task
+{
+    mutable future_state_ptr<T> state;
+    mutable F func;
+    mutable promise<R> next;
+
+    void operator()() const noexcept
+    {
+        fulfil(*state, func, next);
+        state.reset();
+    }
+};
+
+template <typename T, typename F, typename R, typename Executor>
+struct posted_continuation
+{
+    Executor* executor;
+    mutable promise<R> next;
+    mutable F func;
+
+    // Runs in `future_state::runContinuation()`, so a failed submission completes `next` instead of escaping
+    void operator()(future_state<T>& state) const noexcept
+    {
+        try
+        {
+            // The task keeps the state alive: the reference of the continuation is released when it returns
+            state.add_ref();
+            posted_continuation_task<T, F, R> task{future_state_ptr<T>(&state), std::move(func), std::move(next)};
+            try
+            {
+                executor->submit(std::move(task));
+            }
+            catch (...)
+            {
+                // An executor which took the task before it failed has destroyed it with `broken_promise`
+                if (task.state != nullptr)
+                {
+                    task.next.set_exception(std::current_exception());
+                }
+            }
+        }
+        catch (...)
+        {
+            // Moving the functor into the task threw, `next` was not moved yet
+            next.set_exception(std::current_exception());
+        }
+    }
+};
+
+} // namespace detail
+
+
+template <typename T>
+class future
+{
+public:
+    future() = default;
+    future(future&&) = default;
+    future& operator=(future&&) = default;
+
+    bool valid() const noexcept
+    {
+        return state != nullptr;
+    }
+
+    bool is_ready() const
+    {
+        return checkedState().ready();
+    }
+
+    void wait() const
+    {
+        checkedState().wait();
+    }
+
+    // Waits for the result and returns it or rethrows the exception. The future becomes invalid.
+    T get()
+    {
+        checkedState().wait();
+        const detail::future_state_ptr<T> ready = std::move(state);
+        if (ready->exception())
+        {
+            std::rethrow_exception(ready->exception());
+        }
+        if constexpr (!std::is_void<T>::value)
+        {
+            return std::move(ready->value());
+        }
+    }
+
+    // Calls `func(T)` on the thread which completes the promise, or right away if it is completed.
+    // Returns the future of the result. The future becomes invalid.
+    template <typename F>
+    future<detail::continuation_result_t<T, std::decay_t<F>>> then(F&& func)
+    {
+        using R = detail::continuation_result_t<T, std::decay_t<F>>;
+        promise<R> next;
+        future<R> result = next.get_future();
+        checkedState();
+        // Built before the state is released: copying the functor may throw while the future still owns the state
+        detail::inline_continuation<T, std::decay_t<F>, R> continuation{std::move(next), std::forward<F>(func)};
+        state.release()->attach(std::move(continuation));
+        return result;
+    }
+
+    // Like `then(func)`, but the call is submitted to `executor` as a task
+    template <typename Executor, typename F>
+    future<detail::continuation_result_t<T, std::decay_t<F>>> then(Executor& executor, F&& func)
+    {
+        using R = detail::continuation_result_t<T, std::decay_t<F>>;
+        promise<R> next;
+        future<R> result = next.get_future();
+        checkedState();
+        detail::posted_continuation<T, std::decay_t<F>, R, Executor> continuation{
+            &executor, std::move(next), std::forward<F>(func)};
+        state.release()->attach(std::move(continuation));
+        return result;
+    }
+
+private:
+    friend class promise<T>;
+
+    explicit future(detail::future_state<T>* const state) : state(state)
+    {
+    }
+
+    detail::future_state<T>& checkedState() const
+    {
+        if (state == nullptr)
+        {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        return *state;
+    }
+
+    detail::future_state_ptr<T> state;
+};
+
+
+template <typename T>
+class promise
+{
+public:
+    promise() : state(detail::future_state<T>::create())
+    {
+    }
+
+    promise(promise&&) = default;
+
+    promise& operator=(promise&& other) noexcept
+    {
+        if (this != &other)
+        {
+            abandon();
+            state = std::move(other.state);
+            futureRetrieved = other.futureRetrieved;
+            satisfied = other.satisfied;
+        }
+        return *this;
+    }
+
+    ~promise()
+    {
+        abandon();
+    }
+
+    future<T> get_future()
+    {
+        if (state == nullptr)
+        {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        if (futureRetrieved)
+        {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        futureRetrieved = true;
+        return future<T>(state.get());
+    }
+
+    // Constructs the value from `args`, `set_value()` for `promise<void>`
+    template <typename... ArgsT>
+    void set_value(ArgsT&&... args)
+    {
+        checkUnsatisfied();
+        // Stays unsatisfied if the constructor of the value throws
+        state->set_value(std::forward<ArgsT>(args)...);
+        satisfied = true;
+    }
+
+    void set_exception(std::exception_ptr exception)
+    {
+        checkUnsatisfied();
+        state->set_exception(std::move(exception));
+        satisfied = true;
+    }
+
+private:
+    void checkUnsatisfied() const
+    {
+        if (state == nullptr)
+        {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        if (satisfied)
+        {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+    }
+
+    void abandon() noexcept
+    {
+        if (state == nullptr)
+        {
+            return;
+        }
+        if (!satisfied)
+        {
+            satisfied = true;
+            state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+        // The state was created with a reference for the future
+        if (!futureRetrieved)
+        {
+            state->release();
+        }
+        state.reset();
+    }
+
+    detail::future_state_ptr<T> state;
+    bool futureRetrieved = false;
+    bool satisfied = false;
+};
+
+} // namespace losync
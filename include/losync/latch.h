@@ -0,0 +1,87 @@
+// `latch` is a single-use countdown which threads wait for to reach zero, like `std::latch`.
+// Its features:
+//
+// 1. The state is one 32-bit word: the count and a "has waiters" flag.
+// 2. `count_down()` is one atomic operation and makes a syscall only when the count reaches zero while somebody sleeps.
+// 3. Waiting spins with exponential backoff on a multiprocessor before it goes to sleep on a futex.
+
+#pragma once
+
+#include <losync/backoff.h>
+#include <losync/futex.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+
+namespace losync
+{
+
+class latch
+{
+public:
+    explicit latch(const std::uint32_t expected) noexcept : state(expected << CountShift)
+    {
+        assert(expected <= max());
+    }
+
+    latch(const latch&) = delete;
+    latch& operator=(const latch&) = delete;
+
+    static constexpr std::uint32_t max() noexcept
+    {
+        return UINT32_MAX >> CountShift;
+    }
+
+    // Work done before `count_down` is visible to the threads released by it
+    void count_down(const std::uint32_t update = 1) noexcept
+    {
+        const std::uint32_t previous = state.fetch_sub(update << CountShift, std::memory_order_acq_rel);
+        assert((previous >> CountShift) >= update);
+        if ((previous >> CountShift) == update && (previous & HasWaiters) != 0)
+        {
+            futex_wake_all(state);
+        }
+    }
+
+    bool try_wait() const noexcept
+    {
+        return (state.load(std::memory_order_acquire) >> CountShift) == 0;
+    }
+
+    void wait() const noexcept
+    {
+        exponential_backoff backoff = exponential_backoff::before_sleep();
+        std::uint32_t current = state.load(std::memory_order_acquire);
+        while ((current >> CountShift) != 0)
+        {
+            if (backoff.spin())
+            {
+                current = state.load(std::memory_order_acquire);
+                continue;
+            }
+            if ((current & HasWaiters) == 0 &&
+                !state.compare_exchange_weak(current, current | HasWaiters, std::memory_order_acquire))
+            {
+                continue;
+            }
+            futex_wait(state, current | HasWaiters);
+            current = state.load(std::memory_order_acquire);
+        }
+    }
+
+    void arrive_and_wait(const std::uint32_t update = 1) noexcept
+    {
+        count_down(update);
+        wait();
+    }
+
+private:
+    static constexpr std::uint32_t HasWaiters = 1;
+    static constexpr std::uint32_t CountShift = 1;
+
+    mutable std::atomic<std::uint32_t> state;
+};
+
+} // namespace losync
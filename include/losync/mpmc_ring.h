@@ -0,0 +1,376 @@
+// `mpmc_ring` is a bounded lock-free queue with many producers and many consumers.
+// Its features:
+//
+// 1. The storage is a fixed array of slots allocated in the constructor, nothing is allocated afterwards.
+// 2. Every slot has its own sequence number (Dmitry Vyukov's bounded queue), so producers and consumers
+//    synchronize through one CAS on their position plus the slot they work with.
+// 3. Slots are padded to separate cache lines, so neighbouring producers and consumers do not false-share.
+// 4. Elements may be move-only, like `cheap_function` or `std::unique_ptr`. Constructing and moving them must not throw:
+//    a slot is claimed before the element is constructed in it, and a failure would stall the ring forever.
+// 5. `push_n` and `pop_n` claim a run of slots with one CAS.
+// 6. Blocking `push` and `pop` spin for a while and then sleep on a futex.
+//    Non-blocking operations check for sleepers with a plain load after their CAS, no fence,
+//    and do a syscall only when somebody sleeps in a blocking one.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/futex.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T>
+class mpmc_ring
+{
+    static_assert(std::is_nothrow_move_constructible_v<T>, "Elements must be nothrow move constructible");
+
+public:
+    // `capacity` is rounded up to a power of two
+    explicit mpmc_ring(const std::size_t capacity)
+        : mask(roundUpToPowerOfTwo(capacity) - 1), slots(new Slot[mask + 1])
+    {
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpmc_ring(const mpmc_ring&) = delete;
+    mpmc_ring& operator=(const mpmc_ring&) = delete;
+
+    ~mpmc_ring()
+    {
+        while (try_pop())
+        {
+        }
+    }
+
+    // Returns false if the ring is full, `value` is left untouched then
+    bool try_push(T&& value)
+    {
+        return try_emplace(std::move(value));
+    }
+
+    template <typename... ArgsT>
+    bool try_emplace(ArgsT&&... args)
+    {
+        static_assert(std::is_nothrow_constructible_v<T, ArgsT...>, "Elements must be constructed without exceptions");
+        std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = slots[pos & mask];
+            const std::intptr_t diff = sequenceDiff(slot.sequence.load(std::memory_order_acquire), pos);
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    new (&slot.storage) T(std::forward<ArgsT>(args)...);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    wakeConsumers(1);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> try_pop()
+    {
+        std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = slots[pos & mask];
+            const std::intptr_t diff = sequenceDiff(slot.sequence.load(std::memory_order_acquire), pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    std::optional<T> result = takeFrom(slot, pos);
+                    wakeProducers(1);
+                    return result;
+                }
+            }
+            else if (diff < 0)
+            {
+                return std::nullopt;
+            }
+            else
+            {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Moves up to `count` elements starting from `first` into consecutive slots claimed with one CAS.
+    // Returns the number of pushed elements, the rest are left untouched.
+    template <typename It>
+    std::size_t push_n(It first, const std::size_t count)
+    {
+        static_assert(std::is_nothrow_constructible_v<T, decltype(std::move(*first))>,
+                      "Elements must be constructed without exceptions");
+        std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        std::size_t claimed = 0;
+        for (;;)
+        {
+            claimed = 0;
+            while (claimed < count &&
+                   sequenceDiff(slots[(pos + claimed) & mask].sequence.load(std::memory_order_acquire),
+                                pos + claimed) == 0)
+            {
+                ++claimed;
+            }
+            if (claimed == 0)
+            {
+                if (sequenceDiff(slots[pos & mask].sequence.load(std::memory_order_acquire), pos) < 0)
+                {
+                    return 0;
+                }
+                pos = enqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (enqueuePos.compare_exchange_weak(pos, pos + claimed, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        for (std::size_t i = 0; i < claimed; ++i, ++first)
+        {
+            Slot& slot = slots[(pos + i) & mask];
+            new (&slot.storage) T(std::move(*first));
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        wakeConsumers(claimed);
+        return claimed;
+    }
+
+    // Moves up to `count` elements into `out` from consecutive slots claimed with one CAS.
+    // Returns the number of popped elements.
+    template <typename OutIt>
+    std::size_t pop_n(OutIt out, const std::size_t count)
+    {
+        std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        std::size_t claimed = 0;
+        for (;;)
+        {
+            claimed = 0;
+            while (claimed < count &&
+                   sequenceDiff(slots[(pos + claimed) & mask].sequence.load(std::memory_order_acquire),
+                                pos + claimed + 1) == 0)
+            {
+                ++claimed;
+            }
+            if (claimed == 0)
+            {
+                if (sequenceDiff(slots[pos & mask].sequence.load(std::memory_order_acquire), pos + 1) < 0)
+                {
+                    return 0;
+                }
+                pos = dequeuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (dequeuePos.compare_exchange_weak(pos, pos + claimed, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        for (std::size_t i = 0; i < claimed; ++i, ++out)
+        {
+            *out = *takeFrom(slots[(pos + i) & mask], pos + i);
+        }
+        wakeProducers(claimed);
+        return claimed;
+    }
+
+    // Blocks while the ring is full
+    void push(T&& value)
+    {
+        for (int spin = 0; spin < SpinCount; ++spin)
+        {
+            if (try_push(std::move(value)))
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        for (;;)
+        {
+            pushWaiters.fetch_add(1, std::memory_order_seq_cst);
+            const std::uint32_t epoch = popEpoch.load(std::memory_order_acquire);
+            const bool pushed = try_push(std::move(value));
+            if (!pushed && isFullForWaiter())
+            {
+                futex_wait(popEpoch, epoch);
+            }
+            else if (!pushed)
+            {
+                // A consumer is freeing a slot
+                std::this_thread::yield();
+            }
+            pushWaiters.fetch_sub(1, std::memory_order_relaxed);
+            if (pushed)
+            {
+                return;
+            }
+        }
+    }
+
+    // Blocks while the ring is empty
+    T pop()
+    {
+        for (int spin = 0; spin < SpinCount; ++spin)
+        {
+            if (std::optional<T> result = try_pop())
+            {
+                return std::move(*result);
+            }
+            std::this_thread::yield();
+        }
+        for (;;)
+        {
+            popWaiters.fetch_add(1, std::memory_order_seq_cst);
+            const std::uint32_t epoch = pushEpoch.load(std::memory_order_acquire);
+            std::optional<T> result = try_pop();
+            if (!result && isEmptyForWaiter())
+            {
+                futex_wait(pushEpoch, epoch);
+            }
+            else if (!result)
+            {
+                // A producer is publishing an element
+                std::this_thread::yield();
+            }
+            popWaiters.fetch_sub(1, std::memory_order_relaxed);
+            if (result)
+            {
+                return std::move(*result);
+            }
+        }
+    }
+
+    std::size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+    // Approximate number of elements
+    std::size_t size() const
+    {
+        const std::size_t dequeued = dequeuePos.load(std::memory_order_relaxed);
+        const std::size_t enqueued = enqueuePos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    struct LOSYNC_CACHE_ALIGNED Slot
+    {
+        std::atomic<std::size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr int SpinCount = 64;
+
+    static std::intptr_t sequenceDiff(const std::size_t sequence, const std::size_t expected)
+    {
+        return static_cast<std::intptr_t>(sequence - expected);
+    }
+
+    std::optional<T> takeFrom(Slot& slot, const std::size_t pos)
+    {
+        T* const value = std::launder(reinterpret_cast<T*>(&slot.storage));
+        std::optional<T> result(std::move(*value));
+        value->~T();
+        slot.sequence.store(pos + mask + 1, std::memory_order_release);
+        return result;
+    }
+
+    // Waiters register with a seq_cst RMW and then read the position of the other side, while the other side
+    // moves its position with a seq_cst CAS and then reads the number of waiters. Either the waiter sees the moved
+    // position and does not sleep, or the other side sees the waiter and wakes it. Both loads are plain on x86.
+    bool isEmptyForWaiter() const noexcept
+    {
+        const std::size_t enqueued = enqueuePos.load(std::memory_order_seq_cst);
+        return dequeuePos.load(std::memory_order_relaxed) == enqueued;
+    }
+
+    bool isFullForWaiter() const noexcept
+    {
+        const std::size_t dequeued = dequeuePos.load(std::memory_order_seq_cst);
+        return enqueuePos.load(std::memory_order_relaxed) - dequeued > mask;
+    }
+
+    void wakeConsumers(const std::size_t pushed)
+    {
+        if (popWaiters.load(std::memory_order_seq_cst) != 0)
+        {
+            pushEpoch.fetch_add(1, std::memory_order_release);
+            wake(pushEpoch, pushed);
+        }
+    }
+
+    void wakeProducers(const std::size_t popped)
+    {
+        if (pushWaiters.load(std::memory_order_seq_cst) != 0)
+        {
+            popEpoch.fetch_add(1, std::memory_order_release);
+            wake(popEpoch, popped);
+        }
+    }
+
+    // One element is enough for one waiter
+    static void wake(const std::atomic<std::uint32_t>& epoch, const std::size_t count)
+    {
+        if (count == 1)
+        {
+            futex_wake_one(epoch);
+        }
+        else
+        {
+            futex_wake_all(epoch);
+        }
+    }
+
+    static std::size_t roundUpToPowerOfTwo(const std::size_t value)
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    LOSYNC_CACHE_ALIGNED std::atomic<std::size_t> enqueuePos{0};
+    LOSYNC_CACHE_ALIGNED std::atomic<std::size_t> dequeuePos{0};
+
+    // Blocking operations sleep on the epoch of the opposite side
+    LOSYNC_CACHE_ALIGNED std::atomic<std::uint32_t> pushEpoch{0};
+    std::atomic<std::uint32_t> popWaiters{0};
+    LOSYNC_CACHE_ALIGNED std::atomic<std::uint32_t> popEpoch{0};
+    std::atomic<std::uint32_t> pushWaiters{0};
+
+    const std::size_t mask;
+    const std::unique_ptr<Slot[]> slots;
+};
+
+} // namespace losync
@@ -0,0 +1,311 @@
+// `mpsc_queue` is a lock-free queue with many producers and a single consumer.
+// Its features:
+//
+// 1. Elements are stored in place in queue nodes, by default they are `cheap_function<void()>` tasks.
+// 2. Nodes are allocated in segments which are never freed until the queue is destroyed.
+//    Consumed nodes are recycled, so producers allocate only while the queue grows beyond its previous maximum.
+// 3. A push is one CAS on the shared stack of pushed nodes.
+//    The consumer takes everything pushed so far with one atomic exchange and then works without atomics.
+// 4. Elements pushed by one producer are consumed in the order of pushing.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/cheap_function.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T = cheap_function<void()>>
+class mpsc_queue
+{
+public:
+    mpsc_queue() = default;
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    ~mpsc_queue()
+    {
+        drain([](T&) {});
+        for (std::size_t i = 0; i < MaxSegments; ++i)
+        {
+            Node* const segment = segments[i].load(std::memory_order_relaxed);
+            if (segment != nullptr)
+            {
+                ::operator delete(segment, std::align_val_t{alignof(Node)});
+            }
+        }
+    }
+
+    // Constructs the element in place. Safe to call from any thread.
+    // Returns true if the queue had no pushed elements which were not yet taken by the consumer.
+    template <typename... ArgsT>
+    bool push(ArgsT&&... args)
+    {
+        Node* const node = acquireNode();
+        try
+        {
+            new (&node->storage) T(std::forward<ArgsT>(args)...);
+        }
+        catch (...)
+        {
+            releaseNodes(node, node);
+            throw;
+        }
+
+        Node* head = pushed.load(std::memory_order_relaxed);
+        do
+        {
+            node->next = head;
+        } while (!pushed.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // Passes up to `maxCount` elements in FIFO order to `consumer(T&)` and destroys them.
+    // Returns the number of consumed elements. Only the consumer thread may call it.
+    template <typename Consumer>
+    std::size_t drain(Consumer&& consumer, const std::size_t maxCount = ~std::size_t{0})
+    {
+        std::size_t count = 0;
+        FreeList freed;
+        try
+        {
+            while (count < maxCount)
+            {
+                if (taken == nullptr && !takePushed())
+                {
+                    break;
+                }
+                Node* const node = taken;
+                taken = node->next;
+                ++count;
+
+                NodeGuard guard{node, freed};
+                consumer(*guard.value());
+            }
+        }
+        catch (...)
+        {
+            if (freed.head != nullptr)
+            {
+                releaseNodes(freed.head, freed.tail);
+            }
+            throw;
+        }
+        if (freed.head != nullptr)
+        {
+            releaseNodes(freed.head, freed.tail);
+        }
+        return count;
+    }
+
+    // Invokes up to `maxCount` tasks. Only the consumer thread may call it.
+    std::size_t run(const std::size_t maxCount = ~std::size_t{0})
+    {
+        return drain([](T& task) { task(); }, maxCount);
+    }
+
+    // Whether producers pushed elements which the consumer has not taken yet. Any thread may call it.
+    bool has_pushed() const
+    {
+        return pushed.load(std::memory_order_acquire) != nullptr;
+    }
+
+    // Only the consumer thread may call it
+    bool empty() const
+    {
+        return taken == nullptr && pushed.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        Node* next;
+        std::atomic<std::uint32_t> freeNext;
+        std::uint32_t index;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct FreeList
+    {
+        Node* head = nullptr;
+        Node* tail = nullptr;
+    };
+
+    // Destroys the element and puts the node into the list of freed nodes even if the consumer throws
+    struct NodeGuard
+    {
+        Node* node;
+        FreeList& freed;
+
+        T* value() const
+        {
+            return std::launder(reinterpret_cast<T*>(&node->storage));
+        }
+
+        ~NodeGuard()
+        {
+            value()->~T();
+            node->freeNext.store(freed.head != nullptr ? freed.head->index : NoIndex, std::memory_order_relaxed);
+            freed.head = node;
+            if (freed.tail == nullptr)
+            {
+                freed.tail = node;
+            }
+        }
+    };
+
+    // Segment `i` holds `FirstSegmentSize << i` nodes
+    static constexpr std::uint32_t FirstSegmentSize = 4;
+    static constexpr std::size_t MaxSegments = 28;
+    static constexpr std::uint32_t NoIndex = ~std::uint32_t{0};
+
+    // The free list head packs the index of the first node with a tag which is changed on every update,
+    // so a pop which read a stale head cannot succeed (ABA problem)
+    static constexpr std::uint64_t pack(const std::uint32_t index, const std::uint64_t tag)
+    {
+        return (tag << 32) | index;
+    }
+
+    static constexpr std::uint32_t indexOf(const std::uint64_t head)
+    {
+        return static_cast<std::uint32_t>(head);
+    }
+
+    static constexpr std::uint64_t nextTag(const std::uint64_t head)
+    {
+        return (head >> 32) + 1;
+    }
+
+    Node* nodeAt(const std::uint32_t index) const
+    {
+        // Segment `i` starts at index `FirstSegmentSize * (2^i - 1)`
+        const std::uint32_t segment = floorLog2(index / FirstSegmentSize + 1);
+        const std::uint32_t first = FirstSegmentSize * ((1u << segment) - 1);
+        return segments[segment].load(std::memory_order_acquire) + (index - first);
+    }
+
+    static std::uint32_t floorLog2(const std::uint32_t value)
+    {
+#if defined(__GNUC__)
+        return 31 - __builtin_clz(value);
+#else
+        std::uint32_t result = 0;
+        for (std::uint32_t rest = value >> 1; rest != 0; rest >>= 1)
+        {
+            ++result;
+        }
+        return result;
+#endif
+    }
+
+    bool takePushed()
+    {
+        Node* node = pushed.exchange(nullptr, std::memory_order_acquire);
+        if (node == nullptr)
+        {
+            return false;
+        }
+        // The stack holds the most recent element first, reverse it into FIFO order
+        Node* reversed = nullptr;
+        while (node != nullptr)
+        {
+            Node* const next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+        taken = reversed;
+        return true;
+    }
+
+    Node* acquireNode()
+    {
+        std::uint64_t head = freeHead.load(std::memory_order_acquire);
+        for (;;)
+        {
+            const std::uint32_t index = indexOf(head);
+            if (index == NoIndex)
+            {
+                if (Node* const node = addSegment())
+                {
+                    return node;
+                }
+                head = freeHead.load(std::memory_order_acquire);
+                continue;
+            }
+            // The node may be taken by another producer meanwhile, then the tag makes the CAS fail
+            Node* const node = nodeAt(index);
+            const std::uint32_t next = node->freeNext.load(std::memory_order_relaxed);
+            if (freeHead.compare_exchange_weak(head, pack(next, nextTag(head)), std::memory_order_acquire,
+                                               std::memory_order_acquire))
+            {
+                return node;
+            }
+        }
+    }
+
+    void releaseNodes(Node* first, Node* last)
+    {
+        std::uint64_t head = freeHead.load(std::memory_order_relaxed);
+        do
+        {
+            last->freeNext.store(indexOf(head), std::memory_order_relaxed);
+        } while (!freeHead.compare_exchange_weak(head, pack(first->index, nextTag(head)), std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    }
+
+    // Returns one node of the new segment and puts the others into the free list.
+    // Returns nullptr if another producer added a segment concurrently.
+    Node* addSegment()
+    {
+        std::size_t segment = segmentCount.load(std::memory_order_acquire);
+        if (segment == MaxSegments)
+        {
+            throw std::bad_alloc();
+        }
+        const std::uint32_t size = FirstSegmentSize << segment;
+        const std::uint32_t first = FirstSegmentSize * ((1u << segment) - 1);
+
+        Node* const nodes =
+            static_cast<Node*>(::operator new(sizeof(Node) * size, std::align_val_t{alignof(Node)}));
+        Node* expected = nullptr;
+        if (!segments[segment].compare_exchange_strong(expected, nodes, std::memory_order_acq_rel))
+        {
+            ::operator delete(nodes, std::align_val_t{alignof(Node)});
+            return nullptr;
+        }
+        segmentCount.store(segment + 1, std::memory_order_release);
+
+        for (std::uint32_t i = 0; i < size; ++i)
+        {
+            new (&nodes[i]) Node;
+            nodes[i].index = first + i;
+            nodes[i].freeNext.store(first + i + 1, std::memory_order_relaxed);
+        }
+        if (size > 1)
+        {
+            releaseNodes(&nodes[1], &nodes[size - 1]);
+        }
+        return &nodes[0];
+    }
+
+    // Stack of pushed nodes, the most recent first
+    LOSYNC_CACHE_ALIGNED std::atomic<Node*> pushed{nullptr};
+
+    LOSYNC_CACHE_ALIGNED std::atomic<std::uint64_t> freeHead{pack(NoIndex, 0)};
+    std::atomic<std::size_t> segmentCount{0};
+    std::atomic<Node*> segments[MaxSegments] = {};
+
+    // Nodes taken by the consumer in FIFO order, accessed only by the consumer
+    LOSYNC_CACHE_ALIGNED Node* taken = nullptr;
+};
+
+} // namespace losync
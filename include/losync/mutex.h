@@ -0,0 +1,141 @@
+// `mutex` is a compact mutex which spins briefly and then sleeps on a futex.
+// Its features:
+//
+// 1. The state is one 32-bit word: unlocked, locked, or locked with sleeping waiters.
+// 2. Uncontended `lock()` is one CAS and `unlock()` is one exchange, no syscall is made unless somebody sleeps.
+// 3. A contended `lock()` spins with exponential backoff before it goes to sleep.
+// 4. It meets the Lockable requirements, so it works with `std::lock_guard`, `std::unique_lock` and `std::scoped_lock`.
+// 5. When the library is built with LOSYNC_ENABLE_MUTEX_PROFILING, every mutex remembers where it was declared
+//    and every thread accumulates wait and hold times per such lock site. `mutex_profile::collect()` reports them.
+
+#pragma once
+
+#include <losync/futex.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+
+namespace losync
+{
+
+// Statistics of all mutexes declared at one source location
+struct mutex_site_stats
+{
+    const char* file = nullptr;
+    unsigned line = 0;
+    std::uint64_t acquisitions = 0;
+    // Acquisitions which had to wait
+    std::uint64_t contended = 0;
+    std::uint64_t wait_ns = 0;
+    std::uint64_t max_wait_ns = 0;
+    std::uint64_t hold_ns = 0;
+    std::uint64_t max_hold_ns = 0;
+};
+
+
+class mutex_profile
+{
+public:
+    // Whether the library was built with LOSYNC_ENABLE_MUTEX_PROFILING
+    static bool enabled() noexcept;
+
+    // Merges statistics of all threads, including exited ones. Sites which waited the longest come first.
+    // Returns nothing if profiling is disabled.
+    static std::vector<mutex_site_stats> collect();
+};
+
+
+namespace detail
+{
+
+#if defined(LOSYNC_MUTEX_PROFILING)
+std::uint64_t mutex_clock_ns() noexcept;
+void record_mutex_use(const char* file, unsigned line, std::uint64_t waitNs, std::uint64_t holdNs) noexcept;
+#endif
+
+} // namespace detail
+
+
+class mutex
+{
+public:
+#if defined(LOSYNC_MUTEX_PROFILING)
+    // The default arguments capture the place where the mutex is declared, it becomes the lock site
+    constexpr explicit mutex(const char* file = __builtin_FILE(), const unsigned line = __builtin_LINE()) noexcept
+        : file(file), line(line)
+    {
+    }
+#else
+    constexpr mutex() noexcept = default;
+#endif
+
+    mutex(const mutex&) = delete;
+    mutex& operator=(const mutex&) = delete;
+
+    void lock() noexcept
+    {
+#if defined(LOSYNC_MUTEX_PROFILING)
+        const std::uint64_t start = detail::mutex_clock_ns();
+#endif
+        std::uint32_t expected = Unlocked;
+        if (!state.compare_exchange_strong(expected, Locked, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            lockSlow();
+#if defined(LOSYNC_MUTEX_PROFILING)
+            lockedAt = detail::mutex_clock_ns();
+            waitNs = lockedAt - start;
+            return;
+#endif
+        }
+#if defined(LOSYNC_MUTEX_PROFILING)
+        lockedAt = start;
+        waitNs = 0;
+#endif
+    }
+
+    bool try_lock() noexcept
+    {
+        std::uint32_t expected = Unlocked;
+        if (!state.compare_exchange_strong(expected, Locked, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            return false;
+        }
+#if defined(LOSYNC_MUTEX_PROFILING)
+        lockedAt = detail::mutex_clock_ns();
+        waitNs = 0;
+#endif
+        return true;
+    }
+
+    void unlock() noexcept
+    {
+#if defined(LOSYNC_MUTEX_PROFILING)
+        detail::record_mutex_use(file, line, waitNs, detail::mutex_clock_ns() - lockedAt);
+#endif
+        if (state.exchange(Unlocked, std::memory_order_release) == LockedWithWaiters)
+        {
+            futex_wake_one(state);
+        }
+    }
+
+private:
+    static constexpr std::uint32_t Unlocked = 0;
+    static constexpr std::uint32_t Locked = 1;
+    static constexpr std::uint32_t LockedWithWaiters = 2;
+
+    void lockSlow() noexcept;
+
+    std::atomic<std::uint32_t> state{Unlocked};
+
+#if defined(LOSYNC_MUTEX_PROFILING)
+    const char* const file;
+    const unsigned line;
+    // Written only by the owner
+    std::uint64_t lockedAt = 0;
+    std::uint64_t waitNs = 0;
+#endif
+};
+
+} // namespace losync
@@ -0,0 +1,395 @@
+// `object_pool<T>` is a slab allocator of objects of one type for nodes which are allocated and freed
+// on different threads, like queue nodes, shared states and retired pointers.
+// Its features:
+//
+// 1. Objects are carved from slabs of 64KB aligned to their size, so the slab of an object is found by masking
+//    its address. Every slab is owned by one heap, and every heap is used by one thread chosen by `thread_slot`.
+// 2. A thread allocates from the free list of its current slab, which works as its magazine: no locks and no atomic
+//    operations. A fresh slab is carved lazily, so its memory is touched only when it is used.
+// 3. Freeing an object of its own slab is a push onto the same free list. An object of a slab owned by another
+//    thread is pushed with one CAS onto the lock-free remote free list of that slab. The owner takes the whole
+//    remote list with one exchange when its local list runs out, so producer-consumer traffic costs one atomic
+//    operation on each side per object and the objects go back to the producer.
+// 4. A slab which becomes empty is returned to a depot shared by all heaps, where other threads take it.
+//    The depot keeps as many empty slabs as there are heaps and frees the rest.
+// 5. A heap belongs to the thread slot, not to the thread: the next thread which gets the slot continues
+//    with the slabs of the exited one. Threads whose slot exceeds the number of heaps share a heap under a lock.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/mutex.h>
+#include <losync/thread_slot.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T>
+class object_pool
+{
+public:
+    static constexpr std::size_t slab_size = 64 * 1024;
+
+    object_pool() : object_pool(default_heap_count())
+    {
+    }
+
+    explicit object_pool(const std::size_t heaps) : heapCount(heaps), heaps(new Heap[heaps])
+    {
+    }
+
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    // All objects must be freed before, their destructors are not called
+    ~object_pool()
+    {
+        for (std::size_t i = 0; i < heapCount; ++i)
+        {
+            freeHeapSlabs(heaps[i]);
+        }
+        freeHeapSlabs(shared);
+        while (depot != nullptr)
+        {
+            Slab* const slab = depot;
+            depot = slab->next;
+            freeSlab(slab);
+        }
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        void* const memory = allocate();
+        try
+        {
+            return new (memory) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            deallocate(memory);
+            throw;
+        }
+    }
+
+    // May be called on any thread
+    void destroy(T* const object) noexcept
+    {
+        object->~T();
+        deallocate(object);
+    }
+
+    // Memory for one `T`
+    void* allocate()
+    {
+        const std::size_t slot = thread_slot::index();
+        if (slot >= heapCount)
+        {
+            std::lock_guard<losync::mutex> lock(sharedLock);
+            return allocateFrom(shared);
+        }
+        return allocateFrom(heaps[slot]);
+    }
+
+    void deallocate(void* const ptr) noexcept
+    {
+        assert(ptr != nullptr);
+        FreeObject* const object = static_cast<FreeObject*>(ptr);
+        Slab* const slab = slabOf(ptr);
+        const std::size_t slot = thread_slot::index();
+        if (slot < heapCount && slab->owner == &heaps[slot])
+        {
+            object->next = slab->localFree;
+            slab->localFree = object;
+            if (--slab->used == 0 && slab != heaps[slot].active)
+            {
+                unlink(heaps[slot], slab);
+                release(slab);
+            }
+            return;
+        }
+        FreeObject* head = slab->remoteFree.load(std::memory_order_relaxed);
+        do
+        {
+            object->next = head;
+        } while (!slab->remoteFree.compare_exchange_weak(head, object, std::memory_order_release,
+                                                         std::memory_order_relaxed));
+    }
+
+    // Slabs allocated from the system and not freed yet, including empty ones in the depot
+    std::size_t slab_count() const noexcept
+    {
+        return slabCount.load(std::memory_order_relaxed);
+    }
+
+    std::size_t empty_slab_count() const
+    {
+        std::lock_guard<losync::mutex> lock(depotLock);
+        return depotCount;
+    }
+
+    static constexpr std::size_t objects_per_slab() noexcept
+    {
+        return ObjectsPerSlab;
+    }
+
+    static std::size_t default_heap_count() noexcept
+    {
+        // A heap is one cache line, so there are spare heaps for threads which come and go
+        const std::size_t concurrency = std::thread::hardware_concurrency();
+        return std::max<std::size_t>(4 * (concurrency != 0 ? concurrency : 1), 16);
+    }
+
+private:
+    struct FreeObject
+    {
+        FreeObject* next;
+    };
+
+    struct Heap;
+
+    struct Slab
+    {
+        // Changes only while the slab is empty, so nobody frees into it
+        Heap* owner = nullptr;
+        // Fields below are accessed only by the thread of the owner
+        FreeObject* localFree = nullptr;
+        // Objects which are allocated or whose remote free is not collected yet
+        std::uint32_t used = 0;
+        // Objects [0, carved) were handed out at least once
+        std::uint32_t carved = 0;
+        // The ring of inactive slabs of the owner, or the depot list
+        Slab* next = nullptr;
+        Slab* prev = nullptr;
+
+        LOSYNC_CACHE_ALIGNED std::atomic<FreeObject*> remoteFree{nullptr};
+    };
+
+    struct LOSYNC_CACHE_ALIGNED Heap
+    {
+        Slab* active = nullptr;
+        // Any slab of the ring, which holds the other slabs of the heap
+        Slab* inactive = nullptr;
+    };
+
+    static constexpr std::size_t ObjectAlign = std::max(alignof(T), alignof(FreeObject));
+    static constexpr std::size_t ObjectSize =
+        (std::max(sizeof(T), sizeof(FreeObject)) + ObjectAlign - 1) / ObjectAlign * ObjectAlign;
+    static constexpr std::size_t ObjectsOffset =
+        (sizeof(Slab) + ObjectAlign - 1) / ObjectAlign * ObjectAlign;
+    static constexpr std::uint32_t ObjectsPerSlab =
+        static_cast<std::uint32_t>((slab_size - ObjectsOffset) / ObjectSize);
+    // Inactive slabs inspected for collected remote frees before a slab is taken from the depot
+    static constexpr int ScanLimit = 4;
+
+    static_assert(ObjectAlign <= cache_line_size, "Alignment stricter than a cache line is not supported");
+    static_assert(ObjectsPerSlab >= 8, "Object is too large for the slabs of the pool");
+
+    static Slab* slabOf(void* const ptr) noexcept
+    {
+        return reinterpret_cast<Slab*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(slab_size - 1));
+    }
+
+    static FreeObject* objectAt(Slab* const slab, const std::uint32_t index) noexcept
+    {
+        return reinterpret_cast<FreeObject*>(reinterpret_cast<char*>(slab) + ObjectsOffset + index * ObjectSize);
+    }
+
+    // Takes a free object of the slab, the caller owns it
+    static FreeObject* takeLocal(Slab* const slab) noexcept
+    {
+        if (FreeObject* const object = slab->localFree)
+        {
+            slab->localFree = object->next;
+            ++slab->used;
+            return object;
+        }
+        if (slab->carved != ObjectsPerSlab)
+        {
+            ++slab->used;
+            return objectAt(slab, slab->carved++);
+        }
+        return nullptr;
+    }
+
+    // Moves remote frees to the local list, which must be empty
+    static void collectRemote(Slab* const slab) noexcept
+    {
+        if (slab->remoteFree.load(std::memory_order_relaxed) == nullptr)
+        {
+            return;
+        }
+        FreeObject* const head = slab->remoteFree.exchange(nullptr, std::memory_order_acquire);
+        std::uint32_t count = 0;
+        for (FreeObject* object = head; object != nullptr; object = object->next)
+        {
+            ++count;
+        }
+        slab->localFree = head;
+        slab->used -= count;
+    }
+
+    void* allocateFrom(Heap& heap)
+    {
+        if (heap.active != nullptr)
+        {
+            if (FreeObject* const object = takeLocal(heap.active))
+            {
+                return object;
+            }
+            collectRemote(heap.active);
+            if (FreeObject* const object = takeLocal(heap.active))
+            {
+                return object;
+            }
+            // The active slab is full: it waits in the ring for remote frees
+            link(heap, heap.active);
+            heap.active = nullptr;
+        }
+
+        // Remote frees are seen only here, so slabs which became empty go to the depot here
+        for (int i = 0; i < ScanLimit && heap.inactive != nullptr; ++i)
+        {
+            Slab* const slab = heap.inactive;
+            heap.inactive = slab->next;
+            collectRemote(slab);
+            if (slab->used == 0 && heap.active != nullptr)
+            {
+                unlink(heap, slab);
+                release(slab);
+            }
+            else if (slab->localFree != nullptr && heap.active == nullptr)
+            {
+                unlink(heap, slab);
+                heap.active = slab;
+            }
+        }
+        if (heap.active == nullptr)
+        {
+            heap.active = acquire(heap);
+        }
+        return takeLocal(heap.active);
+    }
+
+    // Inserts the slab into the ring before its current position, so it is inspected last
+    static void link(Heap& heap, Slab* const slab) noexcept
+    {
+        if (heap.inactive == nullptr)
+        {
+            slab->next = slab;
+            slab->prev = slab;
+            heap.inactive = slab;
+            return;
+        }
+        slab->next = heap.inactive;
+        slab->prev = heap.inactive->prev;
+        slab->prev->next = slab;
+        heap.inactive->prev = slab;
+    }
+
+    static void unlink(Heap& heap, Slab* const slab) noexcept
+    {
+        if (slab->next == slab)
+        {
+            heap.inactive = nullptr;
+        }
+        else
+        {
+            slab->prev->next = slab->next;
+            slab->next->prev = slab->prev;
+            if (heap.inactive == slab)
+            {
+                heap.inactive = slab->next;
+            }
+        }
+        slab->next = nullptr;
+        slab->prev = nullptr;
+    }
+
+    // An empty slab from the depot or from the system
+    Slab* acquire(Heap& heap)
+    {
+        Slab* slab = nullptr;
+        {
+            std::lock_guard<losync::mutex> lock(depotLock);
+            if (depot != nullptr)
+            {
+                slab = depot;
+                depot = slab->next;
+                --depotCount;
+            }
+        }
+        if (slab == nullptr)
+        {
+            slab = new (::operator new(slab_size, std::align_val_t(slab_size))) Slab();
+            slabCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        slab->next = nullptr;
+        slab->owner = &heap;
+        return slab;
+    }
+
+    // The slab is empty and unlinked from its heap
+    void release(Slab* const slab) noexcept
+    {
+        slab->owner = nullptr;
+        {
+            std::lock_guard<losync::mutex> lock(depotLock);
+            if (depotCount < heapCount)
+            {
+                slab->next = depot;
+                depot = slab;
+                ++depotCount;
+                return;
+            }
+        }
+        freeSlab(slab);
+        slabCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    static void freeSlab(Slab* const slab) noexcept
+    {
+        slab->~Slab();
+        ::operator delete(slab, std::align_val_t(slab_size));
+    }
+
+    static void freeHeapSlabs(Heap& heap) noexcept
+    {
+        if (heap.active != nullptr)
+        {
+            freeSlab(heap.active);
+        }
+        while (heap.inactive != nullptr)
+        {
+            Slab* const slab = heap.inactive;
+            unlink(heap, slab);
+            freeSlab(slab);
+        }
+    }
+
+    const std::size_t heapCount;
+    const std::unique_ptr<Heap[]> heaps;
+
+    // For threads whose slot exceeds the number of heaps
+    losync::mutex sharedLock;
+    Heap shared;
+
+    mutable losync::mutex depotLock;
+    Slab* depot = nullptr;
+    std::size_t depotCount = 0;
+    std::atomic<std::size_t> slabCount{0};
+};
+
+} // namespace losync
@@ -0,0 +1,32 @@
+// `pool_allocator` is a thread-caching allocator of small blocks grouped into size classes.
+// Its features:
+//
+// 1. Each thread keeps a cache of free blocks for every size class.
+//    Allocation and deallocation which hit the cache take no locks and do no atomic operations.
+// 2. Thread caches exchange blocks with a global depot in batches, so the depot lock is rare.
+// 3. A block may be freed by any thread, it goes to the cache of that thread.
+// 4. Memory of the pool is never returned to the system.
+//    Blocks larger than `max_block_size` are allocated with the global `operator new`.
+// 5. Blocks are aligned to `alignof(std::max_align_t)`.
+
+#pragma once
+
+#include <cstddef>
+
+
+namespace losync
+{
+
+class pool_allocator
+{
+public:
+    static constexpr std::size_t min_block_size = 32;
+    static constexpr std::size_t max_block_size = 4096;
+
+    static void* allocate(std::size_t size);
+
+    // `size` should be the same as the one passed to `allocate`
+    static void deallocate(void* ptr, std::size_t size) noexcept;
+};
+
+} // namespace losync
@@ -0,0 +1,168 @@
+// `rcu_cell` holds an object which is read far more often than replaced, like a configuration or a routing table.
+// Its features:
+//
+// 1. Readers are wait-free and do no atomic RMW: entering a read section stores the current global epoch
+//    into the thread's own reader record, padded to a separate cache line, and issues a fence.
+// 2. A writer publishes a new object with one atomic exchange and never waits for readers.
+//    The old object is retired with the epoch of the replacement and destroyed by a later update
+//    or `reclaim()` once every reader which could have seen it has left its read section (a grace period).
+// 3. Read sections may be nested. All cells share the epoch domain of `losync/epoch_domain.h`.
+// 4. Writers are serialized by a mutex, `update(f)` applies `f` to a copy of the current object.
+
+#pragma once
+
+#include <losync/epoch_domain.h>
+#include <losync/mutex.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+namespace losync
+{
+
+template <typename T>
+class rcu_cell
+{
+public:
+    // Keeps the read section open and the object alive while it exists
+    class read_guard
+    {
+    public:
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+
+        ~read_guard()
+        {
+            detail::rcu_read_unlock();
+        }
+
+        const T* get() const noexcept
+        {
+            return object;
+        }
+
+        const T& operator*() const noexcept
+        {
+            return *object;
+        }
+
+        const T* operator->() const noexcept
+        {
+            return object;
+        }
+
+    private:
+        friend class rcu_cell;
+
+        explicit read_guard(const std::atomic<T*>& current) noexcept
+        {
+            detail::rcu_read_lock();
+            object = current.load(std::memory_order_acquire);
+        }
+
+        const T* object;
+    };
+
+    template <typename... ArgsT>
+    explicit rcu_cell(ArgsT&&... args) : current(new T(std::forward<ArgsT>(args)...))
+    {
+    }
+
+    rcu_cell(const rcu_cell&) = delete;
+    rcu_cell& operator=(const rcu_cell&) = delete;
+
+    // No thread may read the cell anymore
+    ~rcu_cell()
+    {
+        delete current.load(std::memory_order_relaxed);
+        for (const Retired& retired : retiredObjects)
+        {
+            delete retired.object;
+        }
+    }
+
+    read_guard read() const noexcept
+    {
+        return read_guard(current);
+    }
+
+    // Publishes `value` and retires the previous object. Readers are never blocked.
+    void store(std::unique_ptr<T> value)
+    {
+        std::lock_guard<losync::mutex> lock(writerMutex);
+        publish(std::move(value));
+    }
+
+    template <typename... ArgsT>
+    void emplace(ArgsT&&... args)
+    {
+        store(std::make_unique<T>(std::forward<ArgsT>(args)...));
+    }
+
+    // Publishes a copy of the current object modified by `func(T&)`. Concurrent updates are applied one by one.
+    template <typename F>
+    void update(F&& func)
+    {
+        std::lock_guard<losync::mutex> lock(writerMutex);
+        auto value = std::make_unique<T>(*current.load(std::memory_order_relaxed));
+        func(*value);
+        publish(std::move(value));
+    }
+
+    // Destroys retired objects whose grace period has passed. Returns the number of objects still waiting.
+    std::size_t reclaim()
+    {
+        std::lock_guard<losync::mutex> lock(writerMutex);
+        return reclaimLocked();
+    }
+
+private:
+    struct Retired
+    {
+        T* object;
+        std::uint64_t epoch;
+    };
+
+    void publish(std::unique_ptr<T> value)
+    {
+        retiredObjects.reserve(retiredObjects.size() + 1);
+        T* const previous = current.exchange(value.release(), std::memory_order_acq_rel);
+        retiredObjects.push_back(Retired{previous, detail::rcu_advance_epoch()});
+        reclaimLocked();
+    }
+
+    std::size_t reclaimLocked()
+    {
+        if (retiredObjects.empty())
+        {
+            return 0;
+        }
+        const std::uint64_t oldest = detail::rcu_oldest_active_epoch();
+        std::size_t kept = 0;
+        for (const Retired& retired : retiredObjects)
+        {
+            if (retired.epoch < oldest)
+            {
+                delete retired.object;
+            }
+            else
+            {
+                retiredObjects[kept++] = retired;
+            }
+        }
+        retiredObjects.resize(kept);
+        return kept;
+    }
+
+    std::atomic<T*> current;
+    losync::mutex writerMutex;
+    std::vector<Retired> retiredObjects;
+};
+
+} // namespace losync
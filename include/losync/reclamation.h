@@ -0,0 +1,153 @@
+// Memory reclamation for lock-free data structures: `ebr` (epoch-based reclamation) and `hazard_pointers`.
+// Their features:
+//
+// 1. Both schemes share one API: an unlinked object is passed to `retire(ptr, deleter)`
+//    and destroyed once no thread can access it anymore.
+// 2. Deleters are stored as `cheap_function_64<void()>`, so retiring does not allocate a deleter.
+// 3. Retired objects are collected in per-thread batches, a batch is examined when it grows to `batch_size`.
+//    Objects left by exited threads are handed over to the threads which retire next.
+// 4. `ebr` readers wrap accesses into `ebr::guard`: it is a read section of `losync/epoch_domain.h`
+//    and costs a store and a fence. A stalled reader delays reclamation of all objects.
+// 5. `hazard_pointers` readers publish every pointer they dereference through a `hazard_pointers::holder`.
+//    A stalled reader delays reclamation of the objects it protects only.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/cheap_function.h>
+#include <losync/epoch_domain.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+
+namespace losync
+{
+
+namespace detail
+{
+
+using reclaim_deleter = cheap_function_64<void()>;
+
+struct retired_object
+{
+    reclaim_deleter deleter;
+    const void* pointer;
+    // Epoch advanced by the first collection which saw the object, 0 before that. Used by `ebr` only.
+    std::uint64_t epoch;
+};
+
+} // namespace detail
+
+
+class ebr
+{
+public:
+    static constexpr std::size_t batch_size = 64;
+
+    // Objects reachable while the guard exists are not destroyed
+    class guard
+    {
+    public:
+        guard() noexcept
+        {
+            detail::rcu_read_lock();
+        }
+
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+        ~guard()
+        {
+            detail::rcu_read_unlock();
+        }
+    };
+
+    // `ptr` should be unlinked: threads which enter a guard afterwards must not be able to reach it
+    template <typename T, typename Deleter = std::default_delete<T>>
+    static void retire(T* ptr, Deleter deleter = Deleter())
+    {
+        retireErased(ptr, detail::reclaim_deleter([ptr, deleter = std::move(deleter)]() { deleter(ptr); }));
+    }
+
+    // Destroys retired objects whose grace period has passed.
+    // Returns the number of objects retired by the calling thread which are still waiting.
+    static std::size_t collect();
+
+    // Retired objects of all threads which are not destroyed yet
+    static std::int64_t unreclaimed() noexcept;
+
+private:
+    static void retireErased(const void* ptr, detail::reclaim_deleter&& deleter);
+};
+
+
+class hazard_pointers
+{
+public:
+    static constexpr std::size_t slots_per_thread = 4;
+    static constexpr std::size_t batch_size = 64;
+
+    // One hazard pointer of the calling thread. It should not be passed to other threads.
+    class holder
+    {
+    public:
+        // Throws std::length_error if the thread already uses `slots_per_thread` holders
+        holder();
+
+        holder(const holder&) = delete;
+        holder& operator=(const holder&) = delete;
+
+        ~holder();
+
+        // Loads the pointer from `source` and protects it. The object stays alive until the holder
+        // protects something else or is reset, even if it is unlinked and retired meanwhile.
+        template <typename T>
+        T* protect(const std::atomic<T*>& source) noexcept
+        {
+            T* ptr = source.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                slot->store(ptr, std::memory_order_relaxed);
+                // Pairs with the fence of the collector: either it sees the hazard or we see the unlink
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                T* const current = source.load(std::memory_order_acquire);
+                if (current == ptr)
+                {
+                    return ptr;
+                }
+                ptr = current;
+            }
+        }
+
+        void reset() noexcept
+        {
+            slot->store(nullptr, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<const void*>* slot;
+    };
+
+    // `ptr` should be unlinked: holders which protect it afterwards must not be able to load it
+    template <typename T, typename Deleter = std::default_delete<T>>
+    static void retire(T* ptr, Deleter deleter = Deleter())
+    {
+        retireErased(ptr, detail::reclaim_deleter([ptr, deleter = std::move(deleter)]() { deleter(ptr); }));
+    }
+
+    // Destroys retired objects which are not protected by any holder.
+    // Returns the number of objects retired by the calling thread which are still waiting.
+    static std::size_t collect();
+
+    // Retired objects of all threads which are not destroyed yet
+    static std::int64_t unreclaimed() noexcept;
+
+private:
+    static void retireErased(const void* ptr, detail::reclaim_deleter&& deleter);
+};
+
+} // namespace losync
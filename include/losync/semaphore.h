@@ -0,0 +1,159 @@
+// `counting_semaphore` is a counter of available resources which threads take and give back,
+// like `std::counting_semaphore`.
+// Its features:
+//
+// 1. The state is one 32-bit word: the count in the low half and the number of sleeping waiters in the high half.
+// 2. `release()` is one atomic operation and makes a syscall only when somebody sleeps. `try_acquire()` is one CAS.
+// 3. Acquiring spins with exponential backoff on a multiprocessor before it goes to sleep on a futex,
+//    `try_acquire_for` gives up after a timeout.
+
+#pragma once
+
+#include <losync/backoff.h>
+#include <losync/futex.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+
+
+namespace losync
+{
+
+class counting_semaphore
+{
+public:
+    explicit counting_semaphore(const std::uint32_t desired) noexcept : state(desired)
+    {
+        assert(desired <= max());
+    }
+
+    counting_semaphore(const counting_semaphore&) = delete;
+    counting_semaphore& operator=(const counting_semaphore&) = delete;
+
+    static constexpr std::uint32_t max() noexcept
+    {
+        return CountMask;
+    }
+
+    // Work done before `release` is visible to the threads which acquire the released count
+    void release(const std::uint32_t update = 1) noexcept
+    {
+        const std::uint32_t previous = state.fetch_add(update, std::memory_order_release);
+        assert((previous & CountMask) + update <= max());
+        if (previous >= Waiter)
+        {
+            if (update == 1)
+            {
+                futex_wake_one(state);
+            }
+            else
+            {
+                futex_wake_all(state);
+            }
+        }
+    }
+
+    bool try_acquire() noexcept
+    {
+        std::uint32_t current = state.load(std::memory_order_relaxed);
+        return tryTake(current);
+    }
+
+    void acquire() noexcept
+    {
+        std::uint32_t current = state.load(std::memory_order_relaxed);
+        if (!tryTake(current) && !spinAcquire())
+        {
+            sleepAcquire(nullptr);
+        }
+    }
+
+    // Returns false if nothing was released within `timeout`
+    template <typename Rep, typename Period>
+    bool try_acquire_for(const std::chrono::duration<Rep, Period>& timeout) noexcept
+    {
+        std::uint32_t current = state.load(std::memory_order_relaxed);
+        if (tryTake(current) || spinAcquire())
+        {
+            return true;
+        }
+        const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::nanoseconds>(timeout);
+        return sleepAcquire(&deadline);
+    }
+
+private:
+    static constexpr std::uint32_t CountMask = 0xFFFF;
+    static constexpr std::uint32_t Waiter = 0x10000;
+
+    // `current` is refreshed when the CAS fails. A registered waiter leaves the waiter count with the same CAS.
+    bool tryTake(std::uint32_t& current, const std::uint32_t registered = 0) noexcept
+    {
+        while ((current & CountMask) != 0)
+        {
+            if (state.compare_exchange_weak(current, current - 1 - registered, std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool spinAcquire() noexcept
+    {
+        exponential_backoff backoff = exponential_backoff::before_sleep();
+        while (backoff.spin())
+        {
+            std::uint32_t current = state.load(std::memory_order_relaxed);
+            if (tryTake(current))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The waiter stays counted until it takes a unit or times out
+    bool sleepAcquire(const std::chrono::steady_clock::time_point* deadline) noexcept
+    {
+        std::uint32_t current = state.fetch_add(Waiter, std::memory_order_relaxed) + Waiter;
+        while (!tryTake(current, Waiter))
+        {
+            if (deadline == nullptr)
+            {
+                futex_wait(state, current);
+            }
+            else
+            {
+                const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= *deadline)
+                {
+                    return leave(current);
+                }
+                futex_wait_for(state, current, *deadline - now);
+            }
+            current = state.load(std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // The wake-up of a unit released at the timeout may have gone to this waiter, so it takes the unit if there is one
+    bool leave(std::uint32_t current) noexcept
+    {
+        while (!tryTake(current, Waiter))
+        {
+            if (state.compare_exchange_weak(current, current - Waiter, std::memory_order_relaxed))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::atomic<std::uint32_t> state;
+};
+
+} // namespace losync
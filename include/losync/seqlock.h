@@ -0,0 +1,118 @@
+// `seqlock` holds a small trivially copyable value which is read far more often than written.
+// Its features:
+//
+// 1. Readers never write shared memory: they read the sequence number, copy the value and retry
+//    if the sequence number changed meanwhile. A reader may retry while a writer is active, so readers are lock-free.
+// 2. The value is kept in relaxed atomic words, so racing copies are not data races.
+// 3. Writers exclude each other with the odd sequence number, a write is one CAS plus stores.
+//
+// Memory orders follow "Can Seqlocks Get Along With Programming Language Memory Models?" by Hans Boehm.
+
+#pragma once
+
+#include <losync/backoff.h>
+#include <losync/cache_aligned.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+namespace losync
+{
+
+template <typename T>
+class seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock requires a trivially copyable type");
+
+public:
+    seqlock() noexcept : seqlock(T{})
+    {
+    }
+
+    explicit seqlock(const T& value) noexcept
+    {
+        storeWords(value);
+    }
+
+    seqlock(const seqlock&) = delete;
+    seqlock& operator=(const seqlock&) = delete;
+
+    T load() const noexcept
+    {
+        exponential_backoff backoff;
+        for (;;)
+        {
+            const std::uint64_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0)
+            {
+                std::uint64_t copy[WordCount];
+                for (std::size_t i = 0; i < WordCount; ++i)
+                {
+                    copy[i] = words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before)
+                {
+                    T result;
+                    std::memcpy(&result, copy, sizeof(T));
+                    return result;
+                }
+            }
+            if (!backoff.spin())
+            {
+                backoff.reset();
+            }
+        }
+    }
+
+    void store(const T& value) noexcept
+    {
+        exponential_backoff backoff;
+        std::uint64_t current = sequence.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if ((current & 1) == 0 &&
+                sequence.compare_exchange_weak(current, current + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+            if (!backoff.spin())
+            {
+                backoff.reset();
+            }
+            current = sequence.load(std::memory_order_relaxed);
+        }
+        // Readers which see any of the following stores also see the odd sequence number
+        std::atomic_thread_fence(std::memory_order_release);
+        storeWords(value);
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    // Number of completed stores
+    std::uint64_t version() const noexcept
+    {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr std::size_t WordCount = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    void storeWords(const T& value) noexcept
+    {
+        std::uint64_t copy[WordCount] = {};
+        std::memcpy(copy, &value, sizeof(T));
+        for (std::size_t i = 0; i < WordCount; ++i)
+        {
+            words[i].store(copy[i], std::memory_order_relaxed);
+        }
+    }
+
+    LOSYNC_CACHE_ALIGNED std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> words[WordCount];
+};
+
+} // namespace losync
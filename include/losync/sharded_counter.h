@@ -0,0 +1,120 @@
+// `sharded_counter` is a counter which scales with the number of threads incrementing it.
+// Its features:
+//
+// 1. Every thread increments its own cell, the cells are padded to separate cache lines.
+// 2. The cell is chosen by `thread_slot`, so threads do not collide while there are less live threads than shards.
+// 3. `add()` is a single relaxed atomic RMW. `read()` and `reset()` visit all shards.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/thread_slot.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+
+namespace losync
+{
+
+class sharded_counter
+{
+public:
+    // Reference to the shard of one thread. It saves the lookup of the shard in a hot loop.
+    class local_shard
+    {
+    public:
+        void add(const std::int64_t delta = 1) noexcept
+        {
+            value->fetch_add(delta, std::memory_order_relaxed);
+        }
+
+    private:
+        friend class sharded_counter;
+
+        explicit local_shard(std::atomic<std::int64_t>& value) : value(&value)
+        {
+        }
+
+        std::atomic<std::int64_t>* value;
+    };
+
+    sharded_counter() : sharded_counter(default_shard_count())
+    {
+    }
+
+    // `shards` is rounded up to a power of two
+    explicit sharded_counter(const std::size_t shards)
+        : mask(roundUpToPowerOfTwo(shards) - 1), cells(new Cell[mask + 1])
+    {
+    }
+
+    sharded_counter(const sharded_counter&) = delete;
+    sharded_counter& operator=(const sharded_counter&) = delete;
+
+    void add(const std::int64_t delta = 1) noexcept
+    {
+        cells[thread_slot::index() & mask].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    // The shard of the calling thread. It should be used only by this thread.
+    local_shard local() noexcept
+    {
+        return local_shard(cells[thread_slot::index() & mask].value);
+    }
+
+    // Sum of all shards. Concurrent additions may be partially visible.
+    std::int64_t read() const noexcept
+    {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            sum += cells[i].value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    // Zeroes all shards. Additions which run concurrently with it may be lost or kept.
+    void reset() noexcept
+    {
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            cells[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t shard_count() const noexcept
+    {
+        return mask + 1;
+    }
+
+    static std::size_t default_shard_count() noexcept
+    {
+        const std::size_t concurrency = std::thread::hardware_concurrency();
+        return 4 * (concurrency != 0 ? concurrency : 1);
+    }
+
+private:
+    struct LOSYNC_CACHE_ALIGNED Cell
+    {
+        std::atomic<std::int64_t> value{0};
+    };
+
+    static std::size_t roundUpToPowerOfTwo(const std::size_t value) noexcept
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const std::size_t mask;
+    const std::unique_ptr<Cell[]> cells;
+};
+
+} // namespace losync
@@ -0,0 +1,266 @@
+// `sharded_histogram` is a histogram of non-negative values like latencies in nanoseconds, cheap enough for hot paths.
+// Its features:
+//
+// 1. Buckets are log-linear like in HdrHistogram: values below 32 are counted exactly, every larger power of two
+//    is split into 32 equal buckets, so a reported value differs from the recorded one by less than 1/32 (about 3%).
+// 2. Every thread records into its own shard chosen by `thread_slot`. Shards are padded to separate cache lines,
+//    so threads do not contend while there are less live threads than shards.
+// 3. `record()` is one relaxed atomic increment plus a relaxed load for the maximum.
+// 4. `read()` merges the shards into a `snapshot` with quantiles and the maximum while writers keep recording.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/thread_slot.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace losync
+{
+
+class sharded_histogram
+{
+    struct Shard;
+
+public:
+    static constexpr std::size_t sub_bucket_bits = 5;
+    static constexpr std::size_t sub_bucket_count = std::size_t{1} << sub_bucket_bits;
+    static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    // Merged copy of all shards
+    class snapshot
+    {
+    public:
+        std::uint64_t count() const noexcept
+        {
+            return total;
+        }
+
+        std::uint64_t max() const noexcept
+        {
+            return maxValue;
+        }
+
+        // The smallest value such that at least `q` of all recorded values are not greater than it,
+        // rounded up to the upper bound of its bucket. `q` is in [0, 1]. Returns 0 for an empty histogram.
+        std::uint64_t quantile(double q) const noexcept;
+
+        std::uint64_t p50() const noexcept
+        {
+            return quantile(0.5);
+        }
+
+        std::uint64_t p99() const noexcept
+        {
+            return quantile(0.99);
+        }
+
+        std::uint64_t p999() const noexcept
+        {
+            return quantile(0.999);
+        }
+
+        // Number of values recorded in bucket `index`
+        std::uint64_t bucket(const std::size_t index) const noexcept
+        {
+            return buckets[index];
+        }
+
+    private:
+        friend class sharded_histogram;
+
+        std::vector<std::uint64_t> buckets = std::vector<std::uint64_t>(bucket_count, 0);
+        std::uint64_t total = 0;
+        std::uint64_t maxValue = 0;
+    };
+
+    // Reference to the shard of one thread. It saves the lookup of the shard in a hot loop.
+    class local_shard
+    {
+    public:
+        void record(const std::uint64_t value) noexcept
+        {
+            shard->record(value);
+        }
+
+    private:
+        friend class sharded_histogram;
+
+        explicit local_shard(Shard& shard) : shard(&shard)
+        {
+        }
+
+        Shard* shard;
+    };
+
+    sharded_histogram() : sharded_histogram(default_shard_count())
+    {
+    }
+
+    // `shards` is rounded up to a power of two
+    explicit sharded_histogram(const std::size_t shards)
+        : mask(roundUpToPowerOfTwo(shards) - 1), shards(new Shard[mask + 1])
+    {
+    }
+
+    sharded_histogram(const sharded_histogram&) = delete;
+    sharded_histogram& operator=(const sharded_histogram&) = delete;
+
+    void record(const std::uint64_t value) noexcept
+    {
+        shards[thread_slot::index() & mask].record(value);
+    }
+
+    // The shard of the calling thread. It should be used only by this thread.
+    local_shard local() noexcept
+    {
+        return local_shard(shards[thread_slot::index() & mask]);
+    }
+
+    // Merges all shards. Concurrent records may be partially visible.
+    snapshot read() const noexcept
+    {
+        snapshot result;
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            const Shard& shard = shards[i];
+            for (std::size_t b = 0; b < bucket_count; ++b)
+            {
+                const std::uint64_t count = shard.buckets[b].load(std::memory_order_relaxed);
+                result.buckets[b] += count;
+                result.total += count;
+            }
+            const std::uint64_t max = shard.max.load(std::memory_order_relaxed);
+            if (max > result.maxValue)
+            {
+                result.maxValue = max;
+            }
+        }
+        return result;
+    }
+
+    // Zeroes all shards. Records which run concurrently with it may be lost or kept.
+    void reset() noexcept
+    {
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            for (auto& bucket : shards[i].buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            shards[i].max.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t shard_count() const noexcept
+    {
+        return mask + 1;
+    }
+
+    static std::size_t default_shard_count() noexcept
+    {
+        const std::size_t concurrency = std::thread::hardware_concurrency();
+        return 4 * (concurrency != 0 ? concurrency : 1);
+    }
+
+    static std::size_t bucket_index(const std::uint64_t value) noexcept
+    {
+        if (value < sub_bucket_count)
+        {
+            return static_cast<std::size_t>(value);
+        }
+        const std::size_t shift = floorLog2(value) - sub_bucket_bits;
+        return (shift + 1) * sub_bucket_count + static_cast<std::size_t>((value >> shift) & (sub_bucket_count - 1));
+    }
+
+    // The largest value which falls into bucket `index`
+    static std::uint64_t bucket_upper_bound(const std::size_t index) noexcept
+    {
+        if (index < sub_bucket_count)
+        {
+            return index;
+        }
+        const std::size_t shift = index / sub_bucket_count - 1;
+        const std::uint64_t lower = static_cast<std::uint64_t>(sub_bucket_count + index % sub_bucket_count) << shift;
+        return lower + ((std::uint64_t{1} << shift) - 1);
+    }
+
+private:
+    struct LOSYNC_CACHE_ALIGNED Shard
+    {
+        std::atomic<std::uint64_t> max{0};
+        std::atomic<std::uint64_t> buckets[bucket_count] = {};
+
+        void record(const std::uint64_t value) noexcept
+        {
+            buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+            // The maximum rarely changes, so usually it is only read
+            std::uint64_t current = max.load(std::memory_order_relaxed);
+            while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+    };
+
+    static std::size_t floorLog2(const std::uint64_t value) noexcept
+    {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(value);
+#else
+        std::size_t result = 0;
+        for (std::uint64_t rest = value >> 1; rest != 0; rest >>= 1)
+        {
+            ++result;
+        }
+        return result;
+#endif
+    }
+
+    static std::size_t roundUpToPowerOfTwo(const std::size_t value) noexcept
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const std::size_t mask;
+    const std::unique_ptr<Shard[]> shards;
+};
+
+
+inline std::uint64_t sharded_histogram::snapshot::quantile(double q) const noexcept
+{
+    if (total == 0)
+    {
+        return 0;
+    }
+    q = q < 0 ? 0 : (q > 1 ? 1 : q);
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(total)));
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+    std::uint64_t seen = 0;
+    for (std::size_t index = 0; index < bucket_count; ++index)
+    {
+        seen += buckets[index];
+        if (seen >= rank)
+        {
+            const std::uint64_t bound = bucket_upper_bound(index);
+            return bound < maxValue ? bound : maxValue;
+        }
+    }
+    return maxValue;
+}
+
+} // namespace losync
@@ -0,0 +1,159 @@
+// `shared_mutex` is a reader-writer lock whose readers do not share a cache line while nobody writes.
+// Its features:
+//
+// 1. It follows BRAVO ("Biased Locking for Reader-Writer Locks" by Dice and Kogan): while the lock is read-biased,
+//    a reader only flags its own slot, padded to a separate cache line, and does not touch the shared lock word.
+// 2. Slots are indexed by `thread_slot`, so live threads never collide. Threads whose index exceeds
+//    the number of slots take the slow path through the underlying `std::shared_mutex`.
+// 3. A writer revokes the bias and waits until flagged readers leave, sleeping on the futex of a slot.
+//    The bias is restored by slow readers only after a period proportional to the cost of the last revocation,
+//    so frequent writers do not pay for revocations over and over.
+// 4. It meets the SharedMutex requirements, so it works with `std::unique_lock` and `std::shared_lock`.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/futex.h>
+#include <losync/thread_slot.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <thread>
+
+
+namespace losync
+{
+
+class shared_mutex
+{
+public:
+    shared_mutex() : shared_mutex(default_slot_count())
+    {
+    }
+
+    explicit shared_mutex(const std::size_t reader_slots) : slotCount(reader_slots), slots(new Slot[reader_slots])
+    {
+    }
+
+    shared_mutex(const shared_mutex&) = delete;
+    shared_mutex& operator=(const shared_mutex&) = delete;
+
+    void lock()
+    {
+        underlying.lock();
+        revokeBias();
+    }
+
+    bool try_lock();
+
+    void unlock()
+    {
+        underlying.unlock();
+    }
+
+    void lock_shared()
+    {
+        if (!tryLockFast())
+        {
+            underlying.lock_shared();
+            restoreBias();
+        }
+    }
+
+    bool try_lock_shared()
+    {
+        if (tryLockFast())
+        {
+            return true;
+        }
+        if (!underlying.try_lock_shared())
+        {
+            return false;
+        }
+        restoreBias();
+        return true;
+    }
+
+    void unlock_shared()
+    {
+        const std::size_t slot = thread_slot::index();
+        // Only the fast path flags the slot of the thread
+        if (slot < slotCount && slots[slot].state.load(std::memory_order_relaxed) != Idle)
+        {
+            leaveSlot(slots[slot]);
+        }
+        else
+        {
+            underlying.unlock_shared();
+        }
+    }
+
+    std::size_t reader_slots() const noexcept
+    {
+        return slotCount;
+    }
+
+    static std::size_t default_slot_count() noexcept
+    {
+        const std::size_t concurrency = std::thread::hardware_concurrency();
+        return 4 * (concurrency != 0 ? concurrency : 1);
+    }
+
+private:
+    static constexpr std::uint32_t Idle = 0;
+    static constexpr std::uint32_t Reading = 1;
+    static constexpr std::uint32_t ReadingWriterWaits = 2;
+
+    // Slow readers restore the bias after `InhibitMultiplier` times the duration of the last revocation
+    static constexpr std::int64_t InhibitMultiplier = 9;
+
+    struct LOSYNC_CACHE_ALIGNED Slot
+    {
+        std::atomic<std::uint32_t> state{Idle};
+    };
+
+    bool tryLockFast()
+    {
+        if (!readBias.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        const std::size_t slot = thread_slot::index();
+        if (slot >= slotCount)
+        {
+            return false;
+        }
+        // Pairs with the store and the loads in revokeBias(): either the writer sees the flag or we see the revocation
+        slots[slot].state.store(Reading, std::memory_order_seq_cst);
+        if (readBias.load(std::memory_order_seq_cst))
+        {
+            return true;
+        }
+        leaveSlot(slots[slot]);
+        return false;
+    }
+
+    static void leaveSlot(Slot& slot) noexcept
+    {
+        if (slot.state.exchange(Idle, std::memory_order_release) == ReadingWriterWaits)
+        {
+            futex_wake_one(slot.state);
+        }
+    }
+
+    void revokeBias();
+    void restoreBias();
+
+    std::shared_mutex underlying;
+    const std::size_t slotCount;
+    const std::unique_ptr<Slot[]> slots;
+
+    LOSYNC_CACHE_ALIGNED std::atomic<bool> readBias{true};
+    // Steady clock time in nanoseconds before which slow readers do not restore the bias
+    std::atomic<std::int64_t> inhibitUntil{0};
+};
+
+} // namespace losync
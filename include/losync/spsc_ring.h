@@ -0,0 +1,178 @@
+// `spsc_ring` is a bounded wait-free queue with one producer and one consumer.
+// Its features:
+//
+// 1. Every operation finishes in a bounded number of steps: there are no CAS loops and no atomic RMW operations.
+// 2. The producer's and the consumer's indices live on separate cache lines. Each side keeps a cached copy
+//    of the other side's index and rereads the shared one only when the cached copy says the ring is full or empty.
+// 3. `reserve(n)` / `commit(n)` let the producer construct elements right in the ring's storage,
+//    `peek(n)` / `consume(n)` let the consumer use them in place.
+// 4. Elements may be move-only, like `cheap_function`.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T>
+class spsc_ring
+{
+public:
+    // Contiguous part of the ring storage
+    struct region
+    {
+        T* data;
+        std::size_t size;
+    };
+
+    // `capacity` is rounded up to a power of two
+    explicit spsc_ring(const std::size_t capacity)
+        : mask(roundUpToPowerOfTwo(capacity) - 1),
+          items(static_cast<T*>(::operator new(sizeof(T) * (mask + 1), std::align_val_t{alignof(T)})))
+    {
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    ~spsc_ring()
+    {
+        const std::size_t last = tail.load(std::memory_order_acquire);
+        for (std::size_t pos = head.load(std::memory_order_relaxed); pos != last; ++pos)
+        {
+            items[pos & mask].~T();
+        }
+        ::operator delete(items, std::align_val_t{alignof(T)});
+    }
+
+    // Producer only. Returns false if the ring is full.
+    template <typename... ArgsT>
+    bool try_emplace(ArgsT&&... args)
+    {
+        const region free = reserve(1);
+        if (free.size == 0)
+        {
+            return false;
+        }
+        new (free.data) T(std::forward<ArgsT>(args)...);
+        commit(1);
+        return true;
+    }
+
+    // Producer only. Returns false if the ring is full, `value` is left untouched then.
+    bool try_push(T&& value)
+    {
+        return try_emplace(std::move(value));
+    }
+
+    // Producer only. Returns uninitialized storage for up to `count` elements, fewer if the ring is almost full
+    // or the free space wraps around the end of the storage. Construct elements there and then publish them
+    // with `commit`.
+    region reserve(const std::size_t count)
+    {
+        const std::size_t pos = tail.load(std::memory_order_relaxed);
+        std::size_t free = capacity() - (pos - cachedHead);
+        if (free < count)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            free = capacity() - (pos - cachedHead);
+        }
+        const std::size_t offset = pos & mask;
+        return {items + offset, std::min({count, free, capacity() - offset})};
+    }
+
+    // Producer only. Publishes the first `count` elements constructed in the last reserved region.
+    void commit(const std::size_t count)
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Consumer only
+    std::optional<T> try_pop()
+    {
+        const region ready = peek(1);
+        if (ready.size == 0)
+        {
+            return std::nullopt;
+        }
+        std::optional<T> result(std::move(*ready.data));
+        consume(1);
+        return result;
+    }
+
+    // Consumer only. Returns up to `count` published elements, fewer if the ring holds less
+    // or the elements wrap around the end of the storage. The elements stay in the ring until `consume`.
+    // Without `count` the shared index is read only when no element is known to be ready.
+    region peek(const std::size_t count = AnyCount)
+    {
+        const std::size_t pos = head.load(std::memory_order_relaxed);
+        std::size_t ready = cachedTail - pos;
+        if (ready == 0 || (ready < count && count != AnyCount))
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            ready = cachedTail - pos;
+        }
+        const std::size_t offset = pos & mask;
+        return {items + offset, std::min({count, ready, capacity() - offset})};
+    }
+
+    // Consumer only. Destroys the first `count` elements of the last peeked region and frees their slots.
+    void consume(const std::size_t count)
+    {
+        const std::size_t pos = head.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            items[(pos + i) & mask].~T();
+        }
+        head.store(pos + count, std::memory_order_release);
+    }
+
+    std::size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+    // Approximate number of elements. Any thread may call it.
+    std::size_t size() const
+    {
+        const std::size_t consumed = head.load(std::memory_order_acquire);
+        const std::size_t produced = tail.load(std::memory_order_acquire);
+        return produced - consumed;
+    }
+
+private:
+    static constexpr std::size_t AnyCount = ~std::size_t{0};
+
+    static std::size_t roundUpToPowerOfTwo(const std::size_t value)
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // Read by both sides, never written after construction
+    LOSYNC_CACHE_ALIGNED const std::size_t mask;
+    T* const items;
+
+    // Written by the producer
+    LOSYNC_CACHE_ALIGNED std::atomic<std::size_t> tail{0};
+    std::size_t cachedHead = 0;
+
+    // Written by the consumer
+    LOSYNC_CACHE_ALIGNED std::atomic<std::size_t> head{0};
+    std::size_t cachedTail = 0;
+};
+
+} // namespace losync
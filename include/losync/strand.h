@@ -0,0 +1,119 @@
+// `strand` runs `cheap_function<void()>` messages one at a time in the order of posting, on the workers of a `thread_pool`.
+// Its features:
+//
+// 1. The mailbox is an intrusive lock-free MPSC queue: a post allocates a node in `pool_allocator`
+//    and links it with one atomic exchange. There is no mutex and no thread per strand.
+// 2. The strand is submitted to the pool only when its mailbox goes from empty to non-empty,
+//    so a burst of posts costs one pool task.
+// 3. A turn runs at most `batch` messages, then the strand is deferred to the shared queue of the pool,
+//    so a busy strand does not keep a worker from the other tasks.
+// 4. A strand takes two cache lines, so thousands of objects can have their own strand over a small pool.
+// 5. Messages should not throw: an exception escaping a message terminates the program, like in `thread_pool`.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/cheap_function.h>
+#include <losync/pool_allocator.h>
+#include <losync/thread_pool.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+
+namespace losync
+{
+
+class strand
+{
+public:
+    using message = cheap_function<void()>;
+
+    static constexpr std::uint32_t default_batch = 64;
+
+    explicit strand(thread_pool& pool, std::uint32_t batch = default_batch) noexcept;
+
+    strand(const strand&) = delete;
+    strand& operator=(const strand&) = delete;
+
+    // Waits until the posted messages have run. Must not be called by a message of the strand.
+    ~strand();
+
+    // Safe to call from any thread, including messages of this and other strands.
+    // If the pool fails to take the strand, the message is dropped and the exception is rethrown.
+    // Messages posted by other threads meanwhile run on the calling thread then, so none of them is stuck.
+    template <typename F>
+    void post(F&& func)
+    {
+        void* const memory = pool_allocator::allocate(sizeof(Message));
+        Message* node;
+        try
+        {
+            node = new (memory) Message(std::forward<F>(func));
+        }
+        catch (...)
+        {
+            pool_allocator::deallocate(memory, sizeof(Message));
+            throw;
+        }
+        Link* const previous = tail.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+        if (pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+        {
+            try
+            {
+                pool.submit([this]() { runTurn(); });
+            }
+            catch (...)
+            {
+                cancelFirst(node);
+                throw;
+            }
+        }
+    }
+
+    // Whether the calling thread is running a message of this strand
+    bool running_in_this_thread() const noexcept;
+
+    thread_pool& executor() const noexcept
+    {
+        return pool;
+    }
+
+private:
+    struct Link
+    {
+        std::atomic<Link*> next{nullptr};
+    };
+
+    struct Message : Link
+    {
+        template <typename F>
+        explicit Message(F&& func) : func(std::forward<F>(func))
+        {
+        }
+
+        message func;
+    };
+
+    // Takes the oldest message, which is known to be posted. Waits while its producer links it.
+    Message* pop() noexcept;
+    void runTurn() noexcept;
+    // Drops the first message after its turn could not be submitted, the caller is the only consumer
+    void cancelFirst(Message* message) noexcept;
+
+    // Producers: the last node of the mailbox and the number of posted messages which have not run yet
+    LOSYNC_CACHE_ALIGNED std::atomic<Link*> tail;
+    std::atomic<std::uint32_t> pending{0};
+
+    // The consumer: the first node of the mailbox. `stub` keeps the mailbox non-empty when all messages are taken.
+    LOSYNC_CACHE_ALIGNED Link* head;
+    Link stub;
+    thread_pool& pool;
+    const std::uint32_t batch;
+};
+
+} // namespace losync
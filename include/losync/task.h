@@ -0,0 +1,693 @@
+// `task` is a lazy C++20 coroutine which produces a value of type `T`, and the awaitables to use it with the library.
+// Its features:
+//
+// 1. A task starts when it is awaited. The awaiting coroutine is resumed with symmetric transfer,
+//    so in optimized builds long chains of tasks do not grow the stack.
+// 2. Coroutine frames are blocks of `pool_allocator`, a thread-caching pool, instead of the global `operator new`.
+// 3. `resume_on(pool)` moves the coroutine to a worker of a `thread_pool`, `spawn(pool, task)` runs a task there
+//    without waiting for it, and `sync_wait(task)` blocks the calling thread until the task finishes.
+// 4. `async_mutex`, `async_event` and `async_queue` suspend the coroutine instead of blocking the thread.
+//    Their waiters are nodes in the awaiting frames, so waiting does not allocate.
+// 5. `sleep_for(timers, delay)` resumes the coroutine on the thread of a `timer_thread`.
+//
+// The header requires C++20, configure the project with `-DLOSYNC_ENABLE_CXX20=ON`.
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "losync/task.h requires C++20 coroutines, configure with -DLOSYNC_ENABLE_CXX20=ON"
+#endif
+
+#include <losync/future.h>
+#include <losync/mutex.h>
+#include <losync/pool_allocator.h>
+#include <losync/thread_pool.h>
+#include <losync/timer_wheel.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T = void>
+class task;
+
+
+namespace detail
+{
+
+// Coroutine frames of promise types derived from it are allocated in `pool_allocator`
+struct pooled_frame
+{
+    static void* operator new(const std::size_t size)
+    {
+        return pool_allocator::allocate(size);
+    }
+
+    static void operator delete(void* const ptr, const std::size_t size) noexcept
+    {
+        pool_allocator::deallocate(ptr, size);
+    }
+};
+
+class task_promise_base : public pooled_frame
+{
+public:
+    struct final_awaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(const std::coroutine_handle<Promise> handle) const noexcept
+        {
+            const std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    final_awaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        error = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation;
+
+protected:
+    void rethrow() const
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::exception_ptr error;
+};
+
+template <typename T>
+class task_promise : public task_promise_base
+{
+public:
+    task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& value)
+    {
+        result.emplace(std::forward<U>(value));
+    }
+
+    T take()
+    {
+        rethrow();
+        return std::move(*result);
+    }
+
+private:
+    std::optional<T> result;
+};
+
+template <>
+class task_promise<void> : public task_promise_base
+{
+public:
+    task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept
+    {
+    }
+
+    void take() const
+    {
+        rethrow();
+    }
+};
+
+
+// A coroutine which starts suspended and destroys its frame when it finishes
+class detached_task
+{
+public:
+    struct promise_type : pooled_frame
+    {
+        detached_task get_return_object() noexcept
+        {
+            return detached_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        // Like tasks of `thread_pool`, detached coroutines should not throw
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+
+    explicit detached_task(const std::coroutine_handle<> handle) noexcept : handle(handle)
+    {
+    }
+
+    const std::coroutine_handle<> handle;
+};
+
+} // namespace detail
+
+
+template <typename T>
+class task
+{
+public:
+    using promise_type = detail::task_promise<T>;
+
+    task() noexcept = default;
+
+    task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task()
+    {
+        destroy();
+    }
+
+    bool valid() const noexcept
+    {
+        return static_cast<bool>(handle);
+    }
+
+    // Starts the task and resumes the awaiting coroutine when it finishes. A task is awaited once.
+    auto operator co_await() noexcept
+    {
+        struct awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept
+            {
+                return handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) const noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() const
+            {
+                return handle.promise().take();
+            }
+        };
+        return awaiter{handle};
+    }
+
+private:
+    friend promise_type;
+
+    explicit task(const std::coroutine_handle<promise_type> handle) noexcept : handle(handle)
+    {
+    }
+
+    void destroy() noexcept
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+task<T> detail::task_promise<T>::get_return_object() noexcept
+{
+    return task<T>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+inline task<void> detail::task_promise<void>::get_return_object() noexcept
+{
+    return task<void>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+
+// `co_await resume_on(pool)` continues the coroutine on a worker of the pool
+inline auto resume_on(thread_pool& pool) noexcept
+{
+    struct awaiter
+    {
+        thread_pool& pool;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(const std::coroutine_handle<> handle) const
+        {
+            pool.submit([handle]() { handle.resume(); });
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+    return awaiter{pool};
+}
+
+// Runs the task on a worker of the pool without waiting for it. The task should not throw.
+inline void spawn(thread_pool& pool, task<void> work)
+{
+    auto runner = [](task<void> work) -> detail::detached_task { co_await work; };
+    const detail::detached_task started = runner(std::move(work));
+    try
+    {
+        pool.submit([handle = started.handle]() { handle.resume(); });
+    }
+    catch (...)
+    {
+        started.handle.destroy();
+        throw;
+    }
+}
+
+// Runs the task on the calling thread until it suspends and blocks until it finishes.
+// Returns the result or rethrows the exception of the task.
+template <typename T>
+T sync_wait(task<T> work)
+{
+    auto runner = [](task<T> work, promise<T> done) -> detail::detached_task {
+        try
+        {
+            if constexpr (std::is_void<T>::value)
+            {
+                co_await work;
+                done.set_value();
+            }
+            else
+            {
+                done.set_value(co_await work);
+            }
+        }
+        catch (...)
+        {
+            done.set_exception(std::current_exception());
+        }
+    };
+    promise<T> done;
+    future<T> result = done.get_future();
+    runner(std::move(work), std::move(done)).handle.resume();
+    return result.get();
+}
+
+// `co_await sleep_for(timers, delay)` resumes the coroutine on the thread of `timers` after `delay`
+inline auto sleep_for(timer_thread& timers, const timer_thread::clock::duration delay) noexcept
+{
+    struct awaiter
+    {
+        timer_thread& timers;
+        timer_thread::clock::duration delay;
+
+        bool await_ready() const noexcept
+        {
+            return delay <= timer_thread::clock::duration::zero();
+        }
+
+        void await_suspend(const std::coroutine_handle<> handle) const
+        {
+            timers.schedule_after(delay, [handle]() { handle.resume(); });
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+    return awaiter{timers, delay};
+}
+
+
+// A mutex for coroutines: `co_await mutex.lock()` suspends the coroutine while another one holds the mutex.
+// `unlock` resumes the next waiter inline, handing the mutex over to it.
+class async_mutex
+{
+public:
+    class lock_awaiter
+    {
+    public:
+        explicit lock_awaiter(async_mutex& mutex) noexcept : mutex(mutex)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return mutex.try_lock();
+        }
+
+        // Pushes itself onto the stack of waiters, or takes the mutex if it was released meanwhile
+        bool await_suspend(const std::coroutine_handle<> handle) noexcept
+        {
+            awaiting = handle;
+            std::uintptr_t current = mutex.state.load(std::memory_order_acquire);
+            for (;;)
+            {
+                if (current == NotLocked)
+                {
+                    if (mutex.state.compare_exchange_weak(current, LockedNoWaiters, std::memory_order_acquire))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+                next = reinterpret_cast<lock_awaiter*>(current);
+                if (mutex.state.compare_exchange_weak(current, reinterpret_cast<std::uintptr_t>(this),
+                                                      std::memory_order_release, std::memory_order_acquire))
+                {
+                    return true;
+                }
+            }
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        friend class async_mutex;
+
+        async_mutex& mutex;
+        std::coroutine_handle<> awaiting;
+        lock_awaiter* next = nullptr;
+    };
+
+    async_mutex() = default;
+    async_mutex(const async_mutex&) = delete;
+    async_mutex& operator=(const async_mutex&) = delete;
+
+    bool try_lock() noexcept
+    {
+        std::uintptr_t expected = NotLocked;
+        return state.compare_exchange_strong(expected, LockedNoWaiters, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    }
+
+    lock_awaiter lock() noexcept
+    {
+        return lock_awaiter(*this);
+    }
+
+    // `co_await mutex.scoped_lock()` returns a `std::unique_lock` which unlocks the mutex
+    auto scoped_lock() noexcept
+    {
+        struct awaiter : lock_awaiter
+        {
+            std::unique_lock<async_mutex> await_resume() const noexcept
+            {
+                return std::unique_lock<async_mutex>(owner, std::adopt_lock);
+            }
+
+            async_mutex& owner;
+        };
+        return awaiter{lock_awaiter(*this), *this};
+    }
+
+    void unlock() noexcept
+    {
+        if (waiters == nullptr)
+        {
+            std::uintptr_t expected = LockedNoWaiters;
+            if (state.compare_exchange_strong(expected, NotLocked, std::memory_order_release,
+                                              std::memory_order_relaxed))
+            {
+                return;
+            }
+            // Take the stack of new waiters and reverse it, so they get the mutex in FIFO order
+            std::uintptr_t stack = state.exchange(LockedNoWaiters, std::memory_order_acquire);
+            for (lock_awaiter* waiter = reinterpret_cast<lock_awaiter*>(stack); waiter != nullptr;)
+            {
+                lock_awaiter* const next = waiter->next;
+                waiter->next = waiters;
+                waiters = waiter;
+                waiter = next;
+            }
+        }
+        lock_awaiter* const waiter = waiters;
+        waiters = waiter->next;
+        waiter->awaiting.resume();
+    }
+
+private:
+    static constexpr std::uintptr_t LockedNoWaiters = 0;
+    static constexpr std::uintptr_t NotLocked = 1;
+
+    // NotLocked, LockedNoWaiters or the stack of waiters which arrived after the holder took `waiters`
+    std::atomic<std::uintptr_t> state{NotLocked};
+    // Waiters in FIFO order, accessed only by the holder
+    lock_awaiter* waiters = nullptr;
+};
+
+
+// A manual-reset event for coroutines: `co_await event` suspends the coroutine until `set()` is called
+class async_event
+{
+public:
+    class awaiter
+    {
+    public:
+        explicit awaiter(const async_event& event) noexcept : event(event)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return event.is_set();
+        }
+
+        bool await_suspend(const std::coroutine_handle<> handle) noexcept
+        {
+            awaiting = handle;
+            const void* const setState = &event;
+            void* current = event.state.load(std::memory_order_acquire);
+            do
+            {
+                if (current == setState)
+                {
+                    return false;
+                }
+                next = static_cast<awaiter*>(current);
+            } while (!event.state.compare_exchange_weak(current, this, std::memory_order_release,
+                                                        std::memory_order_acquire));
+            return true;
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        friend class async_event;
+
+        const async_event& event;
+        std::coroutine_handle<> awaiting;
+        awaiter* next = nullptr;
+    };
+
+    explicit async_event(const bool initiallySet = false) noexcept
+        : state(initiallySet ? static_cast<void*>(this) : nullptr)
+    {
+    }
+
+    async_event(const async_event&) = delete;
+    async_event& operator=(const async_event&) = delete;
+
+    bool is_set() const noexcept
+    {
+        return state.load(std::memory_order_acquire) == this;
+    }
+
+    // Resumes all waiting coroutines on the calling thread
+    void set() noexcept
+    {
+        void* const previous = state.exchange(this, std::memory_order_acq_rel);
+        if (previous == this)
+        {
+            return;
+        }
+        for (awaiter* waiter = static_cast<awaiter*>(previous); waiter != nullptr;)
+        {
+            // The waiter lives in the frame which is resumed
+            awaiter* const next = waiter->next;
+            waiter->awaiting.resume();
+            waiter = next;
+        }
+    }
+
+    void reset() noexcept
+    {
+        void* expected = this;
+        state.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed);
+    }
+
+    awaiter operator co_await() const noexcept
+    {
+        return awaiter(*this);
+    }
+
+private:
+    // `this` when set, otherwise the stack of waiters
+    mutable std::atomic<void*> state;
+};
+
+
+// An unbounded queue whose consumers are coroutines: `co_await queue.pop()` suspends while the queue is empty.
+// `push` may be called from any thread and resumes a waiting consumer inline, handing the element to it.
+template <typename T>
+class async_queue
+{
+public:
+    class pop_awaiter
+    {
+    public:
+        explicit pop_awaiter(async_queue& queue) noexcept : queue(queue)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(const std::coroutine_handle<> handle)
+        {
+            std::lock_guard<losync::mutex> lock(queue.mutex);
+            if (!queue.items.empty())
+            {
+                value.emplace(std::move(queue.items.front()));
+                queue.items.pop_front();
+                return false;
+            }
+            awaiting = handle;
+            *queue.waitersTail = this;
+            queue.waitersTail = &next;
+            return true;
+        }
+
+        T await_resume()
+        {
+            return std::move(*value);
+        }
+
+    private:
+        friend class async_queue;
+
+        async_queue& queue;
+        std::coroutine_handle<> awaiting;
+        std::optional<T> value;
+        pop_awaiter* next = nullptr;
+    };
+
+    async_queue() = default;
+    async_queue(const async_queue&) = delete;
+    async_queue& operator=(const async_queue&) = delete;
+
+    template <typename... ArgsT>
+    void push(ArgsT&&... args)
+    {
+        pop_awaiter* waiter = nullptr;
+        {
+            std::lock_guard<losync::mutex> lock(mutex);
+            if (waiters == nullptr)
+            {
+                items.emplace_back(std::forward<ArgsT>(args)...);
+                return;
+            }
+            waiter = waiters;
+            waiters = waiter->next;
+            if (waiters == nullptr)
+            {
+                waitersTail = &waiters;
+            }
+            waiter->value.emplace(std::forward<ArgsT>(args)...);
+        }
+        waiter->awaiting.resume();
+    }
+
+    pop_awaiter pop() noexcept
+    {
+        return pop_awaiter(*this);
+    }
+
+    // Returns nullopt if the queue is empty, never suspends
+    std::optional<T> try_pop()
+    {
+        std::lock_guard<losync::mutex> lock(mutex);
+        if (items.empty())
+        {
+            return std::nullopt;
+        }
+        std::optional<T> result(std::move(items.front()));
+        items.pop_front();
+        return result;
+    }
+
+private:
+    losync::mutex mutex;
+    std::deque<T> items;
+    // Waiting consumers in FIFO order, there are waiters only while `items` is empty
+    pop_awaiter* waiters = nullptr;
+    pop_awaiter** waitersTail = &waiters;
+};
+
+} // namespace losync
@@ -0,0 +1,223 @@
+// `thread_pool` is a work-stealing pool of threads running `cheap_function<void()>` tasks.
+// Its features:
+//
+// 1. Every worker has its own Chase-Lev deque. Tasks submitted by a worker go to its deque,
+//    tasks submitted from other threads go to a shared lock-free injection queue.
+// 2. Idle workers steal the oldest tasks from the deques of random workers.
+// 3. Workers which found no work for a while sleep on a futex. Submitting wakes a worker
+//    with a syscall only when somebody sleeps.
+// 4. No mutex is taken on the submit and execute paths, and tasks are moved without allocation.
+// 5. Tasks should not throw: an exception escaping a task terminates the program.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+#include <losync/cheap_function.h>
+#include <losync/futex.h>
+#include <losync/mpsc_queue.h>
+#include <losync/work_stealing_deque.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace losync
+{
+
+class thread_pool
+{
+public:
+    using task = cheap_function<void()>;
+
+    explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency());
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // Runs all submitted tasks and joins the workers
+    ~thread_pool();
+
+    template <typename F>
+    void submit(F&& func)
+    {
+        enqueue(task(std::forward<F>(func)));
+        notify(1);
+    }
+
+    // Like `submit`, but the task always goes to the shared injection queue. Workers take it only after
+    // their own deques are empty, so a task which defers its continuation lets the other tasks run first.
+    template <typename F>
+    void defer(F&& func)
+    {
+        injection.push(task(std::forward<F>(func)));
+        notify(1);
+    }
+
+    // Moves tasks from the range and wakes as many workers as needed with one notification
+    template <typename It>
+    void submit_bulk(It first, const It last)
+    {
+        std::size_t count = 0;
+        for (; first != last; ++first, ++count)
+        {
+            enqueue(task(std::move(*first)));
+        }
+        notify(count);
+    }
+
+    // Calls `body(i)` for every `i` in [begin, end) and returns when all calls are finished.
+    // Indices are split into chunks of `grain` (chosen automatically when 0) which run as separate tasks.
+    // The calling thread runs pending tasks while it waits, so nested calls from workers are allowed.
+    // If `body` throws on the calling thread, or a chunk can not be queued, the call waits for the queued chunks
+    // and rethrows. An exception of `body` in another chunk terminates the program like any task.
+    template <typename F>
+    void parallel_for(const std::size_t begin, const std::size_t end, F&& body, std::size_t grain = 0)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        const std::size_t count = end - begin;
+        if (grain == 0)
+        {
+            grain = std::max<std::size_t>(1, count / (4 * size()));
+        }
+        grain = std::max(grain, count / MaxChunks + 1);
+        const std::size_t chunks = (count + grain - 1) / grain;
+
+        // The calling thread runs the first chunk itself
+        join_counter remaining(static_cast<std::uint32_t>(chunks - 1));
+        std::size_t queued = 0;
+        try
+        {
+            std::size_t from = begin + grain;
+            for (; queued + 1 < chunks; ++queued, from += grain)
+            {
+                const std::size_t to = std::min(end, from + grain);
+                enqueue(task([&body, &remaining, from, to]() {
+                    for (std::size_t index = from; index < to; ++index)
+                    {
+                        body(index);
+                    }
+                    remaining.done();
+                }));
+            }
+            notify(queued);
+
+            for (std::size_t index = begin; index < std::min(end, begin + grain); ++index)
+            {
+                body(index);
+            }
+        }
+        catch (...)
+        {
+            // Queued chunks refer to `body` and `remaining`, so they must finish before this frame is left
+            if (queued + 1 < chunks)
+            {
+                remaining.cancel(static_cast<std::uint32_t>(chunks - 1 - queued));
+                notify(queued);
+            }
+            join(remaining);
+            throw;
+        }
+        join(remaining);
+    }
+
+    // Runs one pending task on the calling thread. Returns false if no task was found.
+    bool run_pending_task();
+
+    std::size_t size() const
+    {
+        return workers.size();
+    }
+
+private:
+    // Counter of unfinished chunks. The high bit tells that the owner sleeps, so the last chunk should wake it.
+    class join_counter
+    {
+    public:
+        explicit join_counter(const std::uint32_t count) : state(count)
+        {
+        }
+
+        void done() noexcept
+        {
+            if (state.fetch_sub(1, std::memory_order_acq_rel) == (WaiterBit | 1))
+            {
+                futex_wake_all(state);
+            }
+        }
+
+        // Forgets chunks which were never queued, the owner does not sleep yet
+        void cancel(const std::uint32_t count) noexcept
+        {
+            state.fetch_sub(count, std::memory_order_acq_rel);
+        }
+
+        bool finished() const noexcept
+        {
+            return (state.load(std::memory_order_acquire) & ~WaiterBit) == 0;
+        }
+
+        void wait() noexcept
+        {
+            std::uint32_t value = state.load(std::memory_order_acquire);
+            if ((value & ~WaiterBit) == 0)
+            {
+                return;
+            }
+            if ((value & WaiterBit) == 0 &&
+                !state.compare_exchange_strong(value, value | WaiterBit, std::memory_order_acq_rel))
+            {
+                return;
+            }
+            futex_wait(state, value | WaiterBit);
+        }
+
+    private:
+        static constexpr std::uint32_t WaiterBit = 0x80000000u;
+        std::atomic<std::uint32_t> state;
+    };
+
+    struct LOSYNC_CACHE_ALIGNED Worker
+    {
+        work_stealing_deque<task> deque{DequeCapacity};
+        std::uint32_t random;
+        std::thread thread;
+    };
+
+    static constexpr std::size_t DequeCapacity = 1024;
+    static constexpr std::size_t MaxChunks = 1u << 30;
+
+    void enqueue(task&& value);
+    // Runs pending tasks until all chunks counted by `remaining` are finished
+    void join(join_counter& remaining) noexcept;
+    void notify(std::size_t count) noexcept;
+    void workerLoop(Worker& self);
+    std::optional<task> findTask(Worker* self);
+    std::optional<task> takeInjected(Worker* self);
+    std::optional<task> steal(Worker* self);
+    bool hasWork() const noexcept;
+    void park() noexcept;
+    Worker* currentWorker() const noexcept;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Tasks submitted from outside of the pool. The worker which holds `injectionBusy` is its only consumer.
+    mpsc_queue<task> injection;
+    LOSYNC_CACHE_ALIGNED std::atomic<bool> injectionBusy{false};
+    std::atomic<bool> injectionLeftover{false};
+
+    LOSYNC_CACHE_ALIGNED std::atomic<std::uint32_t> sleepers{0};
+    std::atomic<std::uint32_t> wakeEpoch{0};
+    std::atomic<bool> stopping{false};
+};
+
+} // namespace losync
@@ -0,0 +1,50 @@
+// `thread_slot` gives every live thread a small dense index.
+// Its features:
+//
+// 1. Indices of live threads are unique and start from zero, so they may be used to index per-thread arrays
+//    without collisions, unlike hashes of `std::thread::id`.
+// 2. The index is released when the thread exits and is given to the next new thread.
+//    The smallest free index is always reused, so indices stay dense.
+// 3. After the first call, getting the index of the current thread is a single thread_local read.
+
+#pragma once
+
+#include <cstddef>
+
+
+namespace losync
+{
+
+namespace detail
+{
+
+constexpr std::size_t no_thread_slot = ~std::size_t{0};
+
+inline thread_local std::size_t currentThreadSlot = no_thread_slot;
+
+} // namespace detail
+
+
+class thread_slot
+{
+public:
+    // Index of the current thread.
+    // Destructors of thread_local objects which run after the slot is released take a new slot which is never released.
+    static std::size_t index() noexcept
+    {
+        const std::size_t slot = detail::currentThreadSlot;
+        if (slot != detail::no_thread_slot)
+        {
+            return slot;
+        }
+        return acquire();
+    }
+
+    // Upper bound of all indices given so far: the maximal number of simultaneously live threads with a slot.
+    static std::size_t high_water() noexcept;
+
+private:
+    static std::size_t acquire() noexcept;
+};
+
+} // namespace losync
@@ -0,0 +1,275 @@
+// `timer_wheel` is a hierarchical timing wheel which runs `hybrid_function<void()>` callbacks at their deadlines.
+// Its features:
+//
+// 1. Time is split into ticks of a fixed resolution. Four levels of 256 slots cover 2^32 ticks,
+//    later deadlines wait in an overflow list. Timers move to lower levels when their slot comes due.
+// 2. `schedule` and `cancel` take O(1): a timer is a node of an intrusive doubly-linked list of its slot.
+// 3. Nodes come from a pool of the wheel and are recycled, so scheduling allocates only while the number
+//    of pending timers grows beyond its previous maximum. Callbacks are stored inline in the nodes.
+// 4. `advance(now)` fires all expired timers in one batch and skips empty slots with occupancy bitmaps,
+//    so a long idle period costs a few bitmap scans rather than a step per tick.
+// 5. `timer_wheel` is driven by the caller's event loop, which should sleep until `next_deadline()`.
+//    It is not thread-safe. `timer_thread` owns a wheel and a thread and accepts timers from any thread.
+// 6. A timer never fires before its deadline, and fires at the first `advance` at least one tick later.
+
+#pragma once
+
+#include <losync/cheap_function.h>
+#include <losync/mutex.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace losync
+{
+
+class timer_wheel
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using callback = hybrid_function<void()>;
+
+    // Identifies a scheduled timer. Ids of fired and cancelled timers are not reused for a long time.
+    using timer_id = std::uint64_t;
+    static constexpr timer_id invalid_timer = 0;
+
+    static constexpr std::size_t levels = 4;
+    static constexpr std::size_t slots_per_level = 256;
+
+    explicit timer_wheel(clock::duration resolution = std::chrono::milliseconds(1),
+                         clock::time_point start = clock::now());
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    // Pending callbacks are destroyed without being called
+    ~timer_wheel();
+
+    template <typename F>
+    timer_id schedule(const clock::time_point deadline, F&& func)
+    {
+        Node* const node = acquireNode();
+        try
+        {
+            new (&node->storage) callback(std::forward<F>(func));
+        }
+        catch (...)
+        {
+            releaseNode(node);
+            throw;
+        }
+        node->deadline = ceilTick(deadline);
+        insert(node);
+        ++pending;
+        return idOf(node);
+    }
+
+    template <typename F>
+    timer_id schedule_after(const clock::duration delay, F&& func)
+    {
+        return schedule(clock::now() + delay, std::forward<F>(func));
+    }
+
+    // Returns false if the timer has already fired or was cancelled
+    bool cancel(timer_id id) noexcept;
+
+    // Fires all timers which expired by `now`. Returns the number of fired timers.
+    std::size_t advance(const clock::time_point now)
+    {
+        return advance(now, [](callback& func) { func(); });
+    }
+
+    // Passes the callbacks of expired timers to `sink(callback&)` instead of calling them.
+    // Callbacks may schedule and cancel timers. If `sink` throws, the remaining expired timers fire next time.
+    template <typename Sink>
+    std::size_t advance(const clock::time_point now, Sink&& sink)
+    {
+        const std::uint64_t target = floorTick(now);
+        std::size_t fired = 0;
+        for (std::uint64_t tick = nextEventTick(); tick <= target; tick = nextEventTick())
+        {
+            Link expired;
+            beginTick(tick, expired);
+            while (expired.next != &expired)
+            {
+                Node* const node = static_cast<Node*>(expired.next);
+                unlink(node);
+                callback func = std::move(*node->func());
+                node->func()->~callback();
+                releaseNode(node);
+                --pending;
+                ++fired;
+                try
+                {
+                    sink(func);
+                }
+                catch (...)
+                {
+                    requeue(expired);
+                    throw;
+                }
+            }
+        }
+        if (target >= current)
+        {
+            current = target + 1;
+        }
+        return fired;
+    }
+
+    // The time when `advance` should be called next, nullopt if no timers are pending.
+    // May be earlier than the nearest deadline when timers move between levels.
+    std::optional<clock::time_point> next_deadline() const noexcept;
+
+    std::size_t size() const noexcept
+    {
+        return pending;
+    }
+
+    bool empty() const noexcept
+    {
+        return pending == 0;
+    }
+
+    clock::duration resolution() const noexcept
+    {
+        return tickLength;
+    }
+
+private:
+    struct Link
+    {
+        Link* prev = this;
+        Link* next = this;
+    };
+
+    struct Node : Link
+    {
+        std::uint64_t deadline;
+        std::uint32_t index;
+        std::uint32_t generation = 1;
+        std::uint32_t position;
+        alignas(callback) unsigned char storage[sizeof(callback)];
+
+        callback* func() noexcept
+        {
+            return std::launder(reinterpret_cast<callback*>(&storage));
+        }
+    };
+
+    // Slot positions: `level * slots_per_level + slot`, then the overflow list
+    static constexpr std::uint32_t OverflowPosition = levels * slots_per_level;
+    static constexpr std::uint32_t NoPosition = OverflowPosition + 1;
+    static constexpr std::size_t LevelBits = 8;
+    static constexpr std::size_t BitmapWords = slots_per_level / 64;
+    // Segment `i` of the node pool holds `FirstSegmentSize << i` nodes
+    static constexpr std::uint32_t FirstSegmentSize = 64;
+
+    std::uint64_t floorTick(clock::time_point time) const noexcept;
+    std::uint64_t ceilTick(clock::time_point time) const noexcept;
+    timer_id idOf(const Node* node) const noexcept;
+
+    Node* acquireNode();
+    void releaseNode(Node* node) noexcept;
+    Node* nodeAt(std::uint32_t index) const noexcept;
+
+    void insert(Node* node) noexcept;
+    void unlink(Node* node) noexcept;
+    void takeSlot(std::uint32_t position, Link& list) noexcept;
+    void requeue(Link& list) noexcept;
+
+    // The earliest tick at which a timer fires or moves to a lower level, `~0` if none
+    std::uint64_t nextEventTick() const noexcept;
+    // Moves due timers to lower levels and the timers which expire at `tick` into `expired`
+    void beginTick(std::uint64_t tick, Link& expired) noexcept;
+
+    const clock::duration tickLength;
+    const clock::time_point start;
+    // The first tick which is not processed yet
+    std::uint64_t current = 0;
+    std::size_t pending = 0;
+
+    Link slots[levels * slots_per_level + 1];
+    std::uint64_t occupied[levels][BitmapWords] = {};
+
+    std::vector<std::unique_ptr<Node[]>> segments;
+    std::uint32_t nodeCount = 0;
+    Node* freeNodes = nullptr;
+};
+
+
+// Runs a `timer_wheel` on its own thread. Timers may be scheduled and cancelled from any thread,
+// callbacks run on the timer thread without the lock held, so they may schedule and cancel timers too.
+// Callbacks should not throw: an exception escaping a callback terminates the program, like in `thread_pool`.
+class timer_thread
+{
+public:
+    using clock = timer_wheel::clock;
+    using callback = timer_wheel::callback;
+    using timer_id = timer_wheel::timer_id;
+
+    explicit timer_thread(clock::duration resolution = std::chrono::milliseconds(1));
+
+    timer_thread(const timer_thread&) = delete;
+    timer_thread& operator=(const timer_thread&) = delete;
+
+    // Stops the thread. Pending callbacks are destroyed without being called.
+    ~timer_thread();
+
+    template <typename F>
+    timer_id schedule(const clock::time_point deadline, F&& func)
+    {
+        bool earlier = false;
+        timer_id id;
+        {
+            std::lock_guard<losync::mutex> lock(mutex);
+            id = wheel.schedule(deadline, std::forward<F>(func));
+            if (deadline < wakeAt)
+            {
+                wakeAt = deadline;
+                earlier = true;
+            }
+        }
+        // The thread sleeps longer than needed
+        if (earlier)
+        {
+            wake();
+        }
+        return id;
+    }
+
+    template <typename F>
+    timer_id schedule_after(const clock::duration delay, F&& func)
+    {
+        return schedule(clock::now() + delay, std::forward<F>(func));
+    }
+
+    // Returns false if the timer has already fired or was cancelled
+    bool cancel(timer_id id);
+
+    std::size_t size();
+
+private:
+    void wake() noexcept;
+    void loop();
+
+    losync::mutex mutex;
+    timer_wheel wheel;
+    // The time until which the thread sleeps, guarded by `mutex`
+    clock::time_point wakeAt = clock::time_point::max();
+    bool stopping = false;
+    std::atomic<std::uint32_t> wakeEpoch{0};
+    std::thread thread;
+};
+
+} // namespace losync
@@ -0,0 +1,161 @@
+// `work_stealing_deque` is a bounded Chase-Lev deque.
+// Its features:
+//
+// 1. The owner thread pushes and pops elements at the bottom without atomic RMW operations,
+//    except for the race for the last element.
+// 2. Any thread may steal the oldest element from the top with one CAS.
+// 3. Elements are stored in place and may be move-only, like `cheap_function`.
+//    A thief first claims the slot and then moves the element out, so elements are never copied speculatively.
+// 4. The capacity is fixed: `push` reports failure instead of growing.
+//
+// Memory orders follow "Correct and Efficient Work-Stealing for Weak Memory Models" by Le, Pop, Cohen and Nardelli.
+
+#pragma once
+
+#include <losync/cache_aligned.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+
+namespace losync
+{
+
+template <typename T>
+class work_stealing_deque
+{
+public:
+    // `capacity` is rounded up to a power of two
+    explicit work_stealing_deque(const std::size_t capacity)
+        : mask(roundUpToPowerOfTwo(capacity) - 1), slots(new Slot[mask + 1])
+    {
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    ~work_stealing_deque()
+    {
+        while (pop())
+        {
+        }
+    }
+
+    // Only the owner may push. Returns false if the deque is full, `value` is left untouched then.
+    bool push(T&& value)
+    {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_acquire);
+        if (b - t > static_cast<std::int64_t>(mask))
+        {
+            return false;
+        }
+        Slot& slot = slots[b & mask];
+        // A thief may still be moving the previous element out of the slot
+        if (slot.full.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        new (&slot.storage) T(std::move(value));
+        slot.full.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Only the owner may pop. Takes the most recently pushed element.
+    std::optional<T> pop()
+    {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        if (t == b)
+        {
+            // The last element: race with thieves
+            const bool won =
+                top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won)
+            {
+                return std::nullopt;
+            }
+        }
+        return takeFrom(slots[b & mask]);
+    }
+
+    // Any thread may steal. Takes the oldest element.
+    // Returns nullopt if the deque is empty or another thread won the race for the element.
+    std::optional<T> steal()
+    {
+        std::int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return std::nullopt;
+        }
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return std::nullopt;
+        }
+        return takeFrom(slots[t & mask]);
+    }
+
+    // Approximate number of elements. Any thread may call it.
+    std::size_t size() const
+    {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    std::size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<bool> full{false};
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static std::optional<T> takeFrom(Slot& slot)
+    {
+        T* const value = std::launder(reinterpret_cast<T*>(&slot.storage));
+        std::optional<T> result(std::move(*value));
+        value->~T();
+        slot.full.store(false, std::memory_order_release);
+        return result;
+    }
+
+    static std::size_t roundUpToPowerOfTwo(const std::size_t value)
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    LOSYNC_CACHE_ALIGNED std::atomic<std::int64_t> top{0};
+    LOSYNC_CACHE_ALIGNED std::atomic<std::int64_t> bottom{0};
+    const std::size_t mask;
+    const std::unique_ptr<Slot[]> slots;
+};
+
+} // namespace losync
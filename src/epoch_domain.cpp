@@ -0,0 +1,98 @@
+#include <losync/epoch_domain.h>
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace losync
+{
+
+namespace
+{
+
+// Reader records are never freed: a record of an exited thread is reused by a new one
+std::atomic<detail::rcu_reader*> readers{nullptr};
+
+detail::rcu_reader& acquireReader()
+{
+    for (detail::rcu_reader* reader = readers.load(std::memory_order_acquire); reader != nullptr;
+         reader = reader->next)
+    {
+        bool used = false;
+        if (!reader->used.load(std::memory_order_relaxed) &&
+            reader->used.compare_exchange_strong(used, true, std::memory_order_acquire))
+        {
+            return *reader;
+        }
+    }
+    detail::rcu_reader* const reader = new detail::rcu_reader();
+    detail::rcu_reader* head = readers.load(std::memory_order_relaxed);
+    do
+    {
+        reader->next = head;
+    } while (!readers.compare_exchange_weak(head, reader, std::memory_order_release, std::memory_order_relaxed));
+    return *reader;
+}
+
+
+// Releases the reader record of the thread when it exits
+class ReaderOwner
+{
+public:
+    explicit ReaderOwner(detail::rcu_reader& reader) : reader(reader)
+    {
+    }
+
+    ReaderOwner(const ReaderOwner&) = delete;
+    ReaderOwner& operator=(const ReaderOwner&) = delete;
+
+    ~ReaderOwner()
+    {
+        detail::currentRcuReader = nullptr;
+        ownerDestroyed = true;
+        reader.used.store(false, std::memory_order_release);
+    }
+
+    inline static thread_local bool ownerDestroyed = false;
+
+private:
+    detail::rcu_reader& reader;
+};
+
+} // namespace
+
+
+// Destructors of thread_local objects which read cells after the record is released take a record which is never released
+detail::rcu_reader& detail::rcu_register_reader() noexcept
+{
+    rcu_reader& reader = acquireReader();
+    if (!ReaderOwner::ownerDestroyed)
+    {
+        thread_local ReaderOwner owner(reader);
+    }
+    currentRcuReader = &reader;
+    return reader;
+}
+
+std::uint64_t detail::rcu_advance_epoch() noexcept
+{
+    return rcuGlobalEpoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+std::uint64_t detail::rcu_oldest_active_epoch() noexcept
+{
+    // Pairs with the fence in rcu_read_lock()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t oldest = rcuGlobalEpoch.load(std::memory_order_relaxed);
+    for (rcu_reader* reader = readers.load(std::memory_order_acquire); reader != nullptr; reader = reader->next)
+    {
+        const std::uint64_t epoch = reader->epoch.load(std::memory_order_acquire);
+        if (epoch != 0 && epoch < oldest)
+        {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+} // namespace losync
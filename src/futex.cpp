@@ -0,0 +1,158 @@
+#include <losync/futex.h>
+
+#include <climits>
+
+#if defined(__linux__)
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#else
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#endif
+
+
+namespace losync
+{
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+#if defined(__linux__)
+
+namespace
+{
+
+long futex(const std::atomic<std::uint32_t>& word, const int op, const std::uint32_t value,
+           const timespec* timeout = nullptr) noexcept
+{
+    return syscall(SYS_futex, reinterpret_cast<const std::uint32_t*>(&word), op | FUTEX_PRIVATE_FLAG, value, timeout,
+                   nullptr, 0);
+}
+
+} // namespace
+
+void futex_wait(const std::atomic<std::uint32_t>& word, const std::uint32_t expected) noexcept
+{
+    futex(word, FUTEX_WAIT, expected);
+}
+
+void futex_wait_for(const std::atomic<std::uint32_t>& word, const std::uint32_t expected,
+                    const std::chrono::nanoseconds timeout) noexcept
+{
+    if (timeout <= std::chrono::nanoseconds::zero())
+    {
+        return;
+    }
+    // FUTEX_WAIT takes a relative timeout
+    timespec relative;
+    relative.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    relative.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    futex(word, FUTEX_WAIT, expected, &relative);
+}
+
+void futex_wake_one(const std::atomic<std::uint32_t>& word) noexcept
+{
+    futex(word, FUTEX_WAKE, 1);
+}
+
+void futex_wake_all(const std::atomic<std::uint32_t>& word) noexcept
+{
+    futex(word, FUTEX_WAKE, INT_MAX);
+}
+
+#elif defined(_WIN32)
+
+void futex_wait(const std::atomic<std::uint32_t>& word, std::uint32_t expected) noexcept
+{
+    WaitOnAddress(const_cast<std::atomic<std::uint32_t>*>(&word), &expected, sizeof(expected), INFINITE);
+}
+
+void futex_wait_for(const std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                    const std::chrono::nanoseconds timeout) noexcept
+{
+    if (timeout <= std::chrono::nanoseconds::zero())
+    {
+        return;
+    }
+    // Round up, so a short timeout does not turn into a busy loop
+    const auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+    const DWORD wait = milliseconds >= INFINITE ? INFINITE - 1 : static_cast<DWORD>(milliseconds);
+    WaitOnAddress(const_cast<std::atomic<std::uint32_t>*>(&word), &expected, sizeof(expected), wait);
+}
+
+void futex_wake_one(const std::atomic<std::uint32_t>& word) noexcept
+{
+    WakeByAddressSingle(const_cast<std::atomic<std::uint32_t>*>(&word));
+}
+
+void futex_wake_all(const std::atomic<std::uint32_t>& word) noexcept
+{
+    WakeByAddressAll(const_cast<std::atomic<std::uint32_t>*>(&word));
+}
+
+#else
+
+namespace
+{
+
+// Waiters are parked on a condition variable chosen by the hash of the address
+struct Bucket
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+Bucket& bucketOf(const void* address)
+{
+    static Bucket buckets[64];
+    return buckets[std::hash<const void*>{}(address) % 64];
+}
+
+} // namespace
+
+void futex_wait(const std::atomic<std::uint32_t>& word, const std::uint32_t expected) noexcept
+{
+    Bucket& bucket = bucketOf(&word);
+    std::unique_lock<std::mutex> lock(bucket.mutex);
+    if (word.load(std::memory_order_acquire) == expected)
+    {
+        bucket.condition.wait(lock);
+    }
+}
+
+void futex_wait_for(const std::atomic<std::uint32_t>& word, const std::uint32_t expected,
+                    const std::chrono::nanoseconds timeout) noexcept
+{
+    Bucket& bucket = bucketOf(&word);
+    std::unique_lock<std::mutex> lock(bucket.mutex);
+    if (word.load(std::memory_order_acquire) == expected)
+    {
+        bucket.condition.wait_for(lock, timeout);
+    }
+}
+
+void futex_wake_one(const std::atomic<std::uint32_t>& word) noexcept
+{
+    // Other addresses may share the bucket, so everybody is woken up and rechecks its condition
+    futex_wake_all(word);
+}
+
+void futex_wake_all(const std::atomic<std::uint32_t>& word) noexcept
+{
+    Bucket& bucket = bucketOf(&word);
+    {
+        std::lock_guard<std::mutex> lock(bucket.mutex);
+    }
+    bucket.condition.notify_all();
+}
+
+#endif
+
+} // namespace losync
@@ -0,0 +1,279 @@
+#include <losync/backoff.h>
+#include <losync/mutex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace losync
+{
+
+void mutex::lockSlow() noexcept
+{
+    exponential_backoff backoff;
+    while (backoff.spin())
+    {
+        std::uint32_t value = state.load(std::memory_order_relaxed);
+        if (value == Unlocked &&
+            state.compare_exchange_weak(value, Locked, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+    // Mark the mutex as having waiters, so the owner wakes somebody in unlock().
+    // A thread which takes the mutex this way keeps the mark: there may be other sleepers.
+    while (state.exchange(LockedWithWaiters, std::memory_order_acquire) != Unlocked)
+    {
+        futex_wait(state, LockedWithWaiters);
+    }
+}
+
+
+#if defined(LOSYNC_MUTEX_PROFILING)
+
+namespace
+{
+
+// Updated only by the owning thread, read by `collect()` from any thread
+struct SiteStats
+{
+    std::atomic<const char*> file{nullptr};
+    std::atomic<unsigned> line{0};
+    std::atomic<std::uint64_t> acquisitions{0};
+    std::atomic<std::uint64_t> contended{0};
+    std::atomic<std::uint64_t> waitNs{0};
+    std::atomic<std::uint64_t> maxWaitNs{0};
+    std::atomic<std::uint64_t> holdNs{0};
+    std::atomic<std::uint64_t> maxHoldNs{0};
+};
+
+void add(std::atomic<std::uint64_t>& value, const std::uint64_t delta) noexcept
+{
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void raise(std::atomic<std::uint64_t>& value, const std::uint64_t candidate) noexcept
+{
+    if (candidate > value.load(std::memory_order_relaxed))
+    {
+        value.store(candidate, std::memory_order_relaxed);
+    }
+}
+
+// Open addressing table of the sites used by one thread. Sites which do not fit are counted together.
+class ThreadTable
+{
+public:
+    ThreadTable() noexcept
+    {
+        overflow.file.store("<other sites>", std::memory_order_relaxed);
+    }
+
+    SiteStats& find(const char* file, const unsigned line) noexcept
+    {
+        std::size_t index = (std::hash<const void*>()(file) ^ (line * 0x9E3779B9u)) & (TableSize - 1);
+        for (std::size_t probe = 0; probe < TableSize; ++probe, index = (index + 1) & (TableSize - 1))
+        {
+            SiteStats& site = sites[index];
+            const char* const siteFile = site.file.load(std::memory_order_relaxed);
+            if (siteFile == nullptr)
+            {
+                site.line.store(line, std::memory_order_relaxed);
+                site.file.store(file, std::memory_order_release);
+                return site;
+            }
+            if (siteFile == file && site.line.load(std::memory_order_relaxed) == line)
+            {
+                return site;
+            }
+        }
+        return overflow;
+    }
+
+    template <typename F>
+    void forEach(F&& func) const
+    {
+        for (const SiteStats& site : sites)
+        {
+            if (site.file.load(std::memory_order_acquire) != nullptr)
+            {
+                func(site);
+            }
+        }
+        if (overflow.acquisitions.load(std::memory_order_relaxed) != 0)
+        {
+            func(overflow);
+        }
+    }
+
+private:
+    static constexpr std::size_t TableSize = 256;
+
+    SiteStats sites[TableSize];
+    SiteStats overflow;
+};
+
+using SiteKey = std::pair<std::string, unsigned>;
+
+void merge(std::map<SiteKey, mutex_site_stats>& result, const SiteStats& site)
+{
+    const char* const file = site.file.load(std::memory_order_acquire);
+    const unsigned line = site.line.load(std::memory_order_relaxed);
+    mutex_site_stats& stats = result[SiteKey(file, line)];
+    stats.file = file;
+    stats.line = line;
+    stats.acquisitions += site.acquisitions.load(std::memory_order_relaxed);
+    stats.contended += site.contended.load(std::memory_order_relaxed);
+    stats.wait_ns += site.waitNs.load(std::memory_order_relaxed);
+    stats.max_wait_ns = std::max(stats.max_wait_ns, site.maxWaitNs.load(std::memory_order_relaxed));
+    stats.hold_ns += site.holdNs.load(std::memory_order_relaxed);
+    stats.max_hold_ns = std::max(stats.max_hold_ns, site.maxHoldNs.load(std::memory_order_relaxed));
+}
+
+class ProfileRegistry
+{
+public:
+    void add(const ThreadTable* table)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        live.push_back(table);
+    }
+
+    // Keeps the statistics of an exiting thread
+    void remove(const ThreadTable* table)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        table->forEach([this](const SiteStats& site) { merge(retired, site); });
+        live.erase(std::find(live.begin(), live.end(), table));
+    }
+
+    std::vector<mutex_site_stats> collect()
+    {
+        std::map<SiteKey, mutex_site_stats> merged;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            merged = retired;
+            for (const ThreadTable* table : live)
+            {
+                table->forEach([&merged](const SiteStats& site) { merge(merged, site); });
+            }
+        }
+        std::vector<mutex_site_stats> result;
+        result.reserve(merged.size());
+        for (const auto& entry : merged)
+        {
+            result.push_back(entry.second);
+        }
+        std::sort(result.begin(), result.end(), [](const mutex_site_stats& a, const mutex_site_stats& b) {
+            return a.wait_ns > b.wait_ns;
+        });
+        return result;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<const ThreadTable*> live;
+    std::map<SiteKey, mutex_site_stats> retired;
+};
+
+ProfileRegistry& registry()
+{
+    // Never destroyed: threads may exit during static destruction
+    static ProfileRegistry* const instance = new ProfileRegistry();
+    return *instance;
+}
+
+
+class TableOwner
+{
+public:
+    TableOwner() : table(new ThreadTable())
+    {
+        registry().add(table.get());
+    }
+
+    TableOwner(const TableOwner&) = delete;
+    TableOwner& operator=(const TableOwner&) = delete;
+
+    ~TableOwner()
+    {
+        ownerDestroyed = true;
+        registry().remove(table.get());
+    }
+
+    ThreadTable& get() noexcept
+    {
+        return *table;
+    }
+
+    inline static thread_local bool ownerDestroyed = false;
+
+private:
+    const std::unique_ptr<ThreadTable> table;
+};
+
+} // namespace
+
+
+std::uint64_t detail::mutex_clock_ns() noexcept
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void detail::record_mutex_use(const char* file, const unsigned line, const std::uint64_t waitNs,
+                              const std::uint64_t holdNs) noexcept
+{
+    // Mutexes used by destructors of thread_local objects after the table is gone are not recorded
+    if (TableOwner::ownerDestroyed)
+    {
+        return;
+    }
+    thread_local TableOwner owner;
+    SiteStats& site = owner.get().find(file, line);
+    add(site.acquisitions, 1);
+    if (waitNs != 0)
+    {
+        add(site.contended, 1);
+        add(site.waitNs, waitNs);
+        raise(site.maxWaitNs, waitNs);
+    }
+    add(site.holdNs, holdNs);
+    raise(site.maxHoldNs, holdNs);
+}
+
+bool mutex_profile::enabled() noexcept
+{
+    return true;
+}
+
+std::vector<mutex_site_stats> mutex_profile::collect()
+{
+    return registry().collect();
+}
+
+#else
+
+bool mutex_profile::enabled() noexcept
+{
+    return false;
+}
+
+std::vector<mutex_site_stats> mutex_profile::collect()
+{
+    return {};
+}
+
+#endif
+
+} // namespace losync
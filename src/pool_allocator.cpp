@@ -0,0 +1,247 @@
+#include <losync/pool_allocator.h>
+
+#include <cassert>
+#include <mutex>
+#include <new>
+
+
+namespace losync
+{
+
+namespace
+{
+
+constexpr std::size_t SizeClassCount = 8; // 32, 64, ..., 4096
+constexpr std::size_t BatchSize = 32;
+constexpr std::size_t MaxCachedBlocks = 2 * BatchSize;
+constexpr std::size_t ChunkSize = 64 * 1024;
+
+static_assert(pool_allocator::min_block_size << (SizeClassCount - 1) == pool_allocator::max_block_size);
+static_assert(pool_allocator::min_block_size % alignof(std::max_align_t) == 0);
+
+
+struct FreeBlock
+{
+    FreeBlock* next;
+};
+
+struct Batch
+{
+    FreeBlock* head = nullptr;
+    std::size_t count = 0;
+};
+
+std::size_t sizeClassOf(const std::size_t size)
+{
+    std::size_t index = 0;
+    std::size_t blockSize = pool_allocator::min_block_size;
+    while (blockSize < size)
+    {
+        blockSize <<= 1;
+        ++index;
+    }
+    return index;
+}
+
+std::size_t blockSizeOf(const std::size_t sizeClass)
+{
+    return pool_allocator::min_block_size << sizeClass;
+}
+
+
+// Global storage of free blocks. It is shared by all threads and is accessed under the lock.
+class Depot
+{
+public:
+    Batch takeBatch(const std::size_t sizeClass)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        SizeClass& state = classes[sizeClass];
+
+        Batch batch;
+        while (batch.count < BatchSize && state.head != nullptr)
+        {
+            FreeBlock* const block = state.head;
+            state.head = block->next;
+            block->next = batch.head;
+            batch.head = block;
+            ++batch.count;
+        }
+        state.count -= batch.count;
+        if (batch.count != 0)
+        {
+            return batch;
+        }
+
+        // The depot is empty: carve a new chunk
+        const std::size_t blockSize = blockSizeOf(sizeClass);
+        char* const chunk = static_cast<char*>(::operator new(ChunkSize));
+        for (std::size_t offset = 0; offset + blockSize <= ChunkSize; offset += blockSize)
+        {
+            FreeBlock* const block = reinterpret_cast<FreeBlock*>(chunk + offset);
+            if (batch.count < BatchSize)
+            {
+                block->next = batch.head;
+                batch.head = block;
+                ++batch.count;
+            }
+            else
+            {
+                block->next = state.head;
+                state.head = block;
+                ++state.count;
+            }
+        }
+        return batch;
+    }
+
+    void putBlocks(const std::size_t sizeClass, FreeBlock* head, FreeBlock* tail, const std::size_t count)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        SizeClass& state = classes[sizeClass];
+        tail->next = state.head;
+        state.head = head;
+        state.count += count;
+    }
+
+private:
+    struct SizeClass
+    {
+        FreeBlock* head = nullptr;
+        std::size_t count = 0;
+    };
+
+    std::mutex mutex;
+    SizeClass classes[SizeClassCount];
+};
+
+Depot& depot()
+{
+    // Never destroyed: thread caches may return their blocks during static destruction
+    static Depot* const instance = new Depot();
+    return *instance;
+}
+
+
+// Set when the cache of the current thread is destroyed, but other thread_local destructors still run
+thread_local bool threadCacheDestroyed = false;
+
+class ThreadCache
+{
+public:
+    ThreadCache() = default;
+    ThreadCache(const ThreadCache&) = delete;
+    ThreadCache& operator=(const ThreadCache&) = delete;
+
+    ~ThreadCache()
+    {
+        for (std::size_t sizeClass = 0; sizeClass < SizeClassCount; ++sizeClass)
+        {
+            Batch& cache = caches[sizeClass];
+            if (cache.count != 0)
+            {
+                FreeBlock* tail = cache.head;
+                while (tail->next != nullptr)
+                {
+                    tail = tail->next;
+                }
+                depot().putBlocks(sizeClass, cache.head, tail, cache.count);
+            }
+        }
+        threadCacheDestroyed = true;
+    }
+
+    void* allocate(const std::size_t sizeClass)
+    {
+        Batch& cache = caches[sizeClass];
+        if (cache.head == nullptr)
+        {
+            cache = depot().takeBatch(sizeClass);
+        }
+        FreeBlock* const block = cache.head;
+        cache.head = block->next;
+        --cache.count;
+        return block;
+    }
+
+    void deallocate(void* ptr, const std::size_t sizeClass)
+    {
+        Batch& cache = caches[sizeClass];
+        FreeBlock* const block = static_cast<FreeBlock*>(ptr);
+        block->next = cache.head;
+        cache.head = block;
+        ++cache.count;
+
+        if (cache.count > MaxCachedBlocks)
+        {
+            // Give the oldest half back to the depot, the most recent blocks are likely still in the CPU cache
+            FreeBlock* last = cache.head;
+            for (std::size_t i = 1; i < cache.count - BatchSize; ++i)
+            {
+                last = last->next;
+            }
+            FreeBlock* const head = last->next;
+            FreeBlock* tail = head;
+            while (tail->next != nullptr)
+            {
+                tail = tail->next;
+            }
+            last->next = nullptr;
+            depot().putBlocks(sizeClass, head, tail, BatchSize);
+            cache.count -= BatchSize;
+        }
+    }
+
+private:
+    Batch caches[SizeClassCount];
+};
+
+thread_local ThreadCache threadCache;
+
+} // namespace
+
+
+void* pool_allocator::allocate(const std::size_t size)
+{
+    if (size > max_block_size)
+    {
+        return ::operator new(size);
+    }
+    const std::size_t sizeClass = sizeClassOf(size);
+    if (threadCacheDestroyed)
+    {
+        Batch batch = depot().takeBatch(sizeClass);
+        FreeBlock* const block = batch.head;
+        if (batch.count > 1)
+        {
+            FreeBlock* tail = block->next;
+            while (tail->next != nullptr)
+            {
+                tail = tail->next;
+            }
+            depot().putBlocks(sizeClass, block->next, tail, batch.count - 1);
+        }
+        return block;
+    }
+    return threadCache.allocate(sizeClass);
+}
+
+void pool_allocator::deallocate(void* ptr, const std::size_t size) noexcept
+{
+    assert(ptr != nullptr);
+    if (size > max_block_size)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+    const std::size_t sizeClass = sizeClassOf(size);
+    if (threadCacheDestroyed)
+    {
+        FreeBlock* const block = static_cast<FreeBlock*>(ptr);
+        depot().putBlocks(sizeClass, block, block, 1);
+        return;
+    }
+    threadCache.deallocate(ptr, sizeClass);
+}
+
+} // namespace losync
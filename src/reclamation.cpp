@@ -0,0 +1,394 @@
+#include <losync/reclamation.h>
+#include <losync/sharded_counter.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace losync
+{
+
+namespace
+{
+
+using detail::retired_object;
+
+
+// Hazard pointers of one thread. Records are never freed, a record of an exited thread is reused by a new one.
+struct LOSYNC_CACHE_ALIGNED HazardRecord
+{
+    std::atomic<const void*> slots[hazard_pointers::slots_per_thread] = {};
+    std::atomic<bool> used{true};
+    HazardRecord* next = nullptr;
+    // Slots taken by holders, accessed only by the owner
+    std::uint32_t takenMask = 0;
+};
+
+std::atomic<HazardRecord*> hazardRecords{nullptr};
+std::atomic<std::size_t> hazardRecordCount{0};
+
+thread_local HazardRecord* currentHazardRecord = nullptr;
+
+HazardRecord& acquireHazardRecord()
+{
+    for (HazardRecord* record = hazardRecords.load(std::memory_order_acquire); record != nullptr;
+         record = record->next)
+    {
+        bool used = false;
+        if (!record->used.load(std::memory_order_relaxed) &&
+            record->used.compare_exchange_strong(used, true, std::memory_order_acquire))
+        {
+            return *record;
+        }
+    }
+    HazardRecord* const record = new HazardRecord();
+    HazardRecord* head = hazardRecords.load(std::memory_order_relaxed);
+    do
+    {
+        record->next = head;
+    } while (!hazardRecords.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+    hazardRecordCount.fetch_add(1, std::memory_order_relaxed);
+    return *record;
+}
+
+// Releases the hazard record of the thread when it exits
+class HazardRecordOwner
+{
+public:
+    explicit HazardRecordOwner(HazardRecord& record) : record(record)
+    {
+    }
+
+    HazardRecordOwner(const HazardRecordOwner&) = delete;
+    HazardRecordOwner& operator=(const HazardRecordOwner&) = delete;
+
+    ~HazardRecordOwner()
+    {
+        currentHazardRecord = nullptr;
+        ownerDestroyed = true;
+        record.used.store(false, std::memory_order_release);
+    }
+
+    inline static thread_local bool ownerDestroyed = false;
+
+private:
+    HazardRecord& record;
+};
+
+HazardRecord& localHazardRecord()
+{
+    if (currentHazardRecord == nullptr)
+    {
+        HazardRecord& record = acquireHazardRecord();
+        if (!HazardRecordOwner::ownerDestroyed)
+        {
+            thread_local HazardRecordOwner owner(record);
+        }
+        currentHazardRecord = &record;
+    }
+    return *currentHazardRecord;
+}
+
+
+struct EbrPolicy
+{
+    class Scan
+    {
+    public:
+        // Advancing the epoch after the objects were unlinked makes every reader which starts later miss them
+        Scan() : epoch(detail::rcu_advance_epoch()), oldest(detail::rcu_oldest_active_epoch())
+        {
+        }
+
+        bool inUse(retired_object& object) const
+        {
+            if (object.epoch == 0)
+            {
+                object.epoch = epoch;
+            }
+            return object.epoch >= oldest;
+        }
+
+    private:
+        const std::uint64_t epoch;
+        const std::uint64_t oldest;
+    };
+
+    static std::size_t threshold()
+    {
+        return ebr::batch_size;
+    }
+};
+
+
+struct HazardPolicy
+{
+    class Scan
+    {
+    public:
+        Scan() : hazards(scratch())
+        {
+            // Pairs with the fence in holder::protect()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            hazards.clear();
+            for (HazardRecord* record = hazardRecords.load(std::memory_order_acquire); record != nullptr;
+                 record = record->next)
+            {
+                for (const auto& slot : record->slots)
+                {
+                    if (const void* const ptr = slot.load(std::memory_order_acquire))
+                    {
+                        hazards.push_back(ptr);
+                    }
+                }
+            }
+            std::sort(hazards.begin(), hazards.end());
+        }
+
+        bool inUse(const retired_object& object) const
+        {
+            return std::binary_search(hazards.begin(), hazards.end(), object.pointer);
+        }
+
+    private:
+        static std::vector<const void*>& scratch()
+        {
+            thread_local std::vector<const void*> instance;
+            return instance;
+        }
+
+        std::vector<const void*>& hazards;
+    };
+
+    // Amortizes the scan over more objects than there may be hazards
+    static std::size_t threshold()
+    {
+        return std::max(hazard_pointers::batch_size,
+                        2 * hazard_pointers::slots_per_thread * hazardRecordCount.load(std::memory_order_relaxed));
+    }
+};
+
+
+template <typename Policy>
+class Reclaimer
+{
+public:
+    static void retire(const void* ptr, detail::reclaim_deleter&& deleter)
+    {
+        unreclaimedObjects().add(1);
+        retired_object object{std::move(deleter), ptr, 0};
+        Batch* const batch = localBatch();
+        if (batch == nullptr)
+        {
+            orphans().add(std::move(object));
+            return;
+        }
+        batch->objects.push_back(std::move(object));
+        if (batch->objects.size() >= batch->nextCollect)
+        {
+            collect(*batch);
+        }
+    }
+
+    static std::size_t collect()
+    {
+        Batch* const batch = localBatch();
+        if (batch == nullptr)
+        {
+            return 0;
+        }
+        return collect(*batch);
+    }
+
+    static sharded_counter& unreclaimedObjects()
+    {
+        // Never destroyed: threads may retire objects during static destruction
+        static sharded_counter* const instance = new sharded_counter();
+        return *instance;
+    }
+
+private:
+    // Objects left by exited threads
+    class Orphans
+    {
+    public:
+        void add(retired_object&& object)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            objects.push_back(std::move(object));
+        }
+
+        void add(std::vector<retired_object>& batch)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& object : batch)
+            {
+                objects.push_back(std::move(object));
+            }
+            batch.clear();
+        }
+
+        // Does not wait if another thread is adopting the orphans
+        void adopt(std::vector<retired_object>& batch)
+        {
+            std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+            if (!lock.owns_lock())
+            {
+                return;
+            }
+            for (auto& object : objects)
+            {
+                batch.push_back(std::move(object));
+            }
+            objects.clear();
+        }
+
+    private:
+        std::mutex mutex;
+        std::vector<retired_object> objects;
+    };
+
+    struct Batch
+    {
+        Batch()
+        {
+            objects.reserve(Policy::threshold());
+        }
+
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+        ~Batch()
+        {
+            batchDestroyed = true;
+            orphans().add(objects);
+        }
+
+        std::vector<retired_object> objects;
+        // Objects under examination by `collect`, kept to reuse the memory
+        std::vector<retired_object> examined;
+        std::size_t nextCollect = Policy::threshold();
+        bool collecting = false;
+    };
+
+    inline static thread_local bool batchDestroyed = false;
+
+    static Orphans& orphans()
+    {
+        // Never destroyed: threads may exit during static destruction
+        static Orphans* const instance = new Orphans();
+        return *instance;
+    }
+
+    static Batch* localBatch()
+    {
+        if (batchDestroyed)
+        {
+            return nullptr;
+        }
+        thread_local Batch batch;
+        return &batch;
+    }
+
+    static std::size_t collect(Batch& batch)
+    {
+        // Deleters may retire objects, they are examined by the next collection
+        if (batch.collecting)
+        {
+            return batch.objects.size();
+        }
+        batch.collecting = true;
+        batch.examined.swap(batch.objects);
+        orphans().adopt(batch.examined);
+
+        std::int64_t destroyed = 0;
+        {
+            typename Policy::Scan scan;
+            for (auto& object : batch.examined)
+            {
+                if (scan.inUse(object))
+                {
+                    batch.objects.push_back(std::move(object));
+                }
+                else
+                {
+                    object.deleter();
+                    ++destroyed;
+                }
+            }
+        }
+        batch.examined.clear();
+        unreclaimedObjects().add(-destroyed);
+
+        // Objects which are still in use do not make every following retire collect again
+        batch.nextCollect = std::max(Policy::threshold(), 2 * batch.objects.size());
+        batch.collecting = false;
+        return batch.objects.size();
+    }
+};
+
+} // namespace
+
+
+void ebr::retireErased(const void* ptr, detail::reclaim_deleter&& deleter)
+{
+    Reclaimer<EbrPolicy>::retire(ptr, std::move(deleter));
+}
+
+std::size_t ebr::collect()
+{
+    return Reclaimer<EbrPolicy>::collect();
+}
+
+std::int64_t ebr::unreclaimed() noexcept
+{
+    return Reclaimer<EbrPolicy>::unreclaimedObjects().read();
+}
+
+
+hazard_pointers::holder::holder()
+{
+    HazardRecord& record = localHazardRecord();
+    for (std::size_t i = 0; i < slots_per_thread; ++i)
+    {
+        if ((record.takenMask & (1u << i)) == 0)
+        {
+            record.takenMask |= 1u << i;
+            slot = &record.slots[i];
+            return;
+        }
+    }
+    throw std::length_error("all hazard pointers of the thread are in use");
+}
+
+hazard_pointers::holder::~holder()
+{
+    slot->store(nullptr, std::memory_order_release);
+    if (HazardRecord* const record = currentHazardRecord)
+    {
+        record->takenMask &= ~(1u << (slot - record->slots));
+    }
+}
+
+void hazard_pointers::retireErased(const void* ptr, detail::reclaim_deleter&& deleter)
+{
+    Reclaimer<HazardPolicy>::retire(ptr, std::move(deleter));
+}
+
+std::size_t hazard_pointers::collect()
+{
+    return Reclaimer<HazardPolicy>::collect();
+}
+
+std::int64_t hazard_pointers::unreclaimed() noexcept
+{
+    return Reclaimer<HazardPolicy>::unreclaimedObjects().read();
+}
+
+} // namespace losync
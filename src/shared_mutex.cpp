@@ -0,0 +1,87 @@
+#include <losync/backoff.h>
+#include <losync/shared_mutex.h>
+
+#include <chrono>
+
+
+namespace losync
+{
+
+namespace
+{
+
+std::int64_t nowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+
+bool shared_mutex::try_lock()
+{
+    if (!underlying.try_lock())
+    {
+        return false;
+    }
+    if (!readBias.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    readBias.store(false, std::memory_order_seq_cst);
+    for (std::size_t i = 0; i < slotCount; ++i)
+    {
+        if (slots[i].state.load(std::memory_order_seq_cst) != Idle)
+        {
+            // Readers which saw the revocation wait for the underlying lock and will take it after us
+            readBias.store(true, std::memory_order_release);
+            underlying.unlock();
+            return false;
+        }
+    }
+    return true;
+}
+
+void shared_mutex::revokeBias()
+{
+    if (!readBias.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    const std::int64_t start = nowNs();
+    readBias.store(false, std::memory_order_seq_cst);
+    for (std::size_t i = 0; i < slotCount; ++i)
+    {
+        std::atomic<std::uint32_t>& state = slots[i].state;
+        std::uint32_t value = state.load(std::memory_order_seq_cst);
+        // Readers usually leave soon, so spin before going to sleep
+        exponential_backoff backoff;
+        while (value != Idle && backoff.spin())
+        {
+            value = state.load(std::memory_order_acquire);
+        }
+        while (value != Idle)
+        {
+            if (value == ReadingWriterWaits ||
+                state.compare_exchange_weak(value, ReadingWriterWaits, std::memory_order_acquire))
+            {
+                futex_wait(state, ReadingWriterWaits);
+            }
+            value = state.load(std::memory_order_acquire);
+        }
+    }
+    const std::int64_t end = nowNs();
+    inhibitUntil.store(end + (end - start) * InhibitMultiplier, std::memory_order_relaxed);
+}
+
+void shared_mutex::restoreBias()
+{
+    // Holding the underlying lock in shared mode excludes writers
+    if (!readBias.load(std::memory_order_relaxed) && nowNs() >= inhibitUntil.load(std::memory_order_relaxed))
+    {
+        readBias.store(true, std::memory_order_release);
+    }
+}
+
+} // namespace losync
@@ -0,0 +1,127 @@
+#include <losync/strand.h>
+
+#include <losync/backoff.h>
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+
+namespace losync
+{
+
+namespace
+{
+
+thread_local const strand* currentStrand = nullptr;
+
+} // namespace
+
+
+strand::strand(thread_pool& pool, const std::uint32_t batch) noexcept
+    : tail(&stub), head(&stub), pool(pool), batch(std::max<std::uint32_t>(batch, 1))
+{
+}
+
+strand::~strand()
+{
+    // The last turn touches nothing of the strand after it brought `pending` to zero
+    while (pending.load(std::memory_order_acquire) != 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+bool strand::running_in_this_thread() const noexcept
+{
+    return currentStrand == this;
+}
+
+strand::Message* strand::pop() noexcept
+{
+    exponential_backoff backoff;
+    for (;;)
+    {
+        Link* first = head;
+        Link* next = first->next.load(std::memory_order_acquire);
+        if (first == &stub)
+        {
+            if (next == nullptr)
+            {
+                // A producer swapped the tail but has not linked its node yet
+                if (!backoff.spin())
+                {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+            head = first = next;
+            next = first->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr)
+        {
+            head = next;
+            return static_cast<Message*>(first);
+        }
+        // `first` is the last linked node: put the stub behind it, so it can be taken without losing the tail
+        if (tail.load(std::memory_order_acquire) == first)
+        {
+            stub.next.store(nullptr, std::memory_order_relaxed);
+            Link* const previous = tail.exchange(&stub, std::memory_order_acq_rel);
+            previous->next.store(&stub, std::memory_order_release);
+            continue;
+        }
+        if (!backoff.spin())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void strand::runTurn() noexcept
+{
+    for (;;)
+    {
+        const strand* const outer = std::exchange(currentStrand, this);
+        const std::uint32_t count = std::min(pending.load(std::memory_order_acquire), batch);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            Message* const node = pop();
+            node->func();
+            node->~Message();
+            pool_allocator::deallocate(node, sizeof(Message));
+        }
+        currentStrand = outer;
+        if (pending.fetch_sub(count, std::memory_order_acq_rel) == count)
+        {
+            return;
+        }
+        // Messages posted meanwhile were not submitted, the strand continues them after the other tasks
+        try
+        {
+            pool.defer([this]() { runTurn(); });
+            return;
+        }
+        catch (...)
+        {
+            // The pool could not take the strand, so this thread keeps running it
+        }
+    }
+}
+
+void strand::cancelFirst(Message* const message) noexcept
+{
+    // `pending` was zero before the message, so it is the first one of the mailbox
+    Message* const node = pop();
+    assert(node == message);
+    (void)message;
+    node->~Message();
+    pool_allocator::deallocate(node, sizeof(Message));
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        // Messages posted meanwhile were not submitted, they rely on the turn which failed
+        runTurn();
+    }
+}
+
+} // namespace losync
@@ -0,0 +1,260 @@
+#include <losync/thread_pool.h>
+
+
+namespace losync
+{
+
+namespace
+{
+
+// Rounds of looking for work before a worker goes to sleep
+constexpr int SpinRounds = 64;
+
+struct CurrentWorker
+{
+    const thread_pool* pool = nullptr;
+    void* worker = nullptr;
+};
+
+thread_local CurrentWorker currentWorkerOfThread;
+
+std::uint32_t nextRandom(std::uint32_t& state) noexcept
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+} // namespace
+
+
+thread_pool::thread_pool(std::size_t threads)
+{
+    threads = std::max<std::size_t>(threads, 1);
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->random = static_cast<std::uint32_t>(i) * 2654435761u + 1;
+    }
+    // Workers steal from each other, so all of them should exist before any thread starts
+    for (auto& worker : workers)
+    {
+        worker->thread = std::thread([this, &worker = *worker]() { workerLoop(worker); });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    stopping.store(true, std::memory_order_seq_cst);
+    wakeEpoch.fetch_add(1, std::memory_order_release);
+    futex_wake_all(wakeEpoch);
+    for (auto& worker : workers)
+    {
+        worker->thread.join();
+    }
+}
+
+bool thread_pool::run_pending_task()
+{
+    std::optional<task> found = findTask(currentWorker());
+    if (!found)
+    {
+        return false;
+    }
+    (*found)();
+    return true;
+}
+
+void thread_pool::join(join_counter& remaining) noexcept
+{
+    while (!remaining.finished())
+    {
+        if (!run_pending_task())
+        {
+            remaining.wait();
+        }
+    }
+}
+
+void thread_pool::enqueue(task&& value)
+{
+    Worker* const self = currentWorker();
+    if (self == nullptr || !self->deque.push(std::move(value)))
+    {
+        injection.push(std::move(value));
+    }
+}
+
+void thread_pool::notify(const std::size_t count) noexcept
+{
+    if (count == 0)
+    {
+        return;
+    }
+    // Pairs with the fence in park(): either the sleeper sees the new task or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::uint32_t sleeping = sleepers.load(std::memory_order_relaxed);
+    if (sleeping == 0)
+    {
+        return;
+    }
+    wakeEpoch.fetch_add(1, std::memory_order_release);
+    if (count >= sleeping)
+    {
+        futex_wake_all(wakeEpoch);
+        return;
+    }
+    // Less tasks than sleepers: wake only as many workers as there are tasks
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        futex_wake_one(wakeEpoch);
+    }
+}
+
+void thread_pool::workerLoop(Worker& self)
+{
+    currentWorkerOfThread = {this, &self};
+    int idleRounds = 0;
+    for (;;)
+    {
+        if (std::optional<task> found = findTask(&self))
+        {
+            (*found)();
+            idleRounds = 0;
+            continue;
+        }
+        if (stopping.load(std::memory_order_acquire) && !hasWork())
+        {
+            break;
+        }
+        if (++idleRounds < SpinRounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        park();
+        idleRounds = 0;
+    }
+    currentWorkerOfThread = {};
+}
+
+std::optional<thread_pool::task> thread_pool::findTask(Worker* self)
+{
+    if (self != nullptr)
+    {
+        if (std::optional<task> found = self->deque.pop())
+        {
+            return found;
+        }
+    }
+    if (std::optional<task> found = takeInjected(self))
+    {
+        return found;
+    }
+    return steal(self);
+}
+
+std::optional<thread_pool::task> thread_pool::takeInjected(Worker* self)
+{
+    if (!injection.has_pushed() && !injectionLeftover.load(std::memory_order_acquire))
+    {
+        return std::nullopt;
+    }
+    if (injectionBusy.exchange(true, std::memory_order_acquire))
+    {
+        return std::nullopt;
+    }
+
+    // Keep the first task to run and move a batch of the others into the own deque where they may be stolen
+    std::optional<task> first;
+    std::size_t moved = 0;
+    const std::size_t batch = self != nullptr ? self->deque.capacity() - self->deque.size() : 0;
+    injection.drain(
+        [this, &first, &moved, self](task& value) {
+            if (!first)
+            {
+                first.emplace(std::move(value));
+            }
+            else if (self->deque.push(std::move(value)))
+            {
+                ++moved;
+            }
+            else
+            {
+                injection.push(std::move(value));
+            }
+        },
+        batch + 1);
+    injectionLeftover.store(!injection.empty(), std::memory_order_release);
+    injectionBusy.store(false, std::memory_order_release);
+    // This worker runs the first task, the moved ones should be stolen by the sleeping workers
+    notify(moved);
+    return first;
+}
+
+std::optional<thread_pool::task> thread_pool::steal(Worker* self)
+{
+    std::uint32_t seed = self != nullptr ? self->random : static_cast<std::uint32_t>(
+                                                              reinterpret_cast<std::uintptr_t>(&seed) >> 4) | 1;
+    const std::size_t count = workers.size();
+    const std::size_t start = nextRandom(seed) % count;
+    if (self != nullptr)
+    {
+        self->random = seed;
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Worker& victim = *workers[(start + i) % count];
+        if (&victim == self)
+        {
+            continue;
+        }
+        if (std::optional<task> found = victim.deque.steal())
+        {
+            return found;
+        }
+    }
+    return std::nullopt;
+}
+
+bool thread_pool::hasWork() const noexcept
+{
+    if (injection.has_pushed() || injectionLeftover.load(std::memory_order_acquire))
+    {
+        return true;
+    }
+    for (const auto& worker : workers)
+    {
+        if (worker->deque.size() != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void thread_pool::park() noexcept
+{
+    sleepers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::uint32_t epoch = wakeEpoch.load(std::memory_order_acquire);
+    if (!hasWork() && !stopping.load(std::memory_order_acquire))
+    {
+        futex_wait(wakeEpoch, epoch);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+thread_pool::Worker* thread_pool::currentWorker() const noexcept
+{
+    if (currentWorkerOfThread.pool != this)
+    {
+        return nullptr;
+    }
+    return static_cast<Worker*>(currentWorkerOfThread.worker);
+}
+
+} // namespace losync
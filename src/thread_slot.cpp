@@ -0,0 +1,102 @@
+#include <losync/thread_slot.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+
+namespace losync
+{
+
+namespace
+{
+
+class SlotRegistry
+{
+public:
+    std::size_t acquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeSlots.empty())
+        {
+            const std::size_t slot = freeSlots.top();
+            freeSlots.pop();
+            return slot;
+        }
+        const std::size_t slot = nextSlot++;
+        highWater.store(nextSlot, std::memory_order_release);
+        return slot;
+    }
+
+    void release(const std::size_t slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push(slot);
+    }
+
+    std::size_t high_water() const
+    {
+        return highWater.load(std::memory_order_acquire);
+    }
+
+private:
+    std::mutex mutex;
+    std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<std::size_t>> freeSlots;
+    std::size_t nextSlot = 0;
+    std::atomic<std::size_t> highWater{0};
+};
+
+SlotRegistry& registry()
+{
+    // Never destroyed: threads may exit during static destruction
+    static SlotRegistry* const instance = new SlotRegistry();
+    return *instance;
+}
+
+
+// Releases the slot of the thread when it exits
+class SlotOwner
+{
+public:
+    explicit SlotOwner(const std::size_t slot) : slot(slot)
+    {
+    }
+
+    SlotOwner(const SlotOwner&) = delete;
+    SlotOwner& operator=(const SlotOwner&) = delete;
+
+    ~SlotOwner()
+    {
+        detail::currentThreadSlot = detail::no_thread_slot;
+        ownerDestroyed = true;
+        registry().release(slot);
+    }
+
+    inline static thread_local bool ownerDestroyed = false;
+
+private:
+    const std::size_t slot;
+};
+
+} // namespace
+
+
+std::size_t thread_slot::acquire() noexcept
+{
+    const std::size_t slot = registry().acquire();
+    if (!SlotOwner::ownerDestroyed)
+    {
+        thread_local SlotOwner owner(slot);
+    }
+    detail::currentThreadSlot = slot;
+    return slot;
+}
+
+std::size_t thread_slot::high_water() noexcept
+{
+    return registry().high_water();
+}
+
+} // namespace losync
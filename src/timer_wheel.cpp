@@ -0,0 +1,354 @@
+#include <losync/timer_wheel.h>
+
+#include <losync/futex.h>
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+
+namespace losync
+{
+
+namespace
+{
+
+constexpr std::uint64_t NoTick = std::numeric_limits<std::uint64_t>::max();
+
+std::uint32_t floorLog2(const std::uint64_t value) noexcept
+{
+#if defined(__GNUC__)
+    return 63 - static_cast<std::uint32_t>(__builtin_clzll(value));
+#else
+    std::uint32_t result = 0;
+    for (std::uint64_t rest = value >> 1; rest != 0; rest >>= 1)
+    {
+        ++result;
+    }
+    return result;
+#endif
+}
+
+std::uint32_t countTrailingZeros(const std::uint64_t value) noexcept
+{
+#if defined(__GNUC__)
+    return static_cast<std::uint32_t>(__builtin_ctzll(value));
+#else
+    std::uint32_t result = 0;
+    while ((value & (std::uint64_t{1} << result)) == 0)
+    {
+        ++result;
+    }
+    return result;
+#endif
+}
+
+} // namespace
+
+
+timer_wheel::timer_wheel(const clock::duration resolution, const clock::time_point start)
+    : tickLength(std::max(resolution, clock::duration(1))), start(start)
+{
+}
+
+timer_wheel::~timer_wheel()
+{
+    for (Link& slot : slots)
+    {
+        for (Link* link = slot.next; link != &slot; link = link->next)
+        {
+            static_cast<Node*>(link)->func()->~callback();
+        }
+    }
+}
+
+bool timer_wheel::cancel(const timer_id id) noexcept
+{
+    const std::uint32_t index = static_cast<std::uint32_t>(id);
+    if (index >= nodeCount)
+    {
+        return false;
+    }
+    Node* const node = nodeAt(index);
+    if (node->generation != static_cast<std::uint32_t>(id >> 32))
+    {
+        return false;
+    }
+    unlink(node);
+    node->func()->~callback();
+    releaseNode(node);
+    --pending;
+    return true;
+}
+
+std::optional<timer_wheel::clock::time_point> timer_wheel::next_deadline() const noexcept
+{
+    const std::uint64_t tick = nextEventTick();
+    if (tick == NoTick)
+    {
+        return std::nullopt;
+    }
+    return start + tickLength * static_cast<clock::rep>(tick);
+}
+
+std::uint64_t timer_wheel::floorTick(const clock::time_point time) const noexcept
+{
+    return time <= start ? 0 : static_cast<std::uint64_t>((time - start) / tickLength);
+}
+
+std::uint64_t timer_wheel::ceilTick(const clock::time_point time) const noexcept
+{
+    const std::uint64_t tick = floorTick(time);
+    return start + tickLength * static_cast<clock::rep>(tick) < time ? tick + 1 : tick;
+}
+
+timer_wheel::timer_id timer_wheel::idOf(const Node* const node) const noexcept
+{
+    return (static_cast<timer_id>(node->generation) << 32) | node->index;
+}
+
+timer_wheel::Node* timer_wheel::acquireNode()
+{
+    if (freeNodes == nullptr)
+    {
+        const std::uint32_t size = FirstSegmentSize << segments.size();
+        segments.emplace_back(new Node[size]);
+        Node* const nodes = segments.back().get();
+        for (std::uint32_t i = 0; i < size; ++i)
+        {
+            nodes[i].index = nodeCount + i;
+            nodes[i].next = i + 1 < size ? &nodes[i + 1] : nullptr;
+        }
+        nodeCount += size;
+        freeNodes = nodes;
+    }
+    Node* const node = freeNodes;
+    freeNodes = static_cast<Node*>(node->next);
+    return node;
+}
+
+void timer_wheel::releaseNode(Node* const node) noexcept
+{
+    // Stale ids stop matching the node, 0 is skipped so that no id equals `invalid_timer`
+    if (++node->generation == 0)
+    {
+        node->generation = 1;
+    }
+    node->position = NoPosition;
+    node->next = freeNodes;
+    freeNodes = node;
+}
+
+timer_wheel::Node* timer_wheel::nodeAt(const std::uint32_t index) const noexcept
+{
+    // Segment `i` starts at index `FirstSegmentSize * (2^i - 1)`
+    const std::uint32_t segment = floorLog2(index / FirstSegmentSize + 1);
+    const std::uint32_t first = FirstSegmentSize * ((1u << segment) - 1);
+    return &segments[segment][index - first];
+}
+
+// A timer goes to the lowest level whose slot range contains both the current tick and the deadline,
+// into the slot of the deadline. So the slot is reached after the current tick and not after the deadline.
+void timer_wheel::insert(Node* const node) noexcept
+{
+    const std::uint64_t deadline = std::max(node->deadline, current);
+    const std::uint64_t difference = deadline ^ current;
+    const std::size_t level = difference == 0 ? 0 : floorLog2(difference) / LevelBits;
+    if (level >= levels)
+    {
+        node->position = OverflowPosition;
+    }
+    else
+    {
+        const std::size_t slot = (deadline >> (level * LevelBits)) & (slots_per_level - 1);
+        node->position = static_cast<std::uint32_t>(level * slots_per_level + slot);
+        occupied[level][slot / 64] |= std::uint64_t{1} << (slot % 64);
+    }
+    Link& list = slots[node->position];
+    node->prev = list.prev;
+    node->next = &list;
+    list.prev->next = node;
+    list.prev = node;
+}
+
+void timer_wheel::unlink(Node* const node) noexcept
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    if (node->position < OverflowPosition && slots[node->position].next == &slots[node->position])
+    {
+        const std::size_t level = node->position / slots_per_level;
+        const std::size_t slot = node->position % slots_per_level;
+        occupied[level][slot / 64] &= ~(std::uint64_t{1} << (slot % 64));
+    }
+    node->position = NoPosition;
+}
+
+void timer_wheel::takeSlot(const std::uint32_t position, Link& list) noexcept
+{
+    Link& slot = slots[position];
+    if (slot.next == &slot)
+    {
+        return;
+    }
+    list.next = slot.next;
+    list.prev = slot.prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    slot.next = slot.prev = &slot;
+    for (Link* link = list.next; link != &list; link = link->next)
+    {
+        static_cast<Node*>(link)->position = NoPosition;
+    }
+    if (position < OverflowPosition)
+    {
+        const std::size_t slot = position % slots_per_level;
+        occupied[position / slots_per_level][slot / 64] &= ~(std::uint64_t{1} << (slot % 64));
+    }
+}
+
+void timer_wheel::requeue(Link& list) noexcept
+{
+    while (list.next != &list)
+    {
+        Node* const node = static_cast<Node*>(list.next);
+        unlink(node);
+        insert(node);
+    }
+}
+
+std::uint64_t timer_wheel::nextEventTick() const noexcept
+{
+    std::uint64_t result = NoTick;
+    for (std::size_t level = 0; level < levels; ++level)
+    {
+        const std::size_t shift = level * LevelBits;
+        // The slot of the current tick is still due if the current tick starts it, that is always on level 0.
+        // Otherwise the slot was processed and timers are inserted only into later slots of higher levels.
+        const bool unprocessed = (current & ((std::uint64_t{1} << shift) - 1)) == 0;
+        const std::size_t first = ((current >> shift) & (slots_per_level - 1)) + (unprocessed ? 0 : 1);
+        for (std::size_t word = first / 64; word < BitmapWords; ++word)
+        {
+            std::uint64_t bits = occupied[level][word];
+            if (word == first / 64)
+            {
+                bits &= ~std::uint64_t{0} << (first % 64);
+            }
+            if (bits != 0)
+            {
+                const std::uint64_t slot = word * 64 + countTrailingZeros(bits);
+                const std::uint64_t blockStart = (current >> (shift + LevelBits)) << (shift + LevelBits);
+                result = std::min(result, blockStart + (slot << shift));
+                break;
+            }
+        }
+    }
+    if (slots[OverflowPosition].next != &slots[OverflowPosition])
+    {
+        const std::size_t shift = levels * LevelBits;
+        const bool unprocessed = (current & ((std::uint64_t{1} << shift) - 1)) == 0;
+        result = std::min(result, unprocessed ? current : ((current >> shift) + 1) << shift);
+    }
+    return result;
+}
+
+void timer_wheel::beginTick(const std::uint64_t tick, Link& expired) noexcept
+{
+    current = tick;
+    // Higher levels first, so their timers can move down through several levels at once
+    if ((tick & ((std::uint64_t{1} << (levels * LevelBits)) - 1)) == 0)
+    {
+        Link due;
+        takeSlot(OverflowPosition, due);
+        requeue(due);
+    }
+    for (std::size_t level = levels - 1; level > 0; --level)
+    {
+        const std::size_t shift = level * LevelBits;
+        if ((tick & ((std::uint64_t{1} << shift) - 1)) == 0)
+        {
+            Link due;
+            takeSlot(static_cast<std::uint32_t>(level * slots_per_level + ((tick >> shift) & (slots_per_level - 1))),
+                     due);
+            requeue(due);
+        }
+    }
+    takeSlot(static_cast<std::uint32_t>(tick & (slots_per_level - 1)), expired);
+    // Timers scheduled by the callbacks for this tick or earlier fire at the next one
+    current = tick + 1;
+}
+
+
+timer_thread::timer_thread(const clock::duration resolution) : wheel(resolution)
+{
+    thread = std::thread([this]() { loop(); });
+}
+
+timer_thread::~timer_thread()
+{
+    {
+        std::lock_guard<losync::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake();
+    thread.join();
+}
+
+bool timer_thread::cancel(const timer_id id)
+{
+    std::lock_guard<losync::mutex> lock(mutex);
+    return wheel.cancel(id);
+}
+
+std::size_t timer_thread::size()
+{
+    std::lock_guard<losync::mutex> lock(mutex);
+    return wheel.size();
+}
+
+void timer_thread::wake() noexcept
+{
+    wakeEpoch.fetch_add(1, std::memory_order_release);
+    futex_wake_one(wakeEpoch);
+}
+
+void timer_thread::loop()
+{
+    std::vector<callback> expired;
+    for (;;)
+    {
+        // Read before the wheel, so a timer scheduled after the check below changes the epoch and cancels the sleep
+        const std::uint32_t epoch = wakeEpoch.load(std::memory_order_acquire);
+        clock::time_point next;
+        {
+            std::lock_guard<losync::mutex> lock(mutex);
+            if (stopping)
+            {
+                return;
+            }
+            wheel.advance(clock::now(), [&expired](callback& func) { expired.push_back(std::move(func)); });
+            next = wheel.next_deadline().value_or(clock::time_point::max());
+            wakeAt = next;
+        }
+        if (!expired.empty())
+        {
+            // An exception terminates the program, see the comment of the class
+            for (callback& func : expired)
+            {
+                func();
+            }
+            expired.clear();
+            continue;
+        }
+        if (next == clock::time_point::max())
+        {
+            futex_wait(wakeEpoch, epoch);
+        }
+        else
+        {
+            futex_wait_for(wakeEpoch, epoch, next - clock::now());
+        }
+    }
+}
+
+} // namespace losync
@@ -0,0 +1,84 @@
+#include <losync/barrier.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(Barrier, SeparatesPhases)
+{
+    constexpr int Threads = 5;
+    constexpr int Phases = 2000;
+    barrier sync(Threads);
+    std::vector<int> progress(Threads, 0);
+    std::atomic<int> serial{0};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (int phase = 1; phase <= Phases; ++phase)
+            {
+                progress[t] = phase;
+                if (sync.arrive_and_wait())
+                {
+                    ++serial;
+                }
+                for (const int other : progress)
+                {
+                    if (other < phase)
+                    {
+                        ++errors;
+                    }
+                }
+                // Nobody writes the next phase before everybody checked this one
+                sync.arrive_and_wait();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(errors.load(), 0);
+    // One thread completes every phase
+    EXPECT_EQ(serial.load(), Phases);
+}
+
+TEST(Barrier, DroppedThreadsAreNotExpected)
+{
+    constexpr int Threads = 4;
+    barrier sync(Threads);
+    std::atomic<int> rounds{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            // Thread t takes part in t + 1 phases
+            for (int phase = 0; phase < t; ++phase)
+            {
+                sync.arrive_and_wait();
+                ++rounds;
+            }
+            if (t + 1 < Threads)
+            {
+                sync.arrive_and_drop();
+            }
+            else
+            {
+                sync.arrive_and_wait();
+                ++rounds;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(rounds.load(), 0 + 1 + 2 + 4);
+}
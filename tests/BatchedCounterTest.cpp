@@ -0,0 +1,112 @@
+#include <losync/batched_counter.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(BatchedCounter, ExactAndApproximateReads)
+{
+    batched_counter counter(4, 2);
+    EXPECT_EQ(counter.max_error(), 6u);
+
+    counter.add();
+    counter.add(10);
+    counter.local().add(-2);
+    EXPECT_EQ(counter.read(), 9);
+    // Three additions are below the flush period
+    EXPECT_EQ(counter.read_approximate(), 0);
+
+    counter.add(5);
+    EXPECT_EQ(counter.read(), 14);
+    EXPECT_EQ(counter.read_approximate(), 14);
+
+    counter.add();
+    counter.flush();
+    EXPECT_EQ(counter.read_approximate(), 15);
+
+    counter.reset();
+    EXPECT_EQ(counter.read(), 0);
+    EXPECT_EQ(counter.read_approximate(), 0);
+    counter.add(3);
+    counter.flush();
+    EXPECT_EQ(counter.read(), 3);
+    EXPECT_EQ(counter.read_approximate(), 3);
+}
+
+TEST(BatchedCounter, ConcurrentAddsWithinError)
+{
+    constexpr int Threads = 8;
+    constexpr int PerThread = 100001;
+    batched_counter counter(64);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Threads; ++i)
+    {
+        threads.emplace_back([&counter]() {
+            auto shard = counter.local();
+            for (int j = 0; j < PerThread; ++j)
+            {
+                if (j % 2 == 0)
+                    counter.add();
+                else
+                    shard.add();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Additions of exited threads stay in the cells of their slots. 100001 is not a multiple of the period,
+    // so some of them are not published.
+    EXPECT_EQ(counter.read(), Threads * PerThread);
+    EXPECT_GE(counter.read_approximate() + static_cast<std::int64_t>(counter.max_error()), Threads * PerThread);
+    EXPECT_LT(counter.read_approximate(), Threads * PerThread);
+}
+
+TEST(BatchedCounter, ThreadsWithoutCellsAreCounted)
+{
+    batched_counter counter(16, 0);
+    std::thread([&counter]() {
+        for (int i = 0; i < 100; ++i)
+        {
+            counter.add();
+        }
+        counter.local().add(5);
+    }).join();
+    EXPECT_EQ(counter.read(), 105);
+    EXPECT_EQ(counter.read_approximate(), 105);
+    EXPECT_EQ(counter.max_error(), 0u);
+}
+
+TEST(BatchedCounter, RegistryExportsCountersByName)
+{
+    batched_counter_registry registry(1);
+    batched_counter& requests = registry.counter("requests");
+    EXPECT_EQ(&registry.counter("requests"), &requests);
+    requests.add(3);
+    registry.counter("errors").add();
+    registry.counter("bytes");
+    EXPECT_EQ(registry.size(), 3u);
+
+    const std::vector<batched_counter_registry::entry> exact = registry.snapshot();
+    ASSERT_EQ(exact.size(), 3u);
+    EXPECT_EQ(exact[0].name, "bytes");
+    EXPECT_EQ(exact[0].value, 0);
+    EXPECT_EQ(exact[1].name, "errors");
+    EXPECT_EQ(exact[1].value, 1);
+    EXPECT_EQ(exact[2].name, "requests");
+    EXPECT_EQ(exact[2].value, 3);
+
+    // Every addition is flushed with a period of one
+    const std::vector<batched_counter_registry::entry> approximate = registry.snapshot_approximate();
+    ASSERT_EQ(approximate.size(), 3u);
+    EXPECT_EQ(approximate[2].value, 3);
+}
@@ -0,0 +1,209 @@
+#include <losync/callback_list.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(CallbackList, DispatchesInOrderOfSubscription)
+{
+    callback_list<void(int, std::string&)> list;
+    EXPECT_TRUE(list.empty());
+    list.subscribe([](const int value, std::string& out) { out += "a" + std::to_string(value); });
+    const auto second = list.subscribe([](int, std::string& out) { out += "b"; });
+    // Different sizes and alignments are packed together
+    struct alignas(16) Wide
+    {
+        double values[3] = {1, 2, 3};
+    };
+    list.subscribe([wide = Wide(), owned = std::make_unique<char>('c')](int, std::string& out) {
+        out += *owned;
+        out += std::to_string(static_cast<int>(wide.values[2]));
+    });
+    EXPECT_EQ(list.size(), 3u);
+
+    std::string out;
+    list(1, out);
+    EXPECT_EQ(out, "a1bc3");
+
+    EXPECT_TRUE(list.unsubscribe(second));
+    EXPECT_FALSE(list.unsubscribe(second));
+    EXPECT_FALSE(list.unsubscribe(callback_list<void(int, std::string&)>::invalid_subscription));
+    out.clear();
+    list(2, out);
+    EXPECT_EQ(out, "a2c3");
+    EXPECT_EQ(list.size(), 2u);
+}
+
+TEST(CallbackList, CompactionKeepsOrderAndDestroysDead)
+{
+    callback_list<void(std::vector<int>&)> list;
+    auto alive = std::make_shared<int>(0);
+    std::vector<callback_list<void(std::vector<int>&)>::subscription> ids;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ids.push_back(list.subscribe([i, alive](std::vector<int>& out) { out.push_back(i); }));
+    }
+    EXPECT_EQ(alive.use_count(), 1001);
+    const std::size_t full = list.memory_usage();
+
+    // Unsubscribing most callables compacts the list on the way
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i % 10 != 0)
+        {
+            EXPECT_TRUE(list.unsubscribe(ids[i]));
+        }
+    }
+    EXPECT_TRUE(list.compact());
+    EXPECT_EQ(alive.use_count(), 101);
+    EXPECT_LT(list.memory_usage(), full / 5);
+
+    std::vector<int> out;
+    list(out);
+    ASSERT_EQ(out.size(), 100u);
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(out[i], i * 10);
+    }
+    // Ids stay valid across compaction
+    EXPECT_TRUE(list.unsubscribe(ids[500]));
+    EXPECT_FALSE(list.unsubscribe(ids[501]));
+}
+
+TEST(CallbackList, CallablesChangeTheListDuringDispatch)
+{
+    callback_list<void()> list;
+    int calls = 0;
+    callback_list<void()>::subscription self = callback_list<void()>::invalid_subscription;
+    self = list.subscribe([&]() {
+        ++calls;
+        // Compaction is skipped while the dispatch runs, so this callable is not moved
+        EXPECT_TRUE(list.unsubscribe(self));
+        EXPECT_FALSE(list.compact());
+        list.subscribe([&calls]() { calls += 10; });
+    });
+    list();
+    list();
+    EXPECT_GE(calls, 11);
+    EXPECT_TRUE(list.compact());
+    calls = 0;
+    list();
+    EXPECT_EQ(calls, 10);
+}
+
+TEST(CallbackList, LastDispatchCompacts)
+{
+    callback_list<void()> list;
+    auto alive = std::make_shared<int>(0);
+    std::vector<callback_list<void()>::subscription> ids;
+    for (int i = 0; i < 100; ++i)
+    {
+        ids.push_back(list.subscribe([alive]() {}));
+    }
+    list.subscribe([&]() {
+        // The dispatch is running, so the compaction is left to it
+        for (const auto id : ids)
+        {
+            EXPECT_TRUE(list.unsubscribe(id));
+        }
+        ids.clear();
+    });
+    const std::size_t full = list.memory_usage();
+    list();
+    EXPECT_EQ(alive.use_count(), 1);
+    EXPECT_LT(list.memory_usage(), full / 10);
+}
+
+TEST(CallbackList, UnsubscribeWaitsForRunningDispatches)
+{
+    callback_list<void()> list;
+    std::atomic<int> calls{0};
+    std::atomic<bool> release{false};
+    const auto id = list.subscribe([&]() {
+        if (calls.fetch_add(1) == 0)
+        {
+            while (!release.load())
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread dispatcher([&]() { list(); });
+    while (calls.load() == 0)
+    {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> unsubscribed{false};
+    std::thread unsubscriber([&]() {
+        EXPECT_TRUE(list.unsubscribe(id));
+        unsubscribed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(unsubscribed.load());
+    // Dispatches which start later do not wait for the unsubscription
+    list();
+    release = true;
+    unsubscriber.join();
+    EXPECT_TRUE(unsubscribed.load());
+    const int finalCalls = calls.load();
+    list();
+    EXPECT_EQ(calls.load(), finalCalls);
+    dispatcher.join();
+}
+
+TEST(CallbackList, ConcurrentDispatchAndChanges)
+{
+    callback_list<void(std::atomic<long long>&)> list;
+    std::atomic<bool> stop{false};
+    std::atomic<long long> sum{0};
+    // Permanent callables: every dispatch calls all of them
+    for (int i = 0; i < 10; ++i)
+    {
+        list.subscribe([](std::atomic<long long>& total) { total.fetch_add(1, std::memory_order_relaxed); });
+    }
+
+    std::vector<std::thread> dispatchers;
+    for (int t = 0; t < 3; ++t)
+    {
+        dispatchers.emplace_back([&]() {
+            while (!stop.load())
+            {
+                std::atomic<long long> total{0};
+                list(total);
+                if (total.load() < 10)
+                {
+                    sum = -1000000;
+                }
+                // Unsubscriptions wait for running dispatches, which must not hog a single processor
+                std::this_thread::yield();
+            }
+        });
+    }
+    std::thread writer([&]() {
+        for (int i = 0; i < 20000; ++i)
+        {
+            const auto id = list.subscribe([payload = std::make_unique<int>(i)](std::atomic<long long>& total) {
+                total.fetch_add(*payload >= 0 ? 0 : 1, std::memory_order_relaxed);
+            });
+            list.unsubscribe(id);
+        }
+        stop = true;
+    });
+    writer.join();
+    for (auto& dispatcher : dispatchers)
+    {
+        dispatcher.join();
+    }
+    EXPECT_EQ(sum.load(), 0);
+    EXPECT_EQ(list.size(), 10u);
+}
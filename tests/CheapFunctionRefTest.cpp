@@ -0,0 +1,72 @@
+#include <losync/cheap_function.h>
+#include <losync/cheap_function_ref.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <type_traits>
+
+
+using namespace losync;
+
+
+namespace
+{
+
+int callTwice(cheap_function_ref<int(int)> func, int value)
+{
+    return func(func(value));
+}
+
+int addOne(int value)
+{
+    return value + 1;
+}
+
+} // namespace
+
+
+TEST(CheapFunctionRef, IsTwoPointers)
+{
+    static_assert(sizeof(cheap_function_ref<int(int)>) == 2 * sizeof(void*));
+    static_assert(std::is_trivially_copyable<cheap_function_ref<int(int)>>::value);
+}
+
+TEST(CheapFunctionRef, ConstAndMutableCallables)
+{
+    const int delta = 3;
+    const auto constLambda = [delta](int value) { return value + delta; };
+    EXPECT_EQ(callTwice(constLambda, 1), 7);
+
+    int calls = 0;
+    auto mutableLambda = [calls](int value) mutable { return value + ++calls; };
+    EXPECT_EQ(callTwice(mutableLambda, 0), 3);
+    EXPECT_EQ(callTwice(mutableLambda, 0), 7);
+
+    EXPECT_EQ(callTwice(addOne, 1), 3);
+    EXPECT_EQ(callTwice(&addOne, 1), 3);
+}
+
+TEST(CheapFunctionRef, BindsToCheapFunctionWithoutMove)
+{
+    auto ptr = std::make_unique<int>(10);
+    cheap_function<int(int)> owner([ptr = std::move(ptr)](int value) { return *ptr + value; });
+
+    EXPECT_EQ(callTwice(owner, 1), 21);
+    EXPECT_TRUE(owner);
+
+    cheap_function_ref<int(int)> ref = owner;
+    cheap_function_ref<int(int)> copy = ref;
+    owner = [](int value) { return -value; };
+    EXPECT_EQ(copy(5), -5);
+}
+
+TEST(CheapFunctionRef, VoidResultDiscardsValue)
+{
+    int value = 0;
+    auto lambda = [&value]() { return ++value; };
+    cheap_function_ref<void()> ref = lambda;
+    ref();
+    ref();
+    EXPECT_EQ(value, 2);
+}
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <type_traits>
 
 
 using namespace losync;
@@ -44,3 +45,205 @@ TEST(CheapFunction, CanHandleMoveOnlyLambda)
     cheap_function<int()> func2(std::move(func));
     EXPECT_EQ(func2(), 123);
 }
+
+TEST(CheapFunction, CapacityDefinesObjectSize)
+{
+    static_assert(sizeof(cheap_function<void()>) == cheap_function_default_capacity);
+    static_assert(sizeof(cheap_function_32<void()>) == 32);
+    static_assert(sizeof(cheap_function_64<void()>) == 64);
+    static_assert(sizeof(cheap_function_128<void()>) == 128);
+    static_assert(sizeof(cheap_function<void(), 48, 8>) == 48);
+    static_assert(alignof(cheap_function<void(), 64, 64>) == 64);
+
+    int value = 10;
+    auto functor = [&value](int delta) { return value + delta; };
+    static_assert(cheap_function_32<int(int)>::fits<decltype(functor)>);
+
+    cheap_function_32<int(int)> func(std::move(functor));
+    cheap_function_32<int(int)> func2(std::move(func));
+    EXPECT_EQ(func2(5), 15);
+}
+
+TEST(CheapFunction, RequiredCapacity)
+{
+    struct Captures
+    {
+        char data[100];
+        void operator()() const
+        {
+        }
+    };
+
+    static_assert(cheap_function_capacity_v<Captures> == 112);
+    static_assert(cheap_function_capacity_v<Captures, 8> == 112);
+    static_assert(cheap_function_capacity_v<Captures, 64> == 128);
+    static_assert(!cheap_function_64<void()>::fits<Captures>);
+    static_assert(cheap_function_128<void()>::fits<Captures>);
+    static_assert(cheap_function<void(), 112>::required_capacity<Captures> == 112);
+
+    cheap_function<void(), cheap_function_capacity_v<Captures>> func(Captures{});
+    func();
+}
+
+TEST(CheapFunction, MoveLeavesSourceEmpty)
+{
+    cheap_function<int()> func([]() { return 7; });
+    EXPECT_TRUE(func);
+
+    cheap_function<int()> func2(std::move(func));
+    EXPECT_FALSE(func);
+    EXPECT_TRUE(func2);
+    EXPECT_EQ(func2(), 7);
+    EXPECT_THROW(func(), std::bad_function_call);
+
+    func = std::move(func2);
+    EXPECT_TRUE(func);
+    EXPECT_FALSE(func2);
+    EXPECT_EQ(func(), 7);
+}
+
+namespace
+{
+
+template <std::size_t Size>
+struct Bytes
+{
+    unsigned char data[Size];
+
+    int operator()() const
+    {
+        int sum = 0;
+        for (std::size_t i = 0; i < Size; ++i)
+        {
+            sum += data[i] * static_cast<int>(i + 1);
+        }
+        return sum;
+    }
+};
+
+template <std::size_t Size>
+void checkMovedBytes()
+{
+    Bytes<Size> bytes;
+    for (std::size_t i = 0; i < Size; ++i)
+    {
+        bytes.data[i] = static_cast<unsigned char>(i * 7 + 3);
+    }
+    const int expected = bytes();
+
+    cheap_function<int(), 256> func(std::move(bytes));
+    cheap_function<int(), 256> func2(std::move(func));
+    cheap_function<int(), 256> func3(std::move(func2));
+    // The empty function is moved too
+    func = std::move(func2);
+    EXPECT_EQ(func3(), expected) << Size;
+    EXPECT_FALSE(func);
+}
+
+} // namespace
+
+TEST(CheapFunction, MovesBytesOfEverySize)
+{
+    checkMovedBytes<1>();
+    checkMovedBytes<8>();
+    checkMovedBytes<12>();
+    checkMovedBytes<16>();
+    checkMovedBytes<20>();
+    checkMovedBytes<33>();
+    checkMovedBytes<64>();
+    checkMovedBytes<68>();
+    checkMovedBytes<127>();
+    checkMovedBytes<200>();
+    checkMovedBytes<248>();
+}
+
+TEST(CheapFunction, DestroysFunctorOnce)
+{
+    struct Counted
+    {
+        explicit Counted(int& counter) : destroyed(&counter)
+        {
+        }
+        Counted(Counted&& other) noexcept : destroyed(other.destroyed)
+        {
+            other.destroyed = nullptr;
+        }
+        ~Counted()
+        {
+            if (destroyed)
+                ++*destroyed;
+        }
+        int operator()() const
+        {
+            return 1;
+        }
+
+        int* destroyed;
+    };
+    static_assert(!is_trivially_relocatable_v<Counted>);
+
+    int destroyed = 0;
+    {
+        cheap_function_32<int()> func(Counted{destroyed});
+        cheap_function_32<int()> func2(std::move(func));
+        cheap_function_32<int()> func3(std::move(func2));
+        EXPECT_EQ(func3(), 1);
+        EXPECT_EQ(destroyed, 0);
+
+        func3 = []() { return 2; };
+        EXPECT_EQ(destroyed, 1);
+        EXPECT_EQ(func3(), 2);
+    }
+    EXPECT_EQ(destroyed, 1);
+}
+
+TEST(CheapFunction, HybridStoresBigFunctorsInPool)
+{
+    struct Big
+    {
+        char data[200] = {1, 2, 3};
+        std::unique_ptr<int> ptr = std::make_unique<int>(5);
+        int operator()(int value) const
+        {
+            return data[2] + *ptr + value;
+        }
+    };
+    static_assert(sizeof(hybrid_function<int(int)>) == 64);
+    static_assert(!hybrid_function<int(int)>::fits<Big>);
+
+    hybrid_function<int(int)> func(Big{});
+    EXPECT_EQ(func(10), 18);
+
+    hybrid_function<int(int)> func2(std::move(func));
+    EXPECT_FALSE(func);
+    EXPECT_EQ(func2(1), 9);
+
+    int small = 4;
+    func2 = [small](int value) { return small * value; };
+    EXPECT_EQ(func2(2), 8);
+
+    func = Big{};
+    EXPECT_EQ(func(0), 8);
+}
+
+TEST(CheapFunction, HybridPoolsSmallFunctorsWhoseMoveMayThrow)
+{
+    // A user-declared copy constructor suppresses the move constructor, so moves copy and may throw
+    struct Copyable
+    {
+        Copyable() = default;
+        Copyable(const Copyable& other) : value(other.value)
+        {
+        }
+        int value = 3;
+    };
+    Copyable copyable;
+    auto lambda = [copyable](int value) { return copyable.value + value; };
+    static_assert(!std::is_nothrow_move_constructible<decltype(lambda)>::value);
+    static_assert(!hybrid_function<int(int)>::fits<decltype(lambda)>);
+
+    hybrid_function<int(int)> func(std::move(lambda));
+    hybrid_function<int(int)> func2(std::move(func));
+    EXPECT_FALSE(func);
+    EXPECT_EQ(func2(1), 4);
+}
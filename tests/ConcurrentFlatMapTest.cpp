@@ -0,0 +1,270 @@
+#include <losync/cheap_function.h>
+#include <losync/concurrent_flat_map.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(ConcurrentFlatMap, InsertFindErase)
+{
+    concurrent_flat_map<std::uint64_t, std::uint64_t> map(4);
+    static_assert(concurrent_flat_map<std::uint64_t, std::uint64_t>::optimistic_reads);
+    EXPECT_EQ(map.shard_count(), 4u);
+    EXPECT_FALSE(map.find(1));
+
+    EXPECT_TRUE(map.insert(1, 10));
+    EXPECT_FALSE(map.insert(1, 11));
+    EXPECT_EQ(*map.find(1), 10u);
+    EXPECT_FALSE(map.insert_or_assign(1, 12));
+    EXPECT_EQ(*map.find(1), 12u);
+    EXPECT_TRUE(map.insert_or_assign(2, 20));
+    EXPECT_EQ(map.size(), 2u);
+
+    EXPECT_TRUE(map.erase(1));
+    EXPECT_FALSE(map.erase(1));
+    EXPECT_FALSE(map.contains(1));
+    EXPECT_TRUE(map.contains(2));
+    EXPECT_EQ(map.size(), 1u);
+
+    map.clear();
+    EXPECT_EQ(map.size(), 0u);
+    EXPECT_FALSE(map.contains(2));
+}
+
+TEST(ConcurrentFlatMap, GrowsAndReusesDeletedSlots)
+{
+    concurrent_flat_map<std::uint64_t, std::uint64_t> map(1);
+    constexpr std::uint64_t Count = 10000;
+    for (std::uint64_t i = 0; i < Count; ++i)
+    {
+        ASSERT_TRUE(map.insert(i, i * 3));
+    }
+    EXPECT_EQ(map.size(), Count);
+    for (std::uint64_t i = 0; i < Count; i += 2)
+    {
+        ASSERT_TRUE(map.erase(i));
+    }
+    for (std::uint64_t round = 0; round < 10; ++round)
+    {
+        for (std::uint64_t i = 0; i < Count; i += 2)
+        {
+            ASSERT_TRUE(map.insert(i + Count * (round + 1), round));
+        }
+        for (std::uint64_t i = 0; i < Count; i += 2)
+        {
+            ASSERT_TRUE(map.erase(i + Count * (round + 1)));
+        }
+    }
+    for (std::uint64_t i = 0; i < Count; ++i)
+    {
+        ASSERT_EQ(map.contains(i), i % 2 == 1);
+    }
+
+    std::uint64_t sum = 0;
+    map.for_each([&](const std::uint64_t key, const std::uint64_t value) {
+        EXPECT_EQ(value, key * 3);
+        sum += key;
+    });
+    EXPECT_EQ(sum, Count * Count / 4);
+}
+
+TEST(ConcurrentFlatMap, MoveOnlyValues)
+{
+    concurrent_flat_map<std::string, std::unique_ptr<int>> map;
+    static_assert(!concurrent_flat_map<std::string, std::unique_ptr<int>>::optimistic_reads);
+    EXPECT_TRUE(map.emplace("one", std::make_unique<int>(1)));
+    EXPECT_TRUE(map.insert_or_assign("two", std::make_unique<int>(2)));
+    EXPECT_TRUE(map.update("two", [](std::unique_ptr<int>& value) { *value = 22; }));
+
+    int seen = 0;
+    EXPECT_TRUE(map.visit("two", [&](const std::unique_ptr<int>& value) { seen = *value; }));
+    EXPECT_EQ(seen, 22);
+    EXPECT_FALSE(map.visit("three", [&](const std::unique_ptr<int>&) { seen = 0; }));
+    EXPECT_EQ(seen, 22);
+    EXPECT_TRUE(map.contains("one"));
+}
+
+TEST(ConcurrentFlatMap, CallbackRegistry)
+{
+    concurrent_flat_map<std::uint32_t, cheap_function<int(int)>> handlers;
+    for (std::uint32_t id = 0; id < 100; ++id)
+    {
+        ASSERT_TRUE(handlers.emplace(id, [id](const int value) { return value + static_cast<int>(id); }));
+    }
+
+    std::atomic<int> total{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]() {
+            for (std::uint32_t id = 0; id < 100; ++id)
+            {
+                handlers.visit(id, [&](const cheap_function<int(int)>& handler) { total += handler(1); });
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(total.load(), 4 * (100 + 99 * 100 / 2));
+}
+
+TEST(ConcurrentFlatMap, OptimisticReadersSeeConsistentValues)
+{
+    struct Pair
+    {
+        std::uint64_t first;
+        std::uint64_t second;
+    };
+    concurrent_flat_map<std::uint64_t, Pair> map(2);
+    constexpr std::uint64_t Keys = 64;
+    for (std::uint64_t key = 0; key < Keys; ++key)
+    {
+        map.insert(key, Pair{key, key});
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> torn{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t)
+    {
+        readers.emplace_back([&]() {
+            std::uint64_t key = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                key = (key + 1) % Keys;
+                if (const std::optional<Pair> value = map.find(key); value && value->first != value->second)
+                {
+                    ++torn;
+                }
+            }
+        });
+    }
+
+    // Growing and shrinking replaces the tables under the readers
+    for (std::uint64_t round = 1; round < 2000; ++round)
+    {
+        for (std::uint64_t key = 0; key < Keys; ++key)
+        {
+            map.insert_or_assign(key, Pair{round, round});
+        }
+        for (std::uint64_t key = Keys; key < Keys + round % 200; ++key)
+        {
+            map.insert(key, Pair{key, key});
+        }
+        for (std::uint64_t key = Keys; key < Keys + round % 200; ++key)
+        {
+            map.erase(key);
+        }
+    }
+    stop = true;
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0u);
+    EXPECT_EQ(map.size(), Keys);
+}
+
+TEST(ConcurrentFlatMap, OptimisticReadersCompareOnlyValidatedKeys)
+{
+    // Valid keys hold a number and its complement, a torn copy may not
+    struct Key
+    {
+        std::uint64_t value;
+        std::uint64_t complement;
+    };
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            return static_cast<std::size_t>(key.value);
+        }
+    };
+    static std::atomic<std::uint64_t> invalidComparisons{0};
+    struct KeyEqual
+    {
+        bool operator()(const Key& left, const Key& right) const
+        {
+            if (left.value != ~left.complement || right.value != ~right.complement)
+            {
+                ++invalidComparisons;
+            }
+            return left.value == right.value;
+        }
+    };
+    concurrent_flat_map<Key, std::uint64_t, KeyHash, KeyEqual> map(1);
+    static_assert(decltype(map)::optimistic_reads);
+    constexpr std::uint64_t Keys = 256;
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t)
+    {
+        readers.emplace_back([&]() {
+            std::uint64_t value = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                value = (value + 1) % Keys;
+                map.contains(Key{value, ~value});
+            }
+        });
+    }
+    // Erased slots are refilled with other keys under the readers
+    for (int round = 0; round < 500; ++round)
+    {
+        for (std::uint64_t value = 0; value < Keys; ++value)
+        {
+            map.insert(Key{value, ~value}, value);
+        }
+        for (std::uint64_t value = 0; value < Keys; ++value)
+        {
+            map.erase(Key{value, ~value});
+        }
+    }
+    stop = true;
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(invalidComparisons.load(), 0u);
+}
+
+TEST(ConcurrentFlatMap, ConcurrentWriters)
+{
+    concurrent_flat_map<std::uint64_t, std::uint64_t> map;
+    constexpr std::uint64_t PerThread = 5000;
+    std::vector<std::thread> threads;
+    for (std::uint64_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (std::uint64_t i = 0; i < PerThread; ++i)
+            {
+                map.insert(t * PerThread + i, i);
+                if (i % 3 == 0)
+                {
+                    map.erase(t * PerThread + i);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(map.size(), 4 * (PerThread - (PerThread + 2) / 3));
+    for (std::uint64_t key = 0; key < 4 * PerThread; ++key)
+    {
+        ASSERT_EQ(map.contains(key), key % PerThread % 3 != 0);
+    }
+}
@@ -0,0 +1,107 @@
+#include <losync/event.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(Event, ManualResetReleasesAllWaiters)
+{
+    event ready;
+    EXPECT_FALSE(ready.is_set());
+    EXPECT_FALSE(ready.try_wait());
+    EXPECT_FALSE(ready.wait_for(std::chrono::milliseconds(1)));
+
+    std::atomic<int> released{0};
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 4; ++i)
+    {
+        waiters.emplace_back([&]() {
+            ready.wait();
+            ++released;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(released.load(), 0);
+    ready.set();
+    for (auto& waiter : waiters)
+    {
+        waiter.join();
+    }
+    EXPECT_EQ(released.load(), 4);
+    // Stays set until reset
+    EXPECT_TRUE(ready.try_wait());
+    EXPECT_TRUE(ready.wait_for(std::chrono::seconds(1)));
+    ready.reset();
+    EXPECT_FALSE(ready.is_set());
+}
+
+TEST(Event, AutoResetReleasesOneWaiterPerSet)
+{
+    event signal(event_reset::automatic, true);
+    EXPECT_TRUE(signal.try_wait());
+    EXPECT_FALSE(signal.try_wait());
+    // Setting a set event does nothing
+    signal.set();
+    signal.set();
+    EXPECT_TRUE(signal.try_wait());
+    EXPECT_FALSE(signal.is_set());
+
+    constexpr int Waiters = 4;
+    std::atomic<int> released{0};
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < Waiters; ++i)
+    {
+        waiters.emplace_back([&]() {
+            signal.wait();
+            ++released;
+        });
+    }
+    for (int i = 1; i <= Waiters; ++i)
+    {
+        // Every set is taken by one waiter before the next one
+        while (signal.is_set() || released.load() != i - 1)
+        {
+            std::this_thread::yield();
+        }
+        signal.set();
+        while (released.load() != i)
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& waiter : waiters)
+    {
+        waiter.join();
+    }
+    EXPECT_FALSE(signal.is_set());
+}
+
+TEST(Event, PingPong)
+{
+    event ping(event_reset::automatic);
+    event pong(event_reset::automatic);
+    constexpr int Rounds = 20000;
+    int value = 0;
+    std::thread other([&]() {
+        for (int i = 0; i < Rounds; ++i)
+        {
+            ping.wait();
+            ++value;
+            pong.set();
+        }
+    });
+    for (int i = 0; i < Rounds; ++i)
+    {
+        ping.set();
+        pong.wait();
+        ASSERT_EQ(value, i + 1);
+    }
+    other.join();
+}
@@ -0,0 +1,80 @@
+#include <losync/flat_combiner.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(FlatCombiner, ReturnsResultsAndExceptions)
+{
+    flat_combiner<std::vector<int>> combiner(std::in_place, 3, 7);
+    EXPECT_EQ(combiner.apply([](std::vector<int>& vector) { return vector.size(); }), 3u);
+    combiner.apply([](std::vector<int>& vector) { vector.push_back(8); });
+    EXPECT_THROW(combiner.apply([](std::vector<int>& vector) { return vector.at(10); }), std::out_of_range);
+
+    // Move-only results and large functors
+    const std::vector<int> large(100, 1);
+    std::unique_ptr<int> sum = combiner.apply([large](std::vector<int>& vector) {
+        int total = 0;
+        for (const int value : vector)
+        {
+            total += value;
+        }
+        return std::make_unique<int>(total + large[0]);
+    });
+    EXPECT_EQ(*sum, 30);
+    EXPECT_EQ(combiner.unsafe_data().back(), 8);
+}
+
+TEST(FlatCombiner, OperationsAreExclusive)
+{
+    // More threads than records, so records are shared
+    const int threads = static_cast<int>(flat_combiner<int>::default_record_count()) + 4;
+    constexpr int PerThread = 20000;
+    flat_combiner<std::priority_queue<int>> queue;
+    std::vector<long long> popped(threads, 0);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&queue, &popped, t]() {
+            for (int i = 0; i < PerThread; ++i)
+            {
+                queue.apply([i](std::priority_queue<int>& heap) { heap.push(i); });
+                if (i % 2 == 1)
+                {
+                    popped[t] += queue.apply([](std::priority_queue<int>& heap) {
+                        const int top = heap.top();
+                        heap.pop();
+                        return top;
+                    });
+                }
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    long long total = 0;
+    for (const long long value : popped)
+    {
+        total += value;
+    }
+    std::priority_queue<int>& heap = queue.unsafe_data();
+    EXPECT_EQ(heap.size(), static_cast<std::size_t>(threads) * PerThread / 2);
+    while (!heap.empty())
+    {
+        total += heap.top();
+        heap.pop();
+    }
+    EXPECT_EQ(total, static_cast<long long>(threads) * PerThread * (PerThread - 1) / 2);
+}
@@ -0,0 +1,198 @@
+#include <losync/future.h>
+#include <losync/thread_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+namespace
+{
+
+struct RejectingExecutor
+{
+    template <typename F>
+    void submit(F&&)
+    {
+        throw std::runtime_error("rejected");
+    }
+};
+
+struct ThrowingCopy
+{
+    ThrowingCopy() = default;
+
+    ThrowingCopy(const ThrowingCopy&)
+    {
+        throw std::runtime_error("copy");
+    }
+
+    int operator()(const std::shared_ptr<int>& value) const
+    {
+        return *value;
+    }
+};
+
+} // namespace
+
+
+TEST(Future, ValueBeforeAndAfterGet)
+{
+    promise<int> first;
+    future<int> firstFuture = first.get_future();
+    EXPECT_THROW(first.get_future(), std::future_error);
+    EXPECT_FALSE(firstFuture.is_ready());
+    first.set_value(5);
+    EXPECT_THROW(first.set_value(6), std::future_error);
+    EXPECT_TRUE(firstFuture.is_ready());
+    EXPECT_EQ(firstFuture.get(), 5);
+    EXPECT_FALSE(firstFuture.valid());
+
+    promise<std::string> second;
+    future<std::string> secondFuture = second.get_future();
+    std::thread producer([&second]() { second.set_value(100, 'x'); });
+    EXPECT_EQ(secondFuture.get(), std::string(100, 'x'));
+    producer.join();
+}
+
+TEST(Future, Exceptions)
+{
+    promise<int> source;
+    future<int> result = source.get_future();
+    source.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+    EXPECT_THROW(result.get(), std::runtime_error);
+
+    future<int> broken;
+    {
+        promise<int> abandoned;
+        broken = abandoned.get_future();
+    }
+    try
+    {
+        broken.get();
+        FAIL();
+    }
+    catch (const std::future_error& error)
+    {
+        EXPECT_EQ(error.code(), std::future_errc::broken_promise);
+    }
+}
+
+TEST(Future, ThenChains)
+{
+    // Attached before and after completion
+    promise<int> source;
+    future<std::string> pending =
+        source.get_future().then([](const int value) { return value * 2; }).then([](const int value) {
+            return std::to_string(value);
+        });
+    source.set_value(21);
+    EXPECT_EQ(pending.get(), "42");
+
+    promise<void> ready;
+    ready.set_value();
+    int calls = 0;
+    future<void> done = ready.get_future().then([&calls]() { ++calls; }).then([&calls]() { ++calls; });
+    EXPECT_TRUE(done.is_ready());
+    done.get();
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(Future, ExceptionsSkipContinuations)
+{
+    promise<int> source;
+    bool called = false;
+    future<int> result = source.get_future()
+                             .then([](int) -> int { throw std::invalid_argument("bad"); })
+                             .then([&called](const int value) {
+                                 called = true;
+                                 return value;
+                             });
+    source.set_value(1);
+    EXPECT_THROW(result.get(), std::invalid_argument);
+    EXPECT_FALSE(called);
+}
+
+TEST(Future, MoveOnlyValuesAndContinuations)
+{
+    promise<std::unique_ptr<int>> source;
+    auto owned = std::make_unique<int>(10);
+    future<int> result = source.get_future().then(
+        [owned = std::move(owned)](std::unique_ptr<int> value) { return *value + *owned; });
+    source.set_value(std::make_unique<int>(5));
+    EXPECT_EQ(result.get(), 15);
+}
+
+TEST(Future, ThenOnExecutor)
+{
+    thread_pool pool(2);
+    const std::thread::id caller = std::this_thread::get_id();
+    promise<int> source;
+    future<bool> result =
+        source.get_future().then(pool, [caller](int) { return std::this_thread::get_id() != caller; });
+    source.set_value(1);
+    EXPECT_TRUE(result.get());
+}
+
+TEST(Future, FailedSubmissionCompletesTheNextFuture)
+{
+    RejectingExecutor executor;
+    promise<int> source;
+    future<int> result = source.get_future().then(executor, [](const int value) { return value + 1; });
+    // The continuation is submitted by the thread which completes the promise
+    source.set_value(1);
+    EXPECT_THROW(result.get(), std::runtime_error);
+
+    promise<int> ready;
+    ready.set_value(2);
+    EXPECT_THROW(ready.get_future().then(executor, [](const int value) { return value; }).get(), std::runtime_error);
+}
+
+TEST(Future, ThrowingContinuationCopyKeepsTheState)
+{
+    RejectingExecutor executor;
+    const ThrowingCopy func;
+    auto value = std::make_shared<int>(1);
+    const std::weak_ptr<int> observer = value;
+    {
+        promise<std::shared_ptr<int>> source;
+        future<std::shared_ptr<int>> sourceFuture = source.get_future();
+        source.set_value(std::move(value));
+        EXPECT_THROW(sourceFuture.then(func), std::runtime_error);
+        EXPECT_THROW(sourceFuture.then(executor, func), std::runtime_error);
+        // The future still owns the state
+        EXPECT_TRUE(sourceFuture.valid());
+        EXPECT_EQ(*sourceFuture.get(), 1);
+    }
+    EXPECT_TRUE(observer.expired());
+}
+
+TEST(Future, RacingCompletionAndContinuation)
+{
+    thread_pool pool(2);
+    for (int round = 0; round < 2000; ++round)
+    {
+        promise<int> source;
+        future<int> sourceFuture = source.get_future();
+        std::atomic<bool> go{false};
+        std::thread producer([&]() {
+            while (!go.load(std::memory_order_acquire))
+            {
+            }
+            source.set_value(round);
+        });
+        go.store(true, std::memory_order_release);
+        future<int> result = round % 2 == 0 ? sourceFuture.then([](const int value) { return value + 1; })
+                                            : sourceFuture.then(pool, [](const int value) { return value + 1; });
+        ASSERT_EQ(result.get(), round + 1);
+        producer.join();
+    }
+}
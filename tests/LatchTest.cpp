@@ -0,0 +1,61 @@
+#include <losync/latch.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(Latch, ReleasesWaitersAtZero)
+{
+    latch empty(0);
+    EXPECT_TRUE(empty.try_wait());
+    empty.wait();
+
+    constexpr int Workers = 6;
+    latch done(Workers);
+    EXPECT_FALSE(done.try_wait());
+    std::vector<int> results(Workers, 0);
+    std::atomic<int> checked{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Workers; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            results[t] = t + 1;
+            // Everybody sees the results of everybody else
+            done.arrive_and_wait();
+            int sum = 0;
+            for (const int result : results)
+            {
+                sum += result;
+            }
+            if (sum == Workers * (Workers + 1) / 2)
+            {
+                ++checked;
+            }
+        });
+    }
+    done.wait();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_TRUE(done.try_wait());
+    EXPECT_EQ(checked.load(), Workers);
+}
+
+TEST(Latch, CountsDownByMany)
+{
+    latch batches(10);
+    batches.count_down(4);
+    batches.count_down(5);
+    EXPECT_FALSE(batches.try_wait());
+    std::thread waiter([&]() { batches.wait(); });
+    batches.count_down();
+    waiter.join();
+    EXPECT_TRUE(batches.try_wait());
+}
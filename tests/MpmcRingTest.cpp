@@ -0,0 +1,121 @@
+#include <losync/cheap_function.h>
+#include <losync/mpmc_ring.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(MpmcRing, FifoAndCapacity)
+{
+    mpmc_ring<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_FALSE(ring.try_pop());
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(ring.try_push(int{i}));
+    }
+    EXPECT_FALSE(ring.try_push(4));
+    EXPECT_EQ(ring.size(), 4u);
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(ring.try_pop(), i);
+    }
+    EXPECT_FALSE(ring.try_pop());
+}
+
+TEST(MpmcRing, MoveOnlyElements)
+{
+    mpmc_ring<std::unique_ptr<int>> ring(2);
+    auto value = std::make_unique<int>(7);
+    EXPECT_TRUE(ring.try_push(std::move(value)));
+    EXPECT_TRUE(ring.try_emplace(new int(8)));
+
+    // A failed push leaves the value untouched
+    auto extra = std::make_unique<int>(9);
+    EXPECT_FALSE(ring.try_push(std::move(extra)));
+    ASSERT_TRUE(extra);
+
+    EXPECT_EQ(**ring.try_pop(), 7);
+    EXPECT_EQ(*ring.pop(), 8);
+
+    mpmc_ring<cheap_function<int()>> tasks(2);
+    tasks.push([ptr = std::move(extra)]() { return *ptr; });
+    EXPECT_EQ((*tasks.try_pop())(), 9);
+}
+
+TEST(MpmcRing, Batches)
+{
+    mpmc_ring<int> ring(8);
+    const std::vector<int> input{1, 2, 3, 4, 5, 6};
+    EXPECT_EQ(ring.push_n(input.begin(), input.size()), 6u);
+    EXPECT_EQ(ring.push_n(input.begin(), input.size()), 2u);
+
+    std::vector<int> output;
+    EXPECT_EQ(ring.pop_n(std::back_inserter(output), 5), 5u);
+    EXPECT_EQ(ring.pop_n(std::back_inserter(output), 5), 3u);
+    EXPECT_EQ(ring.pop_n(std::back_inserter(output), 5), 0u);
+    EXPECT_EQ(output, (std::vector<int>{1, 2, 3, 4, 5, 6, 1, 2}));
+}
+
+TEST(MpmcRing, DestroysRemainingElements)
+{
+    auto shared = std::make_shared<int>(1);
+    {
+        mpmc_ring<std::shared_ptr<int>> ring(16);
+        for (int i = 0; i < 10; ++i)
+        {
+            ring.push(std::shared_ptr<int>(shared));
+        }
+        ring.try_pop();
+        EXPECT_EQ(shared.use_count(), 10);
+    }
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(MpmcRing, BlockingProducersAndConsumers)
+{
+    constexpr int Producers = 3;
+    constexpr int Consumers = 3;
+    constexpr int PerProducer = 30000;
+    // A small ring makes both sides block
+    mpmc_ring<std::int64_t> ring(4);
+
+    std::atomic<std::int64_t> sum{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < Producers; ++p)
+    {
+        threads.emplace_back([&ring]() {
+            for (int i = 1; i <= PerProducer; ++i)
+            {
+                ring.push(std::int64_t{i});
+            }
+        });
+    }
+    for (int c = 0; c < Consumers; ++c)
+    {
+        threads.emplace_back([&ring, &sum]() {
+            std::int64_t local = 0;
+            for (int i = 0; i < PerProducer; ++i)
+            {
+                local += ring.pop();
+            }
+            sum.fetch_add(local);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(sum.load(), std::int64_t{Producers} * PerProducer * (PerProducer + 1) / 2);
+    EXPECT_FALSE(ring.try_pop());
+}
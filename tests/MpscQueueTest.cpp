@@ -0,0 +1,88 @@
+#include <losync/mpsc_queue.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(MpscQueue, FifoAndBatches)
+{
+    mpsc_queue<int> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_FALSE(queue.push(2));
+    EXPECT_FALSE(queue.push(3));
+    EXPECT_FALSE(queue.empty());
+
+    std::vector<int> values;
+    EXPECT_EQ(queue.drain([&values](int value) { values.push_back(value); }, 2), 2u);
+    EXPECT_TRUE(queue.push(4));
+    EXPECT_EQ(queue.drain([&values](int value) { values.push_back(value); }), 2u);
+    EXPECT_EQ(values, (std::vector<int>{1, 2, 3, 4}));
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.drain([](int) {}), 0u);
+}
+
+TEST(MpscQueue, RunsTasks)
+{
+    mpsc_queue<> queue;
+    int sum = 0;
+    auto ptr = std::make_unique<int>(10);
+    queue.push([&sum]() { sum += 1; });
+    queue.push([&sum, ptr = std::move(ptr)]() { sum += *ptr; });
+    EXPECT_EQ(queue.run(), 2u);
+    EXPECT_EQ(sum, 11);
+}
+
+TEST(MpscQueue, DestroysRemainingElements)
+{
+    auto shared = std::make_shared<int>(1);
+    {
+        mpsc_queue<std::shared_ptr<int>> queue;
+        for (int i = 0; i < 100; ++i)
+        {
+            queue.push(shared);
+        }
+        queue.drain([](std::shared_ptr<int>&) {}, 50);
+        EXPECT_EQ(shared.use_count(), 51);
+    }
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(MpscQueue, ManyProducers)
+{
+    constexpr int Producers = 4;
+    constexpr int PerProducer = 50000;
+    mpsc_queue<std::pair<int, int>> queue;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < Producers; ++p)
+    {
+        threads.emplace_back([&queue, p]() {
+            for (int i = 0; i < PerProducer; ++i)
+            {
+                queue.push(p, i);
+            }
+        });
+    }
+
+    std::vector<int> expected(Producers, 0);
+    int consumed = 0;
+    while (consumed < Producers * PerProducer)
+    {
+        consumed += static_cast<int>(queue.drain([&expected](const std::pair<int, int>& item) {
+            EXPECT_EQ(item.second, expected[item.first]);
+            expected[item.first] = item.second + 1;
+        }));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_TRUE(queue.empty());
+}
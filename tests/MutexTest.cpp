@@ -0,0 +1,82 @@
+#include <losync/mutex.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(Mutex, LockAndTryLock)
+{
+    losync::mutex mutex;
+    EXPECT_TRUE(mutex.try_lock());
+    EXPECT_FALSE(mutex.try_lock());
+    mutex.unlock();
+
+    {
+        std::lock_guard<losync::mutex> lock(mutex);
+        EXPECT_FALSE(mutex.try_lock());
+    }
+    std::unique_lock<losync::mutex> lock(mutex, std::try_to_lock);
+    EXPECT_TRUE(lock.owns_lock());
+}
+
+TEST(Mutex, MutualExclusion)
+{
+    constexpr int Threads = 8;
+    constexpr int PerThread = 20000;
+    losync::mutex mutex;
+    int counter = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Threads; ++i)
+    {
+        threads.emplace_back([&mutex, &counter]() {
+            for (int j = 0; j < PerThread; ++j)
+            {
+                std::lock_guard<losync::mutex> lock(mutex);
+                ++counter;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(counter, Threads * PerThread);
+}
+
+TEST(Mutex, Profile)
+{
+    const unsigned line = __LINE__ + 1;
+    losync::mutex mutex;
+    for (int i = 0; i < 10; ++i)
+    {
+        std::lock_guard<losync::mutex> lock(mutex);
+    }
+    std::thread([&mutex]() { std::lock_guard<losync::mutex> lock(mutex); }).join();
+
+    const auto sites = mutex_profile::collect();
+    if (!mutex_profile::enabled())
+    {
+        EXPECT_TRUE(sites.empty());
+        return;
+    }
+    bool found = false;
+    for (const auto& site : sites)
+    {
+        if (site.line == line && std::strstr(site.file, "MutexTest.cpp") != nullptr)
+        {
+            found = true;
+            // The exited thread is counted too
+            EXPECT_EQ(site.acquisitions, 11u);
+            EXPECT_LE(site.max_hold_ns, site.hold_ns);
+        }
+    }
+    EXPECT_TRUE(found);
+}
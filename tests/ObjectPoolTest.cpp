@@ -0,0 +1,167 @@
+#include <losync/mpmc_ring.h>
+#include <losync/object_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+namespace
+{
+
+struct alignas(32) Node
+{
+    explicit Node(const int value) : value(value), text(std::to_string(value))
+    {
+        if (value < 0)
+        {
+            throw std::invalid_argument("negative");
+        }
+    }
+
+    int value;
+    std::string text;
+};
+
+} // namespace
+
+
+TEST(ObjectPool, CreatesAlignedDistinctObjects)
+{
+    object_pool<Node> pool;
+    std::vector<Node*> nodes;
+    std::set<Node*> distinct;
+    for (int i = 0; i < 3 * static_cast<int>(object_pool<Node>::objects_per_slab()); ++i)
+    {
+        Node* const node = pool.create(i);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(node) % alignof(Node), 0u);
+        nodes.push_back(node);
+        distinct.insert(node);
+    }
+    EXPECT_EQ(distinct.size(), nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        EXPECT_EQ(nodes[i]->text, std::to_string(i));
+    }
+    EXPECT_EQ(pool.slab_count(), 3u);
+
+    // The last freed object is reused first
+    Node* const last = nodes.back();
+    nodes.pop_back();
+    pool.destroy(last);
+    Node* const again = pool.create(7);
+    EXPECT_EQ(again, last);
+    nodes.push_back(again);
+
+    // Memory of an object whose constructor threw is reused as well
+    Node* const top = nodes.back();
+    nodes.pop_back();
+    pool.destroy(top);
+    EXPECT_THROW(pool.create(-1), std::invalid_argument);
+    EXPECT_EQ(pool.create(8), top);
+    nodes.push_back(top);
+
+    // Empty slabs go to the depot and are not allocated anew
+    for (Node* const node : nodes)
+    {
+        pool.destroy(node);
+    }
+    EXPECT_EQ(pool.empty_slab_count(), 2u);
+    for (int i = 0; i < 2 * static_cast<int>(object_pool<Node>::objects_per_slab()); ++i)
+    {
+        nodes[i] = pool.create(i);
+    }
+    EXPECT_EQ(pool.slab_count(), 3u);
+    EXPECT_EQ(pool.empty_slab_count(), 1u);
+    for (int i = 0; i < 2 * static_cast<int>(object_pool<Node>::objects_per_slab()); ++i)
+    {
+        pool.destroy(nodes[i]);
+    }
+}
+
+TEST(ObjectPool, ProducersAllocateConsumersFree)
+{
+    object_pool<Node> pool;
+    mpmc_ring<Node*> queue(1024);
+    constexpr int Producers = 2;
+    constexpr int Consumers = 2;
+    constexpr int PerProducer = 100000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < Producers; ++p)
+    {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < PerProducer; ++i)
+            {
+                queue.push(pool.create(i));
+            }
+        });
+    }
+    std::vector<long long> sums(Consumers, 0);
+    for (int c = 0; c < Consumers; ++c)
+    {
+        threads.emplace_back([&, c]() {
+            for (int i = 0; i < Producers * PerProducer / Consumers; ++i)
+            {
+                Node* const node = queue.pop();
+                if (node->text == std::to_string(node->value))
+                {
+                    sums[c] += node->value;
+                }
+                pool.destroy(node);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    long long total = 0;
+    for (const long long sum : sums)
+    {
+        total += sum;
+    }
+    EXPECT_EQ(total, static_cast<long long>(Producers) * PerProducer * (PerProducer - 1) / 2);
+    // Remote frees come back to the producers, so memory stays bounded by the objects in flight
+    EXPECT_LE(pool.slab_count(), 4u * Producers + pool.default_heap_count());
+}
+
+TEST(ObjectPool, ThreadsBeyondHeapsShareOneHeap)
+{
+    // No heaps at all: every thread uses the shared one and every free is remote
+    object_pool<Node> pool(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&pool]() {
+            std::vector<Node*> nodes;
+            for (int round = 0; round < 20; ++round)
+            {
+                for (int i = 0; i < 500; ++i)
+                {
+                    nodes.push_back(pool.create(i));
+                }
+                for (Node* const node : nodes)
+                {
+                    EXPECT_EQ(node->text, std::to_string(node->value));
+                    pool.destroy(node);
+                }
+                nodes.clear();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_LE(pool.slab_count(), 4u);
+}
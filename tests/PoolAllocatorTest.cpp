@@ -0,0 +1,72 @@
+#include <losync/pool_allocator.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(PoolAllocator, BlocksAreDistinctAndAligned)
+{
+    std::vector<void*> blocks;
+    std::set<void*> unique;
+    for (std::size_t size : {1, 32, 33, 100, 1000, 4096, 5000})
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            void* const block = pool_allocator::allocate(size);
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(block) % alignof(std::max_align_t), 0u);
+            std::memset(block, 0xAB, size);
+            EXPECT_TRUE(unique.insert(block).second);
+            blocks.push_back(block);
+        }
+        for (void* block : blocks)
+        {
+            pool_allocator::deallocate(block, size);
+        }
+        blocks.clear();
+        unique.clear();
+    }
+}
+
+TEST(PoolAllocator, BlocksAreReused)
+{
+    void* const block = pool_allocator::allocate(64);
+    pool_allocator::deallocate(block, 64);
+    void* const block2 = pool_allocator::allocate(64);
+    EXPECT_EQ(block, block2);
+    pool_allocator::deallocate(block2, 64);
+}
+
+TEST(PoolAllocator, FreeOnAnotherThread)
+{
+    constexpr int Count = 1000;
+    std::vector<void*> blocks;
+    for (int i = 0; i < Count; ++i)
+    {
+        blocks.push_back(pool_allocator::allocate(128));
+    }
+
+    std::thread consumer([&blocks]() {
+        for (void* block : blocks)
+        {
+            pool_allocator::deallocate(block, 128);
+        }
+        for (int i = 0; i < Count; ++i)
+        {
+            blocks[i] = pool_allocator::allocate(128);
+        }
+    });
+    consumer.join();
+
+    for (void* block : blocks)
+    {
+        pool_allocator::deallocate(block, 128);
+    }
+}
@@ -0,0 +1,148 @@
+#include <losync/rcu_cell.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+namespace
+{
+
+struct Tracked
+{
+    explicit Tracked(const int value, std::atomic<int>& alive) : value(value), alive(alive)
+    {
+        ++alive;
+    }
+
+    Tracked(const Tracked& other) : value(other.value), alive(other.alive)
+    {
+        ++alive;
+    }
+
+    ~Tracked()
+    {
+        --alive;
+    }
+
+    int value;
+    std::atomic<int>& alive;
+};
+
+} // namespace
+
+
+TEST(RcuCell, ReadStoreUpdate)
+{
+    rcu_cell<std::string> cell("first");
+    EXPECT_EQ(*cell.read(), "first");
+
+    cell.store(std::make_unique<std::string>("second"));
+    EXPECT_EQ(cell.read()->size(), 6u);
+
+    cell.update([](std::string& value) { value += "!"; });
+    EXPECT_EQ(*cell.read(), "second!");
+}
+
+TEST(RcuCell, ReaderKeepsOldVersionAlive)
+{
+    std::atomic<int> alive{0};
+    {
+        rcu_cell<Tracked> cell(1, alive);
+        {
+            const auto guard = cell.read();
+            // Nested read sections are allowed
+            const auto nested = cell.read();
+            cell.emplace(2, alive);
+            EXPECT_EQ(guard->value, 1);
+            EXPECT_EQ(nested->value, 1);
+            EXPECT_EQ(cell.read()->value, 2);
+            EXPECT_EQ(cell.reclaim(), 1u);
+            EXPECT_EQ(alive, 2);
+        }
+        EXPECT_EQ(cell.reclaim(), 0u);
+        EXPECT_EQ(alive, 1);
+
+        // A reader in another thread does not block updates
+        std::atomic<bool> reading{false};
+        std::atomic<bool> release{false};
+        std::thread reader([&]() {
+            const auto guard = cell.read();
+            reading = true;
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+            EXPECT_EQ(guard->value, 2);
+        });
+        while (!reading)
+        {
+            std::this_thread::yield();
+        }
+        cell.emplace(3, alive);
+        EXPECT_EQ(cell.reclaim(), 1u);
+        release = true;
+        reader.join();
+        EXPECT_EQ(cell.reclaim(), 0u);
+    }
+    EXPECT_EQ(alive, 0);
+}
+
+TEST(RcuCell, ConcurrentReadersAndWriters)
+{
+    std::atomic<int> alive{0};
+    {
+        rcu_cell<Tracked> cell(0, alive);
+        std::atomic<bool> done{false};
+        std::atomic<bool> decreased{false};
+
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 4; ++i)
+        {
+            readers.emplace_back([&]() {
+                int last = 0;
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    const auto guard = cell.read();
+                    // Destroyed objects would be caught by sanitizers, values must not go back
+                    if (guard->value < last)
+                    {
+                        decreased = true;
+                    }
+                    last = guard->value;
+                }
+            });
+        }
+        std::vector<std::thread> writers;
+        for (int i = 0; i < 2; ++i)
+        {
+            writers.emplace_back([&cell]() {
+                for (int j = 0; j < 5000; ++j)
+                {
+                    cell.update([](Tracked& value) { ++value.value; });
+                }
+            });
+        }
+        for (auto& writer : writers)
+        {
+            writer.join();
+        }
+        done = true;
+        for (auto& reader : readers)
+        {
+            reader.join();
+        }
+        EXPECT_FALSE(decreased);
+        EXPECT_EQ(cell.read()->value, 10000);
+        EXPECT_EQ(cell.reclaim(), 0u);
+        EXPECT_EQ(alive, 1);
+    }
+    EXPECT_EQ(alive, 0);
+}
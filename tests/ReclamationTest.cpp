@@ -0,0 +1,231 @@
+#include <losync/reclamation.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+namespace
+{
+
+constexpr unsigned Alive = 0xA11CE;
+constexpr unsigned Dead = 0xDEAD;
+
+struct Node
+{
+    explicit Node(const int value) : value(value)
+    {
+    }
+
+    std::atomic<unsigned> state{Alive};
+    int value;
+    Node* next = nullptr;
+};
+
+// Poisons the node before deleting it, so a reader which still sees it reports a use after free
+void destroyNode(Node* node)
+{
+    node->state.store(Dead, std::memory_order_relaxed);
+    delete node;
+}
+
+
+// Treiber stack which reclaims popped nodes with `Scheme`
+template <typename Scheme>
+class Stack;
+
+template <>
+class Stack<ebr>
+{
+public:
+    void push(Node* node)
+    {
+        node->next = top.load(std::memory_order_relaxed);
+        while (!top.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    bool pop(int& value, std::atomic<bool>& useAfterFree)
+    {
+        Node* node = nullptr;
+        {
+            ebr::guard guard;
+            node = top.load(std::memory_order_acquire);
+            while (node != nullptr)
+            {
+                if (node->state.load(std::memory_order_relaxed) != Alive)
+                {
+                    useAfterFree = true;
+                }
+                if (top.compare_exchange_weak(node, node->next, std::memory_order_acquire))
+                {
+                    break;
+                }
+            }
+        }
+        if (node == nullptr)
+        {
+            return false;
+        }
+        value = node->value;
+        ebr::retire(node, &destroyNode);
+        return true;
+    }
+
+private:
+    std::atomic<Node*> top{nullptr};
+};
+
+template <>
+class Stack<hazard_pointers>
+{
+public:
+    void push(Node* node)
+    {
+        node->next = top.load(std::memory_order_relaxed);
+        while (!top.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    bool pop(int& value, std::atomic<bool>& useAfterFree)
+    {
+        hazard_pointers::holder holder;
+        for (;;)
+        {
+            Node* const node = holder.protect(top);
+            if (node == nullptr)
+            {
+                return false;
+            }
+            if (node->state.load(std::memory_order_relaxed) != Alive)
+            {
+                useAfterFree = true;
+            }
+            Node* expected = node;
+            if (top.compare_exchange_strong(expected, node->next, std::memory_order_acquire))
+            {
+                holder.reset();
+                value = node->value;
+                hazard_pointers::retire(node, &destroyNode);
+                return true;
+            }
+        }
+    }
+
+private:
+    std::atomic<Node*> top{nullptr};
+};
+
+
+template <typename Scheme>
+void stressTest()
+{
+    constexpr int Threads = 6;
+    constexpr int PerThread = 20000;
+    Stack<Scheme> stack;
+    std::atomic<bool> useAfterFree{false};
+    std::atomic<long long> popped{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Threads; ++i)
+    {
+        threads.emplace_back([&]() {
+            long long sum = 0;
+            for (int j = 0; j < PerThread; ++j)
+            {
+                stack.push(new Node(1));
+                int value = 0;
+                if (stack.pop(value, useAfterFree))
+                {
+                    sum += value;
+                }
+            }
+            popped += sum;
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    int value = 0;
+    while (stack.pop(value, useAfterFree))
+    {
+        popped += value;
+    }
+
+    EXPECT_FALSE(useAfterFree);
+    EXPECT_EQ(popped, Threads * PerThread);
+    // Objects of exited threads are adopted, nobody reads anymore
+    EXPECT_EQ(Scheme::collect(), 0u);
+    EXPECT_EQ(Scheme::unreclaimed(), 0);
+}
+
+} // namespace
+
+
+TEST(Reclamation, EbrGuardDelaysDestruction)
+{
+    // Objects retired by other tests on this thread, like replaced tables of `concurrent_flat_map`
+    ASSERT_EQ(ebr::collect(), 0u);
+    auto alive = std::make_shared<int>(0);
+    {
+        ebr::guard guard;
+        ebr::retire(new std::weak_ptr<int>(alive));
+        ebr::retire(new int(1), [alive](int* ptr) {
+            ++*alive;
+            delete ptr;
+        });
+        EXPECT_EQ(ebr::collect(), 2u);
+        EXPECT_EQ(*alive, 0);
+    }
+    EXPECT_EQ(ebr::collect(), 0u);
+    EXPECT_EQ(*alive, 1);
+    EXPECT_EQ(ebr::unreclaimed(), 0);
+}
+
+TEST(Reclamation, HazardPointerDelaysDestruction)
+{
+    std::atomic<Node*> shared{new Node(5)};
+    {
+        hazard_pointers::holder holder;
+        Node* const node = holder.protect(shared);
+        shared.store(nullptr);
+        hazard_pointers::retire(node, &destroyNode);
+        EXPECT_EQ(hazard_pointers::collect(), 1u);
+        EXPECT_EQ(node->state.load(), Alive);
+        EXPECT_EQ(node->value, 5);
+    }
+    EXPECT_EQ(hazard_pointers::collect(), 0u);
+    EXPECT_EQ(hazard_pointers::unreclaimed(), 0);
+}
+
+TEST(Reclamation, HazardSlotsAreLimited)
+{
+    std::vector<std::unique_ptr<hazard_pointers::holder>> holders;
+    for (std::size_t i = 0; i < hazard_pointers::slots_per_thread; ++i)
+    {
+        holders.push_back(std::make_unique<hazard_pointers::holder>());
+    }
+    EXPECT_THROW(hazard_pointers::holder(), std::length_error);
+    holders.pop_back();
+    EXPECT_NO_THROW(hazard_pointers::holder());
+}
+
+TEST(Reclamation, EbrStress)
+{
+    stressTest<ebr>();
+}
+
+TEST(Reclamation, HazardPointersStress)
+{
+    stressTest<hazard_pointers>();
+}
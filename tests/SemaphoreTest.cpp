@@ -0,0 +1,101 @@
+#include <losync/semaphore.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(CountingSemaphore, CountsUnits)
+{
+    counting_semaphore semaphore(2);
+    EXPECT_TRUE(semaphore.try_acquire());
+    semaphore.acquire();
+    EXPECT_FALSE(semaphore.try_acquire());
+    EXPECT_FALSE(semaphore.try_acquire_for(std::chrono::milliseconds(1)));
+    semaphore.release(3);
+    EXPECT_TRUE(semaphore.try_acquire_for(std::chrono::seconds(1)));
+    EXPECT_TRUE(semaphore.try_acquire());
+    EXPECT_TRUE(semaphore.try_acquire());
+    EXPECT_FALSE(semaphore.try_acquire());
+}
+
+TEST(CountingSemaphore, LimitsConcurrency)
+{
+    constexpr int Limit = 3;
+    counting_semaphore semaphore(Limit);
+    std::atomic<int> inside{0};
+    std::atomic<int> maxInside{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 2000; ++i)
+            {
+                semaphore.acquire();
+                const int now = ++inside;
+                int seen = maxInside.load();
+                while (now > seen && !maxInside.compare_exchange_weak(seen, now))
+                {
+                }
+                if (i % 64 == 0)
+                {
+                    std::this_thread::yield();
+                }
+                --inside;
+                semaphore.release();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_LE(maxInside.load(), Limit);
+    for (int i = 0; i < Limit; ++i)
+    {
+        EXPECT_TRUE(semaphore.try_acquire());
+    }
+    EXPECT_FALSE(semaphore.try_acquire());
+}
+
+TEST(CountingSemaphore, TimedOutWaitersDoNotLoseUnits)
+{
+    counting_semaphore semaphore(0);
+    constexpr int Released = 300;
+    std::atomic<int> acquired{0};
+    std::vector<std::thread> waiters;
+    for (int t = 0; t < 4; ++t)
+    {
+        waiters.emplace_back([&]() {
+            for (int i = 0; i < 400; ++i)
+            {
+                if (semaphore.try_acquire_for(std::chrono::microseconds(30)))
+                {
+                    ++acquired;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < Released; ++i)
+    {
+        semaphore.release();
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+    for (auto& waiter : waiters)
+    {
+        waiter.join();
+    }
+    // Units which were not taken are still there
+    int left = 0;
+    while (semaphore.try_acquire())
+    {
+        ++left;
+    }
+    EXPECT_EQ(acquired.load() + left, Released);
+}
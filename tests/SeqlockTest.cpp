@@ -0,0 +1,83 @@
+#include <losync/seqlock.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+namespace
+{
+
+struct Pair
+{
+    std::uint64_t first;
+    std::uint64_t second;
+    std::uint32_t third;
+};
+
+} // namespace
+
+
+TEST(Seqlock, LoadAndStore)
+{
+    seqlock<Pair> value(Pair{1, 2, 3});
+    EXPECT_EQ(value.load().second, 2u);
+    EXPECT_EQ(value.version(), 0u);
+    value.store(Pair{4, 5, 6});
+    EXPECT_EQ(value.load().third, 6u);
+    EXPECT_EQ(value.version(), 1u);
+
+    seqlock<double> number;
+    EXPECT_EQ(number.load(), 0.0);
+}
+
+TEST(Seqlock, ReadersNeverSeeTornValues)
+{
+    constexpr int Writers = 2;
+    constexpr std::uint64_t PerWriter = 20000;
+    seqlock<Pair> value(Pair{0, 0, 0});
+    std::atomic<bool> done{false};
+    std::atomic<bool> torn{false};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i)
+    {
+        readers.emplace_back([&]() {
+            while (!done.load(std::memory_order_relaxed))
+            {
+                const Pair pair = value.load();
+                if (pair.first != pair.second || pair.third != static_cast<std::uint32_t>(pair.first))
+                {
+                    torn = true;
+                }
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int i = 0; i < Writers; ++i)
+    {
+        writers.emplace_back([&value]() {
+            for (std::uint64_t j = 1; j <= PerWriter; ++j)
+            {
+                value.store(Pair{j, j, static_cast<std::uint32_t>(j)});
+            }
+        });
+    }
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+    done = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_FALSE(torn);
+    EXPECT_EQ(value.version(), Writers * PerWriter);
+}
@@ -0,0 +1,52 @@
+#include <losync/sharded_counter.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(ShardedCounter, AddReadReset)
+{
+    sharded_counter counter(3);
+    EXPECT_EQ(counter.shard_count(), 4u);
+    EXPECT_EQ(counter.read(), 0);
+
+    counter.add();
+    counter.add(10);
+    counter.local().add(-2);
+    EXPECT_EQ(counter.read(), 9);
+
+    counter.reset();
+    EXPECT_EQ(counter.read(), 0);
+}
+
+TEST(ShardedCounter, ConcurrentAdds)
+{
+    constexpr int Threads = 8;
+    constexpr int PerThread = 100000;
+    sharded_counter counter;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Threads; ++i)
+    {
+        threads.emplace_back([&counter]() {
+            auto shard = counter.local();
+            for (int j = 0; j < PerThread; ++j)
+            {
+                if (j % 2 == 0)
+                    counter.add();
+                else
+                    shard.add();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(counter.read(), Threads * PerThread);
+}
@@ -0,0 +1,88 @@
+#include <losync/sharded_histogram.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(ShardedHistogram, BucketBounds)
+{
+    for (std::uint64_t value : {0ull, 1ull, 31ull, 32ull, 33ull, 63ull, 64ull, 1000ull, 123456789ull, ~0ull})
+    {
+        const std::size_t index = sharded_histogram::bucket_index(value);
+        ASSERT_LT(index, sharded_histogram::bucket_count);
+        EXPECT_GE(sharded_histogram::bucket_upper_bound(index), value);
+        if (index > 0)
+        {
+            EXPECT_LT(sharded_histogram::bucket_upper_bound(index - 1), value);
+        }
+        // Relative error stays below 1/32
+        EXPECT_LE(sharded_histogram::bucket_upper_bound(index) - value, value / 32);
+    }
+    EXPECT_EQ(sharded_histogram::bucket_index(~0ull), sharded_histogram::bucket_count - 1);
+}
+
+TEST(ShardedHistogram, Quantiles)
+{
+    sharded_histogram histogram(2);
+    EXPECT_EQ(histogram.read().p50(), 0u);
+
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+    {
+        histogram.record(value);
+    }
+    auto local = histogram.local();
+    local.record(1000000);
+
+    const auto snapshot = histogram.read();
+    EXPECT_EQ(snapshot.count(), 1001u);
+    EXPECT_EQ(snapshot.max(), 1000000u);
+    EXPECT_NEAR(static_cast<double>(snapshot.p50()), 501, 501 / 32.0);
+    EXPECT_NEAR(static_cast<double>(snapshot.p99()), 991, 991 / 32.0);
+    EXPECT_NEAR(static_cast<double>(snapshot.p999()), 1000, 1000 / 32.0);
+    EXPECT_EQ(snapshot.quantile(1.0), 1000000u);
+    EXPECT_EQ(snapshot.quantile(0.0), 1u);
+
+    histogram.reset();
+    EXPECT_EQ(histogram.read().count(), 0u);
+    EXPECT_EQ(histogram.read().max(), 0u);
+}
+
+TEST(ShardedHistogram, ConcurrentRecordsAndReads)
+{
+    constexpr int Threads = 8;
+    constexpr std::uint64_t PerThread = 50000;
+    sharded_histogram histogram;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Threads; ++i)
+    {
+        threads.emplace_back([&histogram]() {
+            auto shard = histogram.local();
+            for (std::uint64_t value = 0; value < PerThread; ++value)
+            {
+                shard.record(value);
+            }
+        });
+    }
+    // Reading does not stop writers
+    std::uint64_t previous = 0;
+    for (int i = 0; i < 10; ++i)
+    {
+        const std::uint64_t count = histogram.read().count();
+        EXPECT_GE(count, previous);
+        previous = count;
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    const auto snapshot = histogram.read();
+    EXPECT_EQ(snapshot.count(), Threads * PerThread);
+    EXPECT_EQ(snapshot.max(), PerThread - 1);
+}
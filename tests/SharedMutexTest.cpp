@@ -0,0 +1,93 @@
+#include <losync/shared_mutex.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(SharedMutex, ReadersShareWritersExclude)
+{
+    losync::shared_mutex mutex;
+    {
+        std::shared_lock<losync::shared_mutex> first(mutex);
+        std::thread([&mutex]() {
+            EXPECT_TRUE(mutex.try_lock_shared());
+            mutex.unlock_shared();
+        }).join();
+        EXPECT_FALSE(mutex.try_lock());
+    }
+    {
+        std::unique_lock<losync::shared_mutex> writer(mutex);
+        std::thread([&mutex]() {
+            EXPECT_FALSE(mutex.try_lock_shared());
+            EXPECT_FALSE(mutex.try_lock());
+        }).join();
+    }
+    // The slow path restores the bias after the inhibition period
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mutex.lock_shared();
+    mutex.unlock_shared();
+    EXPECT_TRUE(mutex.try_lock());
+    mutex.unlock();
+}
+
+void stressTest(losync::shared_mutex& mutex, const int readers, const int writers)
+{
+    constexpr int Iterations = 20000;
+    // Writers keep both values equal
+    int first = 0;
+    int second = 0;
+    std::atomic<bool> mismatch{false};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < Iterations; ++j)
+            {
+                std::shared_lock<losync::shared_mutex> lock(mutex);
+                if (first != second)
+                {
+                    mismatch = true;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < writers; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < Iterations / 10; ++j)
+            {
+                std::lock_guard<losync::shared_mutex> lock(mutex);
+                ++first;
+                ++second;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_FALSE(mismatch);
+    EXPECT_EQ(first, writers * (Iterations / 10));
+}
+
+TEST(SharedMutex, ReadersAndWriters)
+{
+    losync::shared_mutex mutex;
+    stressTest(mutex, 6, 2);
+}
+
+TEST(SharedMutex, MoreThreadsThanSlots)
+{
+    losync::shared_mutex mutex(1);
+    EXPECT_EQ(mutex.reader_slots(), 1u);
+    stressTest(mutex, 6, 2);
+}
@@ -0,0 +1,147 @@
+#include <losync/cheap_function.h>
+#include <losync/spsc_ring.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+
+
+using namespace losync;
+
+
+TEST(SpscRing, FifoAndCapacity)
+{
+    spsc_ring<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_FALSE(ring.try_pop());
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(ring.try_push(int{i}));
+    }
+    EXPECT_FALSE(ring.try_push(4));
+    EXPECT_EQ(ring.size(), 4u);
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(ring.try_pop(), i);
+    }
+    EXPECT_FALSE(ring.try_pop());
+    EXPECT_EQ(ring.size(), 0u);
+}
+
+TEST(SpscRing, MoveOnlyElements)
+{
+    spsc_ring<cheap_function<int()>> ring(2);
+    auto ptr = std::make_unique<int>(5);
+    EXPECT_TRUE(ring.try_emplace([ptr = std::move(ptr)]() { return *ptr; }));
+    EXPECT_EQ((*ring.try_pop())(), 5);
+}
+
+TEST(SpscRing, ReserveAndPeekWrapAround)
+{
+    spsc_ring<int> ring(8);
+    for (int i = 0; i < 6; ++i)
+    {
+        ring.try_push(int{i});
+    }
+    ring.consume(ring.peek(6).size);
+
+    // Only two slots remain before the end of the storage
+    auto free = ring.reserve(5);
+    ASSERT_EQ(free.size, 2u);
+    new (free.data) int(10);
+    new (free.data + 1) int(11);
+    ring.commit(2);
+    free = ring.reserve(5);
+    ASSERT_EQ(free.size, 5u);
+    for (int i = 0; i < 3; ++i)
+    {
+        new (free.data + i) int(12 + i);
+    }
+    ring.commit(3);
+    EXPECT_EQ(ring.size(), 5u);
+
+    auto ready = ring.peek();
+    ASSERT_EQ(ready.size, 2u);
+    EXPECT_EQ(ready.data[0], 10);
+    EXPECT_EQ(ready.data[1], 11);
+    ring.consume(1);
+    EXPECT_EQ(ring.peek(1).data[0], 11);
+    ring.consume(1);
+    ready = ring.peek();
+    ASSERT_EQ(ready.size, 3u);
+    EXPECT_EQ(ready.data[2], 14);
+}
+
+TEST(SpscRing, PeekWithoutCountUsesCachedIndex)
+{
+    spsc_ring<int> ring(8);
+    ASSERT_TRUE(ring.try_push(1));
+    EXPECT_EQ(ring.peek().size, 1u);
+    ASSERT_TRUE(ring.try_push(2));
+    ASSERT_TRUE(ring.try_push(3));
+
+    // The cached index still has a ready element, so the new ones are not seen yet
+    EXPECT_EQ(ring.peek().size, 1u);
+    // An explicit count reads the shared index when the cached one falls short
+    EXPECT_EQ(ring.peek(3).size, 3u);
+    ring.consume(3);
+    // Nothing is ready by the cached index, so the shared one is read
+    ASSERT_TRUE(ring.try_push(4));
+    EXPECT_EQ(ring.peek().size, 1u);
+}
+
+TEST(SpscRing, DestroysRemainingElements)
+{
+    auto shared = std::make_shared<int>(1);
+    {
+        spsc_ring<std::shared_ptr<int>> ring(8);
+        for (int i = 0; i < 5; ++i)
+        {
+            ring.try_emplace(shared);
+        }
+        ring.try_pop();
+        EXPECT_EQ(shared.use_count(), 5);
+    }
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(SpscRing, ProducerAndConsumer)
+{
+    constexpr std::uint64_t Count = 200000;
+    spsc_ring<std::uint64_t> ring(64);
+
+    std::thread producer([&ring]() {
+        std::uint64_t next = 0;
+        while (next < Count)
+        {
+            const auto free = ring.reserve(Count - next);
+            for (std::size_t i = 0; i < free.size; ++i)
+            {
+                new (free.data + i) std::uint64_t(next++);
+            }
+            ring.commit(free.size);
+            if (free.size == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::uint64_t expected = 0;
+    while (expected < Count)
+    {
+        if (auto value = ring.try_pop())
+        {
+            ASSERT_EQ(*value, expected);
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
@@ -0,0 +1,117 @@
+#include <losync/strand.h>
+#include <losync/thread_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(Strand, MessagesRunInOrderOneAtATime)
+{
+    constexpr int Producers = 4;
+    constexpr int PerProducer = 5000;
+    thread_pool pool(4);
+    std::vector<int> last(Producers, -1);
+    bool ordered = true;
+    std::atomic<int> inside{0};
+    bool exclusive = true;
+    {
+        strand serial(pool, 16);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < Producers; ++p)
+        {
+            producers.emplace_back([&, p]() {
+                for (int i = 0; i < PerProducer; ++i)
+                {
+                    serial.post([&, p, i]() {
+                        if (inside.fetch_add(1) != 0)
+                        {
+                            exclusive = false;
+                        }
+                        if (!serial.running_in_this_thread() || last[p] != i - 1)
+                        {
+                            ordered = false;
+                        }
+                        last[p] = i;
+                        inside.fetch_sub(1);
+                    });
+                }
+            });
+        }
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+        EXPECT_FALSE(serial.running_in_this_thread());
+    }
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(exclusive);
+    for (const int value : last)
+    {
+        EXPECT_EQ(value, PerProducer - 1);
+    }
+}
+
+TEST(Strand, ManyStrandsShareThePool)
+{
+    constexpr int Strands = 1000;
+    constexpr int PerStrand = 50;
+    thread_pool pool(3);
+    std::vector<std::unique_ptr<strand>> strands;
+    std::vector<int> counters(Strands, 0);
+    for (int s = 0; s < Strands; ++s)
+    {
+        strands.push_back(std::make_unique<strand>(pool));
+    }
+    for (int i = 0; i < PerStrand; ++i)
+    {
+        for (int s = 0; s < Strands; ++s)
+        {
+            // Counters are not atomic: the messages of one strand never run concurrently
+            strands[s]->post([&counter = counters[s], ptr = std::make_unique<int>(1)]() { counter += *ptr; });
+        }
+    }
+    strands.clear();
+    for (const int counter : counters)
+    {
+        EXPECT_EQ(counter, PerStrand);
+    }
+}
+
+TEST(Strand, BusyStrandYieldsToOthers)
+{
+    // One worker: the other strand runs only if the busy one gives the worker back between turns
+    thread_pool pool(1);
+    strand busy(pool, 4);
+    strand other(pool);
+    std::atomic<bool> otherRan{false};
+
+    struct Repost
+    {
+        strand& target;
+        std::atomic<bool>& stop;
+
+        void operator()() const
+        {
+            if (!stop.load())
+            {
+                target.post(Repost{target, stop});
+            }
+        }
+    };
+    busy.post([&]() {
+        other.post([&otherRan]() { otherRan = true; });
+        busy.post(Repost{busy, otherRan});
+    });
+    // Hangs if the busy strand is resubmitted ahead of the other one
+    while (!otherRan.load())
+    {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,222 @@
+// The coroutine support needs C++20, see LOSYNC_ENABLE_CXX20
+#if defined(__cpp_impl_coroutine)
+
+#include <losync/task.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+namespace
+{
+
+task<int> answer()
+{
+    co_return 42;
+}
+
+task<std::string> concatenate(const int count)
+{
+    std::string result;
+    for (int i = 0; i < count; ++i)
+    {
+        result += std::to_string(co_await answer());
+    }
+    co_return result;
+}
+
+task<> fail()
+{
+    throw std::runtime_error("failed");
+    co_return;
+}
+
+task<int> sumChain(const int depth)
+{
+    if (depth == 0)
+    {
+        co_return 0;
+    }
+    co_return 1 + co_await sumChain(depth - 1);
+}
+
+task<std::thread::id> threadOf(thread_pool& pool)
+{
+    co_await resume_on(pool);
+    co_return std::this_thread::get_id();
+}
+
+} // namespace
+
+
+TEST(Task, IsLazyAndReturnsValues)
+{
+    bool started = false;
+    auto body = [&started]() -> task<int> {
+        started = true;
+        co_return 5;
+    };
+    task<int> lazy = body();
+    EXPECT_TRUE(lazy.valid());
+    EXPECT_FALSE(started);
+    EXPECT_EQ(sync_wait(std::move(lazy)), 5);
+    EXPECT_TRUE(started);
+
+    EXPECT_EQ(sync_wait(concatenate(3)), "424242");
+    EXPECT_THROW(sync_wait(fail()), std::runtime_error);
+
+    // A task which is never awaited destroys its frame
+    {
+        task<std::string> unused = concatenate(1);
+    }
+}
+
+TEST(Task, DeepChains)
+{
+    // Symmetric transfer is a tail call only in optimized builds, so the depth is moderate
+    EXPECT_EQ(sync_wait(sumChain(1000)), 1000);
+}
+
+TEST(Task, ResumeOnPool)
+{
+    thread_pool pool(2);
+    EXPECT_NE(sync_wait(threadOf(pool)), std::this_thread::get_id());
+
+    std::atomic<int> finished{0};
+    auto increment = [&finished]() -> task<> {
+        finished.fetch_add(1);
+        co_return;
+    };
+    for (int i = 0; i < 100; ++i)
+    {
+        spawn(pool, increment());
+    }
+    while (finished.load() != 100)
+    {
+        std::this_thread::yield();
+    }
+}
+
+TEST(Task, AsyncMutex)
+{
+    constexpr int Workers = 4;
+    constexpr int PerWorker = 2000;
+    thread_pool pool(Workers);
+    async_mutex mutex;
+    long long counter = 0;
+    std::atomic<int> finished{0};
+
+    auto work = [&]() -> task<> {
+        for (int i = 0; i < PerWorker; ++i)
+        {
+            if (i % 2 == 0)
+            {
+                std::unique_lock<async_mutex> lock = co_await mutex.scoped_lock();
+                ++counter;
+            }
+            else
+            {
+                co_await mutex.lock();
+                ++counter;
+                mutex.unlock();
+            }
+            if (i % 100 == 0)
+            {
+                co_await resume_on(pool);
+            }
+        }
+        finished.fetch_add(1);
+    };
+    for (int i = 0; i < Workers; ++i)
+    {
+        spawn(pool, work());
+    }
+    while (finished.load() != Workers)
+    {
+        std::this_thread::yield();
+    }
+    EXPECT_TRUE(mutex.try_lock());
+    EXPECT_FALSE(mutex.try_lock());
+    mutex.unlock();
+    EXPECT_EQ(counter, Workers * PerWorker);
+}
+
+TEST(Task, AsyncEvent)
+{
+    async_event event;
+    int resumed = 0;
+    auto waiter = [&]() -> task<> {
+        co_await event;
+        ++resumed;
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; ++i)
+    {
+        threads.emplace_back([&waiter]() { sync_wait(waiter()); });
+    }
+    // Waiting threads block until the event is set, the coroutines resume on this thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(event.is_set());
+    event.set();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(resumed, 3);
+
+    // Set events do not suspend
+    sync_wait(waiter());
+    EXPECT_EQ(resumed, 4);
+    event.reset();
+    EXPECT_FALSE(event.is_set());
+}
+
+TEST(Task, AsyncQueue)
+{
+    async_queue<std::unique_ptr<int>> queue;
+    queue.push(std::make_unique<int>(1));
+    EXPECT_EQ(*queue.try_pop().value(), 1);
+    EXPECT_FALSE(queue.try_pop().has_value());
+
+    constexpr int Items = 10000;
+    long long sum = 0;
+    auto consumer = [&]() -> task<> {
+        for (int i = 0; i < Items; ++i)
+        {
+            sum += *co_await queue.pop();
+        }
+    };
+    std::thread producer([&queue]() {
+        for (int i = 1; i <= Items; ++i)
+        {
+            queue.push(std::make_unique<int>(i));
+        }
+    });
+    sync_wait(consumer());
+    producer.join();
+    EXPECT_EQ(sum, static_cast<long long>(Items) * (Items + 1) / 2);
+}
+
+TEST(Task, SleepFor)
+{
+    timer_thread timers;
+    auto sleeper = [&timers]() -> task<std::chrono::steady_clock::duration> {
+        const auto start = std::chrono::steady_clock::now();
+        co_await sleep_for(timers, std::chrono::milliseconds(10));
+        co_return std::chrono::steady_clock::now() - start;
+    };
+    EXPECT_GE(sync_wait(sleeper()), std::chrono::milliseconds(10));
+}
+
+#endif
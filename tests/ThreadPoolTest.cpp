@@ -0,0 +1,94 @@
+#include <losync/thread_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(ThreadPool, RunsAllTasksBeforeDestruction)
+{
+    std::atomic<int> sum{0};
+    {
+        thread_pool pool(4);
+        for (int i = 1; i <= 1000; ++i)
+        {
+            pool.submit([&sum, i]() { sum += i; });
+        }
+    }
+    EXPECT_EQ(sum.load(), 500500);
+}
+
+TEST(ThreadPool, TasksSubmitTasks)
+{
+    std::atomic<int> count{0};
+    {
+        thread_pool pool(3);
+        for (int i = 0; i < 10; ++i)
+        {
+            pool.submit([&pool, &count]() {
+                for (int j = 0; j < 100; ++j)
+                {
+                    pool.submit([&count, ptr = std::make_unique<int>(1)]() { count += *ptr; });
+                }
+            });
+        }
+    }
+    EXPECT_EQ(count.load(), 1000);
+}
+
+TEST(ThreadPool, SubmitBulk)
+{
+    std::atomic<int> count{0};
+    {
+        thread_pool pool(2);
+        std::vector<thread_pool::task> tasks;
+        for (int i = 0; i < 100; ++i)
+        {
+            tasks.emplace_back([&count]() { ++count; });
+        }
+        pool.submit_bulk(tasks.begin(), tasks.end());
+    }
+    EXPECT_EQ(count.load(), 100);
+}
+
+TEST(ThreadPool, ParallelFor)
+{
+    thread_pool pool(4);
+    std::vector<std::atomic<int>> visited(10007);
+    pool.parallel_for(0, visited.size(), [&visited](std::size_t i) { ++visited[i]; });
+    for (auto& value : visited)
+    {
+        ASSERT_EQ(value.load(), 1);
+    }
+
+    // Nested calls from workers help instead of blocking the pool
+    std::atomic<int> nested{0};
+    pool.parallel_for(
+        0, 8, [&](std::size_t) { pool.parallel_for(0, 100, [&nested](std::size_t) { ++nested; }, 7); }, 1);
+    EXPECT_EQ(nested.load(), 800);
+}
+
+TEST(ThreadPool, ParallelForWaitsForChunksWhenBodyThrows)
+{
+    thread_pool pool(4);
+    std::atomic<int> visited{0};
+    // Index 0 is in the chunk of the calling thread, the other chunks refer to its frame until they finish
+    EXPECT_THROW(pool.parallel_for(
+                     0, 1000,
+                     [&visited](const std::size_t i) {
+                         if (i == 0)
+                         {
+                             throw std::runtime_error("body");
+                         }
+                         ++visited;
+                     },
+                     10),
+                 std::runtime_error);
+    EXPECT_EQ(visited.load(), 990);
+}
@@ -0,0 +1,64 @@
+#include <losync/thread_slot.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(ThreadSlot, StableWithinThread)
+{
+    const std::size_t slot = thread_slot::index();
+    EXPECT_EQ(thread_slot::index(), slot);
+    EXPECT_LT(slot, thread_slot::high_water());
+}
+
+TEST(ThreadSlot, UniqueAmongLiveThreads)
+{
+    constexpr std::size_t Count = 8;
+    std::vector<std::size_t> slots(Count);
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> ready{0};
+    std::atomic<bool> release{false};
+
+    for (std::size_t i = 0; i < Count; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            slots[i] = thread_slot::index();
+            ++ready;
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (ready != Count)
+    {
+        std::this_thread::yield();
+    }
+    release = true;
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    const std::set<std::size_t> unique(slots.begin(), slots.end());
+    EXPECT_EQ(unique.size(), Count);
+    EXPECT_TRUE(unique.find(thread_slot::index()) == unique.end());
+}
+
+TEST(ThreadSlot, ReusedAfterThreadExit)
+{
+    const std::size_t highWater = std::max(thread_slot::high_water(), thread_slot::index() + 1);
+    for (int i = 0; i < 100; ++i)
+    {
+        std::thread([]() { thread_slot::index(); }).join();
+    }
+    EXPECT_LE(thread_slot::high_water(), highWater + 1);
+}
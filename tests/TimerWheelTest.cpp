@@ -0,0 +1,221 @@
+#include <losync/timer_wheel.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+using namespace std::chrono_literals;
+
+
+namespace
+{
+
+const timer_wheel::clock::time_point Start{};
+
+} // namespace
+
+
+TEST(TimerWheel, FiresAtDeadlinesOfAllLevels)
+{
+    timer_wheel wheel(1ms, Start);
+    std::vector<int> fired;
+    wheel.schedule(Start + 5ms, [&]() { fired.push_back(5); });
+    wheel.schedule(Start + 3ms, [&]() { fired.push_back(3); });
+    wheel.schedule(Start + 300ms, [&]() { fired.push_back(300); });
+    wheel.schedule(Start + 70000ms, [&]() { fired.push_back(70000); });
+    wheel.schedule(Start + 20000000ms, [&]() { fired.push_back(20000000); });
+    EXPECT_EQ(wheel.size(), 5u);
+
+    EXPECT_EQ(wheel.advance(Start + 2ms), 0u);
+    EXPECT_EQ(wheel.advance(Start + 3ms), 1u);
+    EXPECT_EQ(wheel.advance(Start + 299ms), 1u);
+    EXPECT_EQ(wheel.advance(Start + 300ms), 1u);
+    EXPECT_EQ(wheel.advance(Start + 69999ms), 0u);
+    EXPECT_EQ(wheel.advance(Start + 70000ms), 1u);
+    EXPECT_EQ(wheel.advance(Start + 19999999ms), 0u);
+    EXPECT_EQ(wheel.advance(Start + 20000000ms), 1u);
+    EXPECT_EQ(fired, (std::vector<int>{3, 5, 300, 70000, 20000000}));
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_FALSE(wheel.next_deadline());
+}
+
+TEST(TimerWheel, Cancel)
+{
+    timer_wheel wheel(1ms, Start);
+    int fired = 0;
+    const timer_wheel::timer_id first = wheel.schedule(Start + 10ms, [&]() { ++fired; });
+    const timer_wheel::timer_id second = wheel.schedule(Start + 10ms, [&]() { ++fired; });
+    EXPECT_NE(first, timer_wheel::invalid_timer);
+    EXPECT_TRUE(wheel.cancel(first));
+    EXPECT_FALSE(wheel.cancel(first));
+    EXPECT_FALSE(wheel.cancel(timer_wheel::invalid_timer));
+    EXPECT_EQ(wheel.size(), 1u);
+
+    EXPECT_EQ(wheel.advance(Start + 10ms), 1u);
+    EXPECT_EQ(fired, 1);
+    EXPECT_FALSE(wheel.cancel(second));
+
+    // The node of the cancelled timer is reused with a different id
+    const timer_wheel::timer_id third = wheel.schedule(Start + 20ms, [&]() { ++fired; });
+    EXPECT_NE(third, first);
+    EXPECT_NE(third, second);
+    EXPECT_FALSE(wheel.cancel(first));
+    EXPECT_TRUE(wheel.cancel(third));
+}
+
+TEST(TimerWheel, CallbacksScheduleAndCancel)
+{
+    timer_wheel wheel(1ms, Start);
+    int periodic = 0;
+    std::function<void()> tick;
+    tick = [&]() {
+        if (++periodic < 10)
+        {
+            wheel.schedule(Start + 10ms * (periodic + 1), [&]() { tick(); });
+        }
+    };
+    wheel.schedule(Start + 10ms, [&]() { tick(); });
+
+    // The first timer of the tick cancels the second one
+    timer_wheel::timer_id victim = timer_wheel::invalid_timer;
+    bool victimFired = false;
+    wheel.schedule(Start + 5ms, [&]() { EXPECT_TRUE(wheel.cancel(victim)); });
+    victim = wheel.schedule(Start + 5ms, [&]() { victimFired = true; });
+
+    // A timer scheduled for the past from a callback fires at the next tick
+    bool late = false;
+    wheel.schedule(Start + 7ms, [&]() { wheel.schedule(Start, [&]() { late = true; }); });
+
+    wheel.advance(Start + 7ms);
+    EXPECT_FALSE(late);
+    wheel.advance(Start + 1000ms);
+    EXPECT_TRUE(late);
+    EXPECT_FALSE(victimFired);
+    EXPECT_EQ(periodic, 10);
+}
+
+TEST(TimerWheel, MoveOnlyCallbacks)
+{
+    timer_wheel wheel(1ms, Start);
+    int value = 0;
+    auto owned = std::make_unique<int>(42);
+    wheel.schedule(Start + 1ms, [&value, owned = std::move(owned)]() { value = *owned; });
+    // Destroyed without being called
+    wheel.schedule(Start + 1000ms, [owned = std::make_unique<int>(1)]() {});
+    wheel.advance(Start + 1ms);
+    EXPECT_EQ(value, 42);
+}
+
+TEST(TimerWheel, NextDeadlineSkipsIdleTime)
+{
+    timer_wheel wheel(1ms, Start);
+    EXPECT_FALSE(wheel.next_deadline());
+    bool fired = false;
+    wheel.schedule(Start + 1h, [&]() { fired = true; });
+    std::size_t steps = 0;
+    while (!fired)
+    {
+        const std::optional<timer_wheel::clock::time_point> next = wheel.next_deadline();
+        ASSERT_TRUE(next);
+        ASSERT_LE(*next, Start + 1h);
+        wheel.advance(*next);
+        ++steps;
+    }
+    // One step per level at most
+    EXPECT_LE(steps, timer_wheel::levels + 1);
+}
+
+TEST(TimerWheel, MatchesReference)
+{
+    timer_wheel wheel(1ms, Start);
+    std::mt19937_64 random(7);
+    struct Timer
+    {
+        std::int64_t deadline;
+        timer_wheel::timer_id id;
+        bool cancelled = false;
+        int fired = 0;
+        std::int64_t firedAt = 0;
+        std::int64_t previousAdvance = 0;
+    };
+    std::vector<Timer> timers;
+    timers.reserve(20000);
+    std::int64_t now = 0;
+    std::int64_t previous = -1;
+    for (int round = 0; round < 2000; ++round)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            // Deadlines of every level, including the overflow list
+            const int range = static_cast<int>(random() % 5);
+            const std::int64_t delay = static_cast<std::int64_t>(random() % (std::uint64_t{1} << (8 * range + 4)));
+            const std::size_t index = timers.size();
+            timers.push_back(Timer{now + 1 + delay, timer_wheel::invalid_timer});
+            timers[index].id = wheel.schedule(Start + std::chrono::milliseconds(timers[index].deadline), [&, index]() {
+                ++timers[index].fired;
+                timers[index].firedAt = now;
+                timers[index].previousAdvance = previous;
+            });
+        }
+        if (random() % 2 == 0)
+        {
+            Timer& timer = timers[random() % timers.size()];
+            EXPECT_EQ(wheel.cancel(timer.id), !timer.cancelled && timer.fired == 0);
+            timer.cancelled = true;
+        }
+        previous = now;
+        now += static_cast<std::int64_t>(random() % (round % 100 == 0 ? 1ull << 36 : 1ull << 12));
+        wheel.advance(Start + std::chrono::milliseconds(now));
+    }
+    // Beyond all deadlines but within the range of nanoseconds of the clock
+    previous = now;
+    now = std::int64_t{1} << 42;
+    wheel.advance(Start + std::chrono::milliseconds(now));
+    EXPECT_TRUE(wheel.empty());
+
+    for (const Timer& timer : timers)
+    {
+        if (timer.cancelled && timer.fired == 0)
+        {
+            continue;
+        }
+        ASSERT_EQ(timer.fired, 1);
+        // At the first advance which reached the deadline
+        ASSERT_GE(timer.firedAt, timer.deadline);
+        ASSERT_LT(timer.previousAdvance, timer.deadline);
+    }
+}
+
+TEST(TimerThread, FiresAndCancels)
+{
+    timer_thread timers;
+    std::atomic<int> fired{0};
+    const timer_thread::timer_id cancelled = timers.schedule_after(50ms, [&]() { fired += 100; });
+    for (int i = 0; i < 10; ++i)
+    {
+        timers.schedule_after(std::chrono::milliseconds(i), [&]() { ++fired; });
+    }
+    EXPECT_TRUE(timers.cancel(cancelled));
+    // An earlier timer scheduled later wakes the sleeping thread
+    timers.schedule_after(1h, []() {});
+    timers.schedule_after(1ms, [&]() { ++fired; });
+
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (fired.load() < 11 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    std::this_thread::sleep_for(60ms);
+    EXPECT_EQ(fired.load(), 11);
+    EXPECT_EQ(timers.size(), 1u);
+}
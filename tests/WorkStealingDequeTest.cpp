@@ -0,0 +1,88 @@
+#include <losync/work_stealing_deque.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+using namespace losync;
+
+
+TEST(WorkStealingDeque, OwnerIsLifoThiefIsFifo)
+{
+    work_stealing_deque<std::unique_ptr<int>> deque(3);
+    EXPECT_EQ(deque.capacity(), 4u);
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(deque.push(std::make_unique<int>(i)));
+    }
+    auto extra = std::make_unique<int>(4);
+    EXPECT_FALSE(deque.push(std::move(extra)));
+    EXPECT_NE(extra, nullptr);
+    EXPECT_EQ(deque.size(), 4u);
+
+    EXPECT_EQ(**deque.pop(), 3);
+    EXPECT_EQ(**deque.steal(), 0);
+    EXPECT_EQ(**deque.pop(), 2);
+    EXPECT_EQ(**deque.steal(), 1);
+    EXPECT_FALSE(deque.pop());
+    EXPECT_FALSE(deque.steal());
+}
+
+TEST(WorkStealingDeque, EveryElementIsTakenOnce)
+{
+    constexpr int Count = 200000;
+    constexpr int Thieves = 3;
+    work_stealing_deque<int> deque(256);
+    std::vector<std::atomic<int>> taken(Count);
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < Thieves; ++i)
+    {
+        thieves.emplace_back([&]() {
+            while (!done.load() || deque.size() != 0)
+            {
+                if (auto value = deque.steal())
+                {
+                    ++taken[*value];
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < Count; ++i)
+    {
+        while (!deque.push(int{i}))
+        {
+            if (auto value = deque.pop())
+            {
+                ++taken[*value];
+            }
+        }
+        if (i % 3 == 0)
+        {
+            if (auto value = deque.pop())
+            {
+                ++taken[*value];
+            }
+        }
+    }
+    while (auto value = deque.pop())
+    {
+        ++taken[*value];
+    }
+    done = true;
+    for (auto& thief : thieves)
+    {
+        thief.join();
+    }
+
+    for (int i = 0; i < Count; ++i)
+    {
+        ASSERT_EQ(taken[i].load(), 1) << i;
+    }
+}
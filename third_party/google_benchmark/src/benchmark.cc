@@ -213,8 +213,10 @@ void State::PauseTiming() {
     for (const auto& name_and_measurement : measurements) {
       auto name = name_and_measurement.first;
       auto measurement = name_and_measurement.second;
-      BM_CHECK_EQ(std::fpclassify((double)counters[name]), FP_ZERO);
-      counters[name] = Counter(measurement, Counter::kAvgIterations);
+      // Losync: accumulate, a benchmark may pause the timing many times in one run
+      Counter& counter = counters[name];
+      counter.value += measurement;
+      counter.flags = Counter::kAvgIterations;
     }
   }
 }